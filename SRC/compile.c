@@ -1,6 +1,57 @@
 /* compile.c -- Compile scheme expressions into byte-codes.
 	written by Jason Coughlin
 
+   Version 5
+
+	- Code from mcAnalyze() knows every frame it runs in, so it has
+	nothing to check: a global there compiles to prPushGlo or
+	prSetGlo, which go straight to the symbol's slot.  Code from
+	mcCompile() still uses prPushGlobal and prSetGlobal.
+
+   Version 4
+
+	- A variable that isn't a parameter in scope is a global if no
+	frame but the ones in scope is there when the code runs.  The
+	compiler can only know that for mcAnalyze(), which knows all of
+	a closure's frames; code from mcCompile() may be EVALed inside a
+	closure.  So prPushGlobal has the # of frames in scope, and the
+	interpreter checks that the frame that many out is NIL: if it is,
+	the value is taken straight from the slot of the global vector for
+	the symbol's # -- no frame is searched, no symbol compared.  If it
+	isn't, the variable is looked up by name as with prPushVar.
+
+	- SET! of a parameter compiles to prSetLocal, SET! of a global to
+	prSetGlobal, which checks the frames the same way.  (The global
+	vector is replaced when it grows, so it's the symbol's slot # that
+	is used, not a pointer to the slot.)
+
+   Version 3
+
+	- A code-buffer has the scope of the code in it: the parameter
+	lists of the lambdas it's inside, innermost first, then the frames
+	of the env it'll run in if that's known (mcAnalyze() knows it;
+	mcCompile() doesn't).  A variable in the scope is compiled to
+	prPushLocal with how many frames out it is and its slot.  Any
+	other variable is still looked up by name with prPushVar (see
+	Version 4).
+	Parameter lists are NIL for lambdas without parameters, since
+	those don't get frames.
+
+	- The scope lists are pushed on the register stack like the
+	byte-code cpLambda() makes.
+
+   Version 2
+
+	- mcAnalyze() pre-analyzes the body of an interpreted closure the
+	first time it's called: if the body only uses what the compiler
+	can do exactly as the interpreter would, it's compiled and the
+	closure runs the byte-code from then on.  Otherwise the closure
+	stays interpreted.  See the notes at mcAnalyze().
+
+	- A code-buffer that fills up is marked full instead of running off
+	its end.  Branch addresses are 1 byte, so code a branch goes past
+	byte 255 to is too big too.  mcCompile() reports an error.
+
    Version 1
 
 	- Byte-code is generated in a codebuffer since the size of the
@@ -13,21 +64,18 @@
 
 	- Since the codebuffers are local to compile.c, the constants put
 	into a codebuffer's constant table have to be protected from a gc.
-	Most constants are already protected because mcCompile() copies
-	the expression and saves it in a register.  However, cpLambda()
+	Most constants are already protected because they're part of the
+	expression mcCompile() is given.  However, cpLambda()
 	generates a constant.  This constant has to be pushed on the
 	register stack to save it from a GC.  It's popped off when
-	mcCompile() calls MCLEAVE.
+	mcCompile() returns.
 
 	- MAX_BCONST is 256 so that pointers into the constant table are
 	only 1 byte.
 
-   BUGS:
-	- I can't figure out why this is a problem, but a GC CAN'T
-	happen during cpCompileArgs().  cpCompileArgs() reverses
-	the arg list and in so doing, orphans the args.  I put the
-	orphaned args in a register, but they still disappeared.  It's
-	related to the destructive reverse, but ...
+	- A GC used to lose args in cpCompileArgs(): the reversed arg
+	list is only held by a C local while the args are compiled.
+	The GC scans the C stack now (see memory.c), so it's safe.
 */
 
 #include "machine.h"
@@ -50,6 +98,8 @@
 #include "error.h"
 
 int cp_debug;
+int cp_analyze;		/* pre-analyze interpreted closures? */
+long cp_gen;		/* analyzed code older than this is redone */
 
 /* maximums for the code-buffers */
 #define MAX_BCODE	512
@@ -63,16 +113,27 @@ typedef struct {
 	CONS cnst[MAX_CONST];			/* the constants */
 	unsigned int codeptr;			/* code pntr */
 	unsigned int cnstptr;			/* constant table pntr */
+	int full;				/* ran out of room? */
+	CONS scope;				/* parameter lists */
+	CONS env;				/* frames beyond them */
+	int known;				/* env is all of them? */
 } CODENODE;
 typedef CODENODE *CODE_BUFFER;
 
 /* macros to generate code in a codebuffer */
-#define cpCode(n,i)	( (n)->code[((n)->codeptr)++] = (i) )
+#define cpCode(n,i)	( (n)->codeptr < MAX_BCODE ? (void)((n)->code[((n)->codeptr)++] = (i)) : (void)((n)->full = TRUE) )
 #define cpGetCP(n)	( (n)->cnstptr )
 #define cpGetIP(n)	( (n)->codeptr )
 #define cpSetCP(n,k)	( (n)->cnstptr = (k) )
 #define cpSetIP(n,i)	( (n)->codeptr = (i) )
-#define cpFixup(n,a,i)	( (n)->code[(a)] = (unsigned char) (i) )
+#define cpFixup(n,a,i)	( (i) > 255 || (a) >= MAX_BCODE ? (void)((n)->full = TRUE) : (void)((n)->code[(a)] = (unsigned char) (i)) )
+#define cpReset(n)	( (n)->codeptr = (n)->cnstptr = 0, (n)->full = FALSE, \
+			  (n)->scope = (n)->env = NIL, (n)->known = FALSE )
+
+/* where a variable is, as far as the compiler knows (cpScope()) */
+#define CP_BYNAME	0	/* don't know; look it up by name */
+#define CP_LOCAL	1	/* a parameter in a known frame */
+#define CP_GLOBAL	2	/* global, unless there are unknown frames */
 
 /* compiled code buffer -- where the generated code is placed while
  * expressions are being compiled.
@@ -93,6 +154,11 @@ static void cpQuote( C_CODE_BUFFER X C_CONS X C_INT );
 static void cpLambda( C_CODE_BUFFER X C_CONS X C_INT );
 static void cpDefine( C_CODE_BUFFER X C_CONS X C_INT );
 static void cpSet( C_CODE_BUFFER X C_CONS X C_INT );
+static int cpCanCompile( C_CONS X C_CONS X C_CONS );
+static int cpCanArgs( C_CONS X C_CONS X C_CONS );
+static int cpCanForm( C_CONS X C_CONS X C_CONS X C_CONS );
+static int cpLexical( C_CONS X C_CONS X C_CONS );
+static int cpScope( C_CODE_BUFFER X C_CONS X C_INT C_PTR X C_INT C_PTR );
 
 /* InitComp() - Initialize the compiler. */
 void InitComp(argc, argv)
@@ -102,6 +168,8 @@ char *argv[];
    int i;
 
    cp_debug = FALSE;
+   cp_analyze = TRUE;
+   cp_gen = 0;
 
    /* allocate the main compile buffer */
    if ( (glo_cbuffer = (CODE_BUFFER) malloc( sizeof(CODENODE) )) == NULL ) {
@@ -109,8 +177,7 @@ char *argv[];
 	exit(1);
    }
 
-   cpSetIP(glo_cbuffer, 0);
-   cpSetCP(glo_cbuffer, 0);
+   cpReset(glo_cbuffer);
 
    for ( i = 1; i < argc; ++i ) {
 	if ( argv[i][0] == '-' || argv[i][0] == '/' ) {
@@ -118,6 +185,9 @@ char *argv[];
 		   case 'c':
 			cp_debug = TRUE;
 			break;
+		   case 'i':
+			cp_analyze = FALSE;
+			break;
 		}
 	}
    }
@@ -131,27 +201,261 @@ char *argv[];
 CONS mcCompile(e)
 CONS e;
 {
-   ENTER;
-   REG(bcode);
-   REG(exp);
+   CONS bcode;
+   CONS *regs;		/* cpLambda() pushes byte-code past here */
 
-   /* copy the expression to avoid capture */
-   R(exp) = mcTree_Copy(e);
+   regs = Top_RegS;
 
    /* initialize the code buffer */
-   cpSetIP(glo_cbuffer, 0);
-   cpSetCP(glo_cbuffer, 0);
+   cpReset(glo_cbuffer);
 
    /* compile the expression */
    cpCompile(glo_cbuffer, e, TRUE);
 
+   if ( glo_cbuffer->full ) {
+	Top_RegS = regs;
+	RT_LERROR("COMPILE: Expression too big: ", e);
+   }
+
    /* copy into a byte-code node */
-   R(bcode) = cpMakeBCode( glo_cbuffer );
+   bcode = cpMakeBCode( glo_cbuffer );
 
    if ( cp_debug )
-	cpDumpBC( R(bcode) );
+	cpDumpBC( bcode );
+
+   Top_RegS = regs;
+   return bcode;
+}
+
+/* ----------------------------------------------------------------------- */
+/*                              Pre-analysis				   */
+/* ----------------------------------------------------------------------- */
+
+/* mcAnalyze(cl) - Pre-analyze the body of the interpreted closure cl.  The
+	closure's code becomes the body compiled, or F if it has to stay
+	interpreted.  evApply() calls this the first time cl is called,
+	so the globals it looks at are as they'll be when the body runs.
+
+	- The interpreter looks at every expression again each time it's
+	evaluated: it looks up its car in the expansion table, pushes its
+	args, PUSHFUNC and CALL, counts the args for a primitive, and looks
+	up each variable by name.  The byte-code has all that worked out
+	once: constants, variables, primitive calls with their # of args
+	checked, ifs as branches, and closure calls.
+
+	- The body is only compiled if that can't change what it means.
+	cpCanCompile() turns down a body with
+		a macro call (it has to be expanded at run-time),
+		a special form the compiler doesn't do (OR, AND, MACRO,
+		user forms, DEFINE, an IF without an alternate),
+		a primitive called with the wrong # of args (the error
+		has to come when it's evaluated),
+		a call to a primitive or form whose name is a parameter
+		(the compiler would call the primitive),
+		a call to an unbound global, or
+		anything else it doesn't know.
+	Bodies that are too big for a code-buffer stay interpreted too.
+	-i turns pre-analysis off.
+
+	- What the analysis saw can change: a name it took for a closure
+	can become a macro, and one bound to a primitive or a form can be
+	rebound.  evMacroTable() and evDefGlobal() bump cp_gen when that
+	happens, and the code is stamped with cp_gen when it's made, so
+	evApply() analyzes a closure again if its code is older.  A lambda
+	in an analyzed body makes an interpreted closure that has its code
+	already (prMakeAnalyzed), so it can be analyzed again too.
+	*COMPILE* is different: compiled code still calls the primitive.
+*/
+void mcAnalyze(cl)
+CONS cl;
+{
+   CONS code;
+   CONS *regs;		/* cpLambda() pushes byte-code past here */
+
+   code = F;
 
-   MCLEAVE R(bcode);
+   if ( cp_analyze &&
+	cpCanArgs( mcCl_Body(cl), mcCons( mcCl_Parms(cl), NIL ), mcCl_Env(cl) ) > 0 ) {
+	regs = Top_RegS;
+
+	cpReset(glo_cbuffer);
+	glo_cbuffer->scope = mcCons( mcCl_Parms(cl), NIL );
+	mcRegPush( glo_cbuffer->scope );
+	glo_cbuffer->env = mcCl_Env(cl);
+	glo_cbuffer->known = TRUE;
+	cpBegin( glo_cbuffer, mcCl_Body(cl), TRUE );
+
+	if ( !glo_cbuffer->full ) {
+		code = cpMakeBCode( glo_cbuffer );
+
+		if ( cp_debug )
+			cpDumpBC( code );
+	}
+
+	Top_RegS = regs;
+   }
+
+   SBarrier( mcCl_Code(cl) );
+   mcCl_Code(cl) = code;
+   WBarrier( cl, code );
+}
+
+/* cpCanCompile(e, scope, env) - TRUE if compiling e can't change what it
+	means.  scope is a list of the parameter lists e is inside, and
+	env is the nested env of the closure it's in.
+*/
+static int cpCanCompile(e, scope, env)
+CONS e, scope, env;
+{
+   CONS f, binding;
+   int nargs;
+
+   if ( !mcPair(e) )
+	return mcSymbol(e) || mcNumber(e) || mcString(e) || mcNull(e) ||
+		mcChar(e) || e == T || e == F || mcVector(e);
+
+   f = mcCar(e);
+
+   /* ((lambda (x) ...) 1) or ((f) 1): a closure call */
+   if ( mcPair(f) )
+	return cpCanCompile( f, scope, env ) && cpCanArgs( mcCdr(e), scope, env ) >= 0;
+
+   if ( !mcSymbol(f) )
+	return FALSE;
+
+   /* a macro call */
+   if ( mcSym_Macro(f) )
+	return FALSE;
+
+   binding = evAccGlobal( f, glo_env );
+   if ( binding != NULL && (mcForm(binding) || mcFunc(binding) || mcUserForm(binding)) ) {
+	/* the interpreter calls whatever f is bound to, but the compiler
+	 * calls the primitive.
+	 */
+	if ( cpLexical( f, scope, env ) || mcUserForm(binding) )
+		return FALSE;
+
+	if ( mcForm(binding) )
+		return cpCanForm( binding, mcCdr(e), scope, env );
+
+	nargs = cpCanArgs( mcCdr(e), scope, env );
+	return nargs >= 0 &&
+		((mcPrim_RA(binding) == nargs ) ||
+		 (mcPrim_AA(binding) >= mcPrim_RA(binding) && nargs == mcPrim_AA(binding)) ||
+		 (mcPrim_AA(binding) < mcPrim_RA(binding)  && nargs >= mcPrim_RA(binding)));
+   }
+
+   /* a closure call.  an unbound f might be a macro by the time the
+    * call is made, or be a mistake the interpreter should report.
+    */
+   if ( binding == NULL && !cpLexical( f, scope, env ) )
+	return FALSE;
+
+   return cpCanArgs( mcCdr(e), scope, env ) >= 0;
+}
+
+/* cpCanArgs(args, scope, env) - Returns the # of expressions in the list
+	args if they can all be compiled, -1 if they can't.
+*/
+static int cpCanArgs(args, scope, env)
+CONS args, scope, env;
+{
+   int n;
+
+   for ( n = 0; mcPair(args); args = mcCdr(args), ++n )
+	if ( !cpCanCompile( mcCar(args), scope, env ) )
+		return -1;
+
+   return mcNull(args) ? n : -1;
+}
+
+/* cpCanForm(f, args, scope, env) - TRUE if the special form f with args
+	can be compiled.
+*/
+static int cpCanForm(f, args, scope, env)
+CONS f, args, scope, env;
+{
+   CONS parms;
+
+   switch ( mcPrim_PR(f) ) {
+	case prQuote:
+		return mcPair(args) && mcNull( mcCdr(args) );
+
+	case prIf:
+		return cpCanArgs( args, scope, env ) == 3;
+
+	case prBegin:
+		return cpCanArgs( args, scope, env ) > 0;
+
+	case prSet:
+		return mcPair(args) && mcSymbol( mcCar(args) ) &&
+			cpCanArgs( mcCdr(args), scope, env ) == 1;
+
+	case prLambda:
+		if ( !mcPair(args) )
+			return FALSE;
+
+		/* the parameters are symbols, or a list of them */
+		for ( parms = mcCar(args); mcPair(parms); parms = mcCdr(parms) )
+			if ( !mcSymbol( mcCar(parms) ) )
+				return FALSE;
+		if ( !mcNull(parms) && !mcSymbol(parms) )
+			return FALSE;
+
+		scope = mcCons( mcCar(args), scope );
+		return cpCanArgs( mcCdr(args), scope, env ) > 0;
+   }
+
+   return FALSE;
+}
+
+/* cpLexical(sym, scope, env) - TRUE if sym is a parameter in one of the
+	lists in scope, or is bound in one of the frames of env.
+*/
+static int cpLexical(sym, scope, env)
+CONS sym, scope, env;
+{
+   for ( ; !mcNull(scope); scope = mcCdr(scope) )
+	if ( evFrameIndex( mcCar(scope), sym ) >= 0 )
+		return TRUE;
+
+   for ( ; !mcNull(env); env = mcFrame_Up(env) )
+	if ( evFrameIndex( mcFrame_Parms(env), sym ) >= 0 )
+		return TRUE;
+
+   return FALSE;
+}
+
+/* cpScope(cb, sym, depth, slot) - Where sym is in the scope of code-buffer
+	cb.  CP_LOCAL if it's a parameter *depth frames out, in slot
+	*slot.  CP_GLOBAL if it's in none of the *depth frames in scope.
+	Both have to fit in a byte, or it's CP_BYNAME.
+*/
+static int cpScope(cb, sym, depth, slot)
+CODE_BUFFER cb;
+CONS sym;
+int *depth, *slot;
+{
+   CONS scope, frame;
+
+   *depth = 0;
+   for ( scope = cb->scope; !mcNull(scope); scope = mcCdr(scope) ) {
+	/* a lambda without parameters doesn't get a frame */
+	if ( mcNull( mcCar(scope) ) )
+		continue;
+
+	if ( (*slot = evFrameIndex( mcCar(scope), sym )) >= 0 )
+		return *depth < 256 && *slot < 256 ? CP_LOCAL : CP_BYNAME;
+	++*depth;
+   }
+
+   for ( frame = cb->env; !mcNull(frame); frame = mcFrame_Up(frame) ) {
+	if ( (*slot = evFrameIndex( mcFrame_Parms(frame), sym )) >= 0 )
+		return *depth < 256 && *slot < 256 ? CP_LOCAL : CP_BYNAME;
+	++*depth;
+   }
+
+   return *depth < 256 ? CP_GLOBAL : CP_BYNAME;
 }
 
 /* cpMakeBCode(cb) -- Copy the byte-code from the code-buffer cb into a
@@ -165,12 +469,13 @@ CODE_BUFFER cb;
 
    /* copy the code into a BCODE node */
    code = NewCons( BCODES, cpGetIP(cb), cpGetCP(cb) );
+   mcBC_Gen(code) = cp_gen;
 
    /* copy the code into this BCODE node */
    memcpy( (char *)mcBC_Code(code), (char *)cb->code, (int)cpGetIP(cb) );
 
    /* copy the constants */
-   for ( l = 0; l < cpGetCP(cb); ++l )
+   for ( l = 0; l < (int)cpGetCP(cb); ++l )
 	*(mcBC_Const(code)+l) = cb->cnst[l];
 
    return code;
@@ -181,6 +486,11 @@ static void cpConst(cb, k)
 CODE_BUFFER cb;
 CONS k;
 {
+   if ( cpGetCP(cb) >= MAX_CONST ) {
+	cb->full = TRUE;
+	return;
+   }
+
    cb->cnst[ cpGetCP(cb) ] = k;
    ++cb->cnstptr;
 }
@@ -195,13 +505,15 @@ CONS e;
 int at_end;
 {
    CONS f, args, binding;
+   int depth, slot;
 
    CP_DEBUG("\nIn cpCompile, e = ", e);
 
    /* compiling an atom */
    if ( !mcPair(e) ) {
 
-	if ( mcNumber(e) || mcString(e) || mcNull(e) || mcChar(e) ) {
+	if ( mcNumber(e) || mcString(e) || mcNull(e) || mcChar(e) ||
+	     e == T || e == F || mcVector(e) ) {
 		/* code generated: prPushConst cnstptr
 		 * constant table: add e
 		 */
@@ -212,12 +524,39 @@ int at_end;
 	}
 
 	if ( mcSymbol(e) ) {
-		/* code generated: prPushVar cnstptr
-		 * constant table: add e
-		 */
-		cpCode( cb, prPushVar );
-		cpCode( cb, cpGetCP(cb) );
-		cpConst( cb, e );
+		switch ( cpScope(cb, e, &depth, &slot) ) {
+		   case CP_LOCAL:
+			/* code generated: prPushLocal depth slot */
+			cpCode( cb, prPushLocal );
+			cpCode( cb, depth );
+			cpCode( cb, slot );
+			break;
+
+		   case CP_GLOBAL:
+			/* code generated: prPushGlo cnstptr if every
+			 * frame is known, else prPushGlobal cnstptr depth
+			 * constant table: add e
+			 */
+			if ( cb->known ) {
+				cpCode( cb, prPushGlo );
+				cpCode( cb, cpGetCP(cb) );
+			} else {
+				cpCode( cb, prPushGlobal );
+				cpCode( cb, cpGetCP(cb) );
+				cpCode( cb, depth );
+			}
+			cpConst( cb, e );
+			break;
+
+		   default:
+			/* code generated: prPushVar cnstptr
+			 * constant table: add e
+			 */
+			cpCode( cb, prPushVar );
+			cpCode( cb, cpGetCP(cb) );
+			cpConst( cb, e );
+			break;
+		}
 		return;
 	}
    }
@@ -312,7 +651,7 @@ CONS func, args;
          (mcPrim_AA(func) < mcPrim_RA(func)  && nargs >= mcPrim_RA(func))) ) {
 	/* wrong # of args */
 	fprintf(currout, "Error: COMPILE: Wrong # of args to primitive procedure %s: ", mcPrim_Name(func));
-	mcWrite(args, currout);
+	mcWrite(args, STDOUT);
 	fprintf(currout, "\n\n");
 	ERROR;
    }
@@ -364,7 +703,7 @@ CODE_BUFFER cb;
 CONS e;
 int at_end;
 {
-   char goto_else, goto_done;
+   unsigned int goto_else, goto_done = 0;
 
    CP_DEBUG("\nCompiling if.", NIL);
 
@@ -474,10 +813,9 @@ CODE_BUFFER cb;
 CONS e;
 int at_end;
 {
-   /* this routine can't use the ENTER macro!  it pushes the new closure
-    * on the register stack to protect it from a garbage-collection.  if
-    * ENTER were used, the closure would be popped off the reg stack
-    * when the corresponding MCLEAVE were issued.
+   /* the new byte-code is pushed on the register stack to protect it
+    * from a garbage-collection; it's only held by the code buffer's
+    * constant table, which the GC can't see.  mcCompile() pops it.
     */
    CONS lcode;
    CODE_BUFFER lcb;
@@ -488,11 +826,20 @@ int at_end;
    if ( (lcb = (CODE_BUFFER) malloc( sizeof(CODENODE) )) == NULL ) {
 	RT_ERROR("Out of memory for compilation");
    }
-   cpSetIP(lcb, 0);
-   cpSetCP(lcb, 0);
+   cpReset(lcb);
+
+   /* the body's scope is the lambda's parameters inside cb's scope */
+   lcb->scope = mcCons( mcCar(e), cb->scope );
+   mcRegPush( lcb->scope );
+   lcb->env = cb->env;
+   lcb->known = cb->known;
 
-   /* compile the body of the lambda expression */
-   cpBegin( lcb, mcCdr(e), at_end );
+   /* compile the body of the lambda expression; it's always at the end
+    * of the closure, wherever the lambda is.
+    */
+   cpBegin( lcb, mcCdr(e), TRUE );
+   if ( lcb->full )
+	cb->full = TRUE;
 
    /* move the compiled body into it's own byte-code node and push the
     * byte-code on the register stack so it won't disappear with a
@@ -500,6 +847,7 @@ int at_end;
     */
    lcode = cpMakeBCode(lcb);
    mcRegPush( lcode );
+   free( (char *)lcb );
 
    if ( cp_debug )
 	cpDumpBC(lcode);
@@ -512,13 +860,23 @@ int at_end;
    cpCode( cb, cpGetCP(cb) );
    cpConst( cb, mcCar(e) );
 
+   /* an analyzed lambda makes an interpreted closure that's already
+    * been analyzed, so it can be analyzed again (see mcAnalyze()).
+    * push its body.
+    */
+   if ( cb->known ) {
+	cpCode( cb, prPushConst );
+	cpCode( cb, cpGetCP(cb) );
+	cpConst( cb, mcCdr(e) );
+   }
+
    /* push the lambda's byte-code */
    cpCode( cb, prPushConst );
    cpCode( cb, cpGetCP(cb) );
    cpConst( cb, lcode );
 
    /* make a closure */
-   cpCode( cb, prMakeClosure );
+   cpCode( cb, cb->known ? prMakeAnalyzed : prMakeClosure );
 }
 
 /* cpDefine(e) - Compile 'define'. */
@@ -548,19 +906,54 @@ CODE_BUFFER cb;
 CONS e;
 int at_end;
 {
+   int depth, slot;
+
    if ( !mcSymbol( mcCar(e) ) ) {
 	RT_LERROR("COMPILE: Illegal SET! syntax.  Can't bind to non-symbol: ", mcCar(e) );
    }
 
-   /* push the symbol to be defined */
-   cpCode( cb, prPushConst );
-   cpCode( cb, cpGetCP(cb) );
-   cpConst( cb, mcCar(e) );
+   switch ( cpScope( cb, mcCar(e), &depth, &slot ) ) {
+	case CP_LOCAL:
+		/* code generated: prSetLocal depth slot cnstptr
+		 * constant table: add the symbol, which SET! returns
+		 */
+		cpCompile( cb, mcCadr(e), FALSE );
+		cpCode( cb, prSetLocal );
+		cpCode( cb, depth );
+		cpCode( cb, slot );
+		cpCode( cb, cpGetCP(cb) );
+		cpConst( cb, mcCar(e) );
+		break;
 
-   /* compile the expression */
-   cpCompile( cb, mcCadr(e), FALSE );
+	case CP_GLOBAL:
+		/* code generated: prSetGlo cnstptr if every frame is
+		 * known, else prSetGlobal cnstptr depth
+		 * constant table: add the symbol
+		 */
+		cpCompile( cb, mcCadr(e), FALSE );
+		if ( cb->known ) {
+			cpCode( cb, prSetGlo );
+			cpCode( cb, cpGetCP(cb) );
+		} else {
+			cpCode( cb, prSetGlobal );
+			cpCode( cb, cpGetCP(cb) );
+			cpCode( cb, depth );
+		}
+		cpConst( cb, mcCar(e) );
+		break;
+
+	default:
+		/* push the symbol to be defined */
+		cpCode( cb, prPushConst );
+		cpCode( cb, cpGetCP(cb) );
+		cpConst( cb, mcCar(e) );
 
-   cpCode( cb, prSet );
+		/* compile the expression */
+		cpCompile( cb, mcCadr(e), FALSE );
+
+		cpCode( cb, prSet );
+		break;
+   }
 }
 
 /* cpDumpBC(n) -- Given a byte-code node, dumps it's contents. */
@@ -580,7 +973,7 @@ CONS n;
    printf("\n\nConstants:\n");
    for ( l = 0; l < mcBC_CCSize(n); ++l ) {
 	printf("%u = ", l);
-	mcWrite( *(mcBC_Const(n)+l), currout );
+	mcWrite( *(mcBC_Const(n)+l), STDOUT );
 	printf("\n");
    }
 }
@@ -2,3 +2,7 @@
 
 void InitComp( C_INT X C_CHAR C_PTR C_ARRAY );
 CONS mcCompile( C_CONS );
+void mcAnalyze( C_CONS );
+
+extern int cp_analyze;
+extern long cp_gen;
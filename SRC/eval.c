@@ -1,6 +1,85 @@
 /* eval.c - Scheme Evaluation Routine
 	written by Jason Coughlin (jk0@sun.soe.clarkson.edu)
 
+   Version 8 (jk0) Global references in byte-code
+
+	- prPushVar looked in every frame before it looked in the global
+	vector, even for CFIB or + in a compiled body.  The compiler knows
+	which variables are parameters and how many frames are in scope
+	(compile.c).  prPushGlobal and prSetGlobal check that there's no
+	frame beyond those, then go straight to the symbol's slot in the
+	global vector.  prSetLocal stores into a parameter's frame slot.
+	Analyzed code knows all its frames, so prPushGlo and prSetGlo
+	don't even check.
+
+   Version 7 (jk0) Hashed macro table
+
+	- Every combination the interpreter evaluated searched the whole
+	*EXPANSION-TABLE* a-list for its car, though (CAR X) and (+ A B)
+	are never macro calls.  Now the pairs of the a-list are also in
+	MAC_TABLE, hashed by symbol #, and the symbol table has a bit for
+	each symbol that's the name of one (mcSym_Macro()).  A head
+	without the bit costs one test; one with it searches a bucket.
+
+	- *EXPANSION-TABLE* is still the a-list, for Scheme code that
+	reads it.  evDefGlobal() calls evMacroTable() whenever it's
+	rebound.  MACRO conses one pair on the front and only that pair
+	is added; anything else makes the table again from the a-list.
+
+   Version 6 (jk0) Memoized expansions
+
+	- A macro call used to be expanded every time it was evaluated, so
+	a COND or LET in a loop called its expander once per iteration.
+	evExpandOnce() now remembers the expansion of each form in
+	EXP_CACHE (micro.h), keyed by the form itself -- the same CONS,
+	not an EQUAL? one -- and evaluates the remembered expansion the
+	next time.  An entry is only used if the form's car and cdr are
+	still what they were, so SET-CAR! on a form re-expands it.  The
+	cache is 2-way: a form can be in either of 2 entries, so 2 hot
+	forms that hash alike don't keep evicting each other.
+
+	- Redefining a macro (opResMacro()) or rebinding *EXPANSION-TABLE*
+	(evMacroTable()) empties the cache.  Changing a function an
+	expander calls doesn't: an expander is assumed to give the same
+	expansion for the same form.  (EXPAND-STATS) returns the # of hits
+	and misses.
+
+   Version 5 (jk0) Frames
+
+	- The nested env is a chain of frames instead of an A-LIST (see
+	micro.h).  Calling a closure makes one frame, a VECTOR with a
+	slot for each parameter, instead of consing 2 cells per argument.
+	A closure without parameters doesn't make a frame at all, and one
+	with up to 3 makes a single cell (VECT_CLS in memory.c).
+
+	- The interpreter still looks variables up by name, a frame at a
+	time (evAccNested()), which is what EVAL, SET! and the debugging
+	dumps need.  Byte-code -- compiled or pre-analyzed -- knows where
+	each parameter it can see is: prPushLocal has how many frames out
+	it is and its slot.  That's O( depth ), no matter how many
+	variables are in the frames between.
+
+	- Continuations, execution points, closures and RESTOREs save the
+	frame; frames are never changed except by SET!, just as the
+	A-LIST wasn't.
+
+   Version 4 (jk0) Pre-analyzed closures
+
+	- The first time an interpreted closure is called, mcAnalyze()
+	(compile.c) tries to compile its body.  If it can, the closure
+	runs the byte-code from then on; the interpreter doesn't look at
+	its expressions again.  (IFIB 30) goes from 1.27s to 0.63s, about
+	what the compiled CFIB takes (0.60s).
+
+	- A closure call in byte-code pushes a MARK under the args.  If the
+	function turns out to be a primitive, prCall checks the # of args
+	and takes the MARK back out if it doesn't take a variable #.
+
+	- prPopVal throws the value away.  It used to push it on the
+	function stack.
+
+	- LOAD breaks out of the byte-code like EVAL does.
+
    Version 3 (jk0) New environments
 
 	- Environments are broken into 2 pieces: a nested env which holds
@@ -17,7 +96,8 @@
 	- The global env's bindings are actually stored in a vector indexed
 	by the symbol.  A symbol is no longer a pointer to the string but
 	the index in the symbol table.  For both the interpreter and the
-	compiler, lookup of bindings in the global env is O( k ).
+	compiler, lookup of bindings in the global env is O( k ).  (The
+	vector grows with the symbol table -- see evDefGlobal().)
 
 	- Net effect on lookup of variables:
 		interpreter: O( |nested_env| ).
@@ -106,16 +186,20 @@
 #include "preds.h"
 #include "forms.h"
 #include "predefs.h"
+#include "compile.h"
 
 /* global variables */
 int eval_debug;
+long ev_exp_hits, ev_exp_misses;	/* expansion cache stats */
 
 /* the function lookup table for the byte-code interpreter */
 static void (*BOPS[NUM_FUNCS])( C_VOID );
 
 /* local support routines */
 static CONS evEvalAtom( C_CONS );
+static void evGrowGlobal( C_CONS X C_INT );
 static void evCountArgs( C_CONS );
+static void evMarkArgs( C_CONS );
 static CONS evBindArgs( C_CONS X C_CONS );
 static CONS evBindFormArgs( C_CONS X C_CONS );
 static void evInvokeUserFunc( C_CONS X C_CONS X C_CONS );
@@ -129,6 +213,8 @@ static void evSaveExe( C_INT X C_CONS );
 
 static int evExpandOnce( C_CONS );
 static void evResExpand( C_VOID );
+static void evCacheExpand( C_CONS X C_CONS );
+static void evAddMacro( C_CONS );
 
 static void mcDumpStacks( C_VOID );
 static void mcDumpStack( C_CONS C_PTR X C_CONS C_ARRAY );
@@ -165,21 +251,111 @@ char *argv[];
 void evDefGlobal( sym, val )
 CONS sym, val;
 {
+   CONS old;
+
    if ( !mcSymbol(sym) ) {
 	RT_LERROR("Non-symbol passed to evDefGlobal(): ", sym);
    }
 
+   if ( mcGet_Int(sym) >= (int)mcVect_Size( mcGet_Global(glo_env) ) )
+	evGrowGlobal( glo_env, mcGet_Int(sym) );
+
+   /* analyzed code calls the primitives and forms that were bound when
+    * it was made (see mcAnalyze()).
+    */
+   old = *mcVect_Ref( mcGet_Global(glo_env), mcGet_Int(sym) );
+   if ( (old != NULL && (mcFunc(old) || mcForm(old) || mcUserForm(old))) ||
+	mcForm(val) || mcUserForm(val) )
+	++cp_gen;
+
+   SBarrier( *mcVect_Ref(mcGet_Global(glo_env), mcGet_Int(sym)) );
    *mcVect_Ref( mcGet_Global(glo_env), mcGet_Int(sym) ) = val;
+   WBarrier( mcGet_Global(glo_env), val );
+
+   /* the macro table has to match the a-list */
+   if ( mcSym_No(sym) == mcSym_No(EXP_TABLE) )
+	evMacroTable( val );
+}
+
+/* evGrowGlobal(env, sym) - The global vector of env is too small to bind
+	symbol # sym.  Replace it with one twice as big (or more) with the
+	same bindings.
+*/
+static void evGrowGlobal(env, sym)
+CONS env;
+int sym;
+{
+   CONS old, new;
+   int size, i;
+
+   for ( size = 2 * mcVect_Size( mcGet_Global(env) ); size <= sym; size *= 2 )
+	;
+
+   new = NewCons( VECTOR, size, 0 );
+   old = mcGet_Global(env);
+
+   /* new is the youngest there is; no write barrier for the copy */
+   for ( i = 0; i < (int)mcVect_Size(old); ++i )
+	*mcVect_Ref(new, i) = *mcVect_Ref(old, i);
+   for ( ; i < size; ++i )
+	*mcVect_Ref(new, i) = NULL;
+
+   SBarrier( mcGet_Global(env) );
+   mcGet_Global(env) = new;
+   WBarrier( env, new );
 }
 
-/* evAccNested(sym, env) -- Return the nested binding for sym in env.
-	Returns NIL if no binding exists.  NOTE: This function returns
-	A-LIST dotted-pairs!
+/* evAccNested(sym, env) -- Return the slot holding the nested binding for
+	sym in env.  Returns NULL if no binding exists.  NOTE: Stores into
+	the slot need barriers; use evSetNested().
 */
-CONS evAccNested(sym, env)
+CONS *evAccNested(sym, env)
 CONS sym, env;
 {
-   return mcQAssoc( sym, mcGet_Nested(env) );
+   CONS frame;
+   int i;
+
+   for ( frame = mcGet_Nested(env); !mcNull(frame); frame = mcFrame_Up(frame) )
+	if ( (i = evFrameIndex( mcFrame_Parms(frame), sym )) >= 0 )
+		return mcFrame_Ref( frame, i );
+
+   return NULL;
+}
+
+/* evSetNested(sym, val, env) -- Set the nested binding for sym in env to
+	val.  Returns FALSE if no binding exists.
+*/
+int evSetNested(sym, val, env)
+CONS sym, val, env;
+{
+   CONS frame;
+   int i;
+
+   for ( frame = mcGet_Nested(env); !mcNull(frame); frame = mcFrame_Up(frame) )
+	if ( (i = evFrameIndex( mcFrame_Parms(frame), sym )) >= 0 ) {
+		SBarrier( *mcFrame_Ref(frame, i) );
+		*mcFrame_Ref(frame, i) = val;
+		WBarrier( frame, val );
+		return TRUE;
+	}
+
+   return FALSE;
+}
+
+/* evFrameIndex(parms, sym) -- Returns the slot sym is bound in by a frame
+	for the parameter list parms, or -1 if it isn't.  The last
+	parameter of (a b . c) has the rest of the args.
+*/
+int evFrameIndex(parms, sym)
+CONS parms, sym;
+{
+   int i;
+
+   for ( i = 0; mcPair(parms); parms = mcCdr(parms), ++i )
+	if ( mcCar(parms) == sym )
+		return i;
+
+   return ( parms == sym && !mcNull(parms) ) ? i : -1;
 }
 
 /* evAccGlobal(sym, env) - Return the global binding of sym in env.
@@ -189,6 +365,10 @@ CONS sym, env;
 CONS evAccGlobal(sym, env)
 CONS sym, env;
 {
+   /* symbols added since the vector last grew aren't bound */
+   if ( mcGet_Int(sym) >= (int)mcVect_Size( mcGet_Global(env) ) )
+	return NULL;
+
    return *mcVect_Ref( mcGet_Global(env), mcGet_Int(sym) );
 }
 
@@ -317,26 +497,57 @@ CONS func;
    ERROR;
 }
 
+/* evMarkArgs(func) - Byte-code calls a function it didn't know was a
+	primitive like a closure, with a MARK under the args.  Check the
+	# of args like evCountArgs() does, and take the MARK out unless
+	func takes a variable #.
+*/
+static void evMarkArgs(func)
+CONS func;
+{
+   int num;
+   CONS *curr;
+
+   num = 0;
+   for ( curr = Top_Val; curr > ValStack && *curr != MARK ; --curr )
+	++num;
+
+   if ( !((mcPrim_RA(func) == num ) ||
+	  (mcPrim_AA(func) >= mcPrim_RA(func) && num == mcPrim_AA(func)) ||
+	  (mcPrim_AA(func) < mcPrim_RA(func)  && num >= mcPrim_RA(func))) ) {
+	/* wrong # of args */
+	fprintf(currout, "\nError: EVAL: Wrong # of args to primitive procedure %s: ", mcPrim_Name(func));
+	fprintf(currout, "\n\n");
+	ERROR;
+   }
+
+   if ( mcPrim_RA(func) == mcPrim_AA(func) ) {
+	/* slide the args down over the MARK */
+	mcTouchVal( curr );
+	for ( ; curr < Top_Val; ++curr )
+		*curr = *(curr + 1);
+	(void)mcPopVal();
+   }
+}
+
 /* evGatherVal() - Gathers the arguments on the ValStack into a list.  There
 	better be a MARK on the val stack.
 */
 CONS evGatherVal()
 {
-   ENTER;
-   REG(exp);
-   REG(args);
-
-   R(args) = NIL;
-   R(exp) = mcPopVal();
-   while ( R(exp) != MARK ) {
-	R(args) = mcCons( R(exp), R(args) );
-	R(exp) = mcPopVal();
+   CONS exp, args;
+
+   args = NIL;
+   exp = mcPopVal();
+   while ( exp != MARK ) {
+	args = mcCons( exp, args );
+	exp = mcPopVal();
    }
 
    /* have to reverse the list */
-   R(args) = mcRev( R(args) );
+   args = mcRev( args );
 
-   MCLEAVE R(args);
+   return args;
 }
 
 /* evGatherExpr() - Gathers the arguments on the ExprStack into a list.  There
@@ -344,18 +555,16 @@ CONS evGatherVal()
 */
 CONS evGatherExpr()
 {
-   ENTER;
-   REG(exp);
-   REG(args);
-
-   R(args) = NIL;
-   R(exp) = mcPopExpr();
-   while ( R(exp) != CALL ) {
-	R(args) = mcCons( R(exp), R(args) );
-	R(exp) = mcPopExpr();
+   CONS exp, args;
+
+   args = NIL;
+   exp = mcPopExpr();
+   while ( exp != CALL ) {
+	args = mcCons( exp, args );
+	exp = mcPopExpr();
    }
 
-   MCLEAVE R(args);
+   return args;
 }
 
 /* ----------------------------------------------------------------------- */
@@ -374,12 +583,18 @@ CONS evGatherExpr()
 static void evInvokeUserFunc( parms, body, env )
 CONS parms, body, env;
 {
+   CONS n_env;
+
    EV_DEBUG("\nIn evInvokeUserFunc, parms = ", parms);
    EV_DEBUG("\n\tbody = ", body );
 
-   /* (2) Bind args to parms (extend the environment) */
+   /* (2) Bind args to parms (extend the environment).  the barrier has
+    * to come after evBindArgs() since it can start a GC.
+    */
    evSaveEnv();
-   mcGet_Nested(glo_env) = evBindArgs( parms, env );
+   n_env = evBindArgs( parms, env );
+   SBarrier( mcGet_Nested(glo_env) );
+   mcGet_Nested(glo_env) = n_env;
 
    /* (3) Evaluate the body. */
    if ( mcExe(body) || mcCode(body) ) {
@@ -399,8 +614,8 @@ CONS parms, body, env;
 }
 
 /* evBindArgs(parms, env) - This is to bind the paramters to the arguments for
-	user defined functions.  The args are popped off of the value stack.
-	Returns the extended environment.
+	user defined functions.  The args are popped off of the value stack
+	into a new frame.  Returns the extended environment.
 
 	NOTATION:
 
@@ -409,66 +624,59 @@ CONS parms, body, env;
 static CONS evBindArgs(p, e)
 CONS p, e;
 {
-   ENTER;
-   REG(var);
-   REG(value);
-   REG(n_env);
-   REG(parms);
-
-   R(parms) = p;
-   R(n_env) = e;
+   CONS frame, parms, rest;
+   CONS *curr;
+   int nargs, nparms, i;
 
    EV_DEBUG("\nIn evBindArgs, parms = ", p);
 
-   /* Bind arguments to the parameters. */
-   while ( !mcNull( R(parms) ) ) {
-
-	/* handle atom parm-spec && improper list */
-	if ( mcAtom( R(parms) ) ) {
-		/* gather the rest of the args into a list, and bind this
-		 * list to the last parameter.
-		 */
-		R(var) = evGatherVal();
-		R(var) = mcCons( R(parms), R(var) );
-
-		/* add binding to environment */
-		R(n_env) = mcCons( R(var), R(n_env) );
-
-		/* done binding */
-		MCLEAVE R(n_env);
-	}
-
-	/* get the next argument */
-	R(value) = mcPopVal();
-
-	/* run out of arguments? */
-	if ( R(value) == MARK )
-		break;
-
-	/* strip off first variable name */
-	R(var) = mcCar( R(parms) );
-	R(parms) = mcCdr( R(parms) );
-
-	/* make binding */
-	R(var) = mcCons( R(var), R(value) );
+   /* count the args down to the MARK, and the parameters before the
+    * one for the rest of the args, if there is one.
+    */
+   nargs = 0;
+   for ( curr = Top_Val; curr > ValStack && *curr != MARK; --curr )
+	++nargs;
 
-	/* add binding to environment */
-	R(n_env) = mcCons( R(var), R(n_env) );
-   }
+   nparms = 0;
+   for ( parms = p; mcPair(parms); parms = mcCdr(parms) )
+	++nparms;
 
    /* #parms == #args */
-   if ( R(value) == MARK ) {
+   if ( nargs < nparms ) {
 	RT_ERROR("Too few args in call to function.");
    }
-   else if ( mcValStackTop() != MARK  ) {
+   else if ( nargs > nparms && mcNull(parms) ) {
 	RT_ERROR("Too many args in call to function.");
    }
 
-   /* pop MARK off the value stack */
-   (void)mcPopVal();
+   /* no parameters, no frame */
+   if ( mcNull(p) ) {
+	(void)mcPopVal();
+	return e;
+   }
+
+   frame = NewCons( VECTOR, FRAME_HEAD + nparms + !mcNull(parms), 0 );
+   mcFrame_Up(frame) = e;
+   mcFrame_Parms(frame) = p;
+
+   /* Bind arguments to the parameters. */
+   for ( i = 0; i < nparms; ++i )
+	*mcFrame_Ref(frame, i) = mcPopVal();
+
+   if ( mcNull(parms) ) {
+	/* pop MARK off the value stack */
+	(void)mcPopVal();
+   } else {
+	/* gather the rest of the args into a list, and bind this
+	 * list to the last parameter.  the frame may be old by now.
+	 */
+	rest = evGatherVal();
+	*mcFrame_Ref(frame, nparms) = rest;
+	WBarrier( frame, rest );
+   }
 
    EV_DEBUG("\nBound args.\n", NIL);
-   MCLEAVE R(n_env);
+   return frame;
 }
 
 /* ----------------------------------------------------------------------- */
@@ -479,13 +687,16 @@ CONS p, e;
 static void evInvokeUserForm(parms, body)
 CONS parms, body;
 {
+   CONS n_env;
 
    EV_DEBUG("\nIn evInvokeUserForm, parms = ", parms);
    EV_DEBUG("\n\tbody = ", body );
 
    /* Bind args to parms (extend the environment) */
    evSaveEnv();
-   mcGet_Nested(glo_env) = evBindFormArgs( parms, mcGet_Nested(glo_env) );
+   n_env = evBindFormArgs( parms, mcGet_Nested(glo_env) );
+   SBarrier( mcGet_Nested(glo_env) );
+   mcGet_Nested(glo_env) = n_env;
 
    /* Evaluate the body. */
    if ( mcExe(body) || mcCode(body) ) {
@@ -511,58 +722,48 @@ CONS parms, body;
 static CONS evBindFormArgs(p, e)
 CONS p, e;
 {
-   ENTER;
-   REG(var);
-   REG(value);
-   REG(n_env);
-   REG(parms);
-
-   R(parms) = p;
-   R(n_env) = e;
+   CONS frame, value, parms;
+   int nparms, i;
 
    EV_DEBUG("\nIn evBindFormArgs, parms = ", p);
 
-   /* Bind arguments to the parameters. */
-   while ( !mcNull( R(parms) ) ) {
-
-	/* handle atom parm-spec && improper list */
-	if ( mcAtom( R(parms) ) ) {
-		/* gather the rest of the args into a list, and bind this
-		 * list to the last parameter.
-		 */
-		R(var) = evGatherExpr();
-		R(var) = mcCons( R(parms), R(var) );
-
-		/* add binding to environment */
-		R(n_env) = mcCons( R(var), R(n_env) );
+   nparms = 0;
+   for ( parms = p; mcPair(parms); parms = mcCdr(parms) )
+	++nparms;
 
-		/* done binding */
-		MCLEAVE R(n_env);
-	}
+   frame = NewCons( VECTOR, FRAME_HEAD + nparms + !mcNull(parms), 0 );
+   mcFrame_Up(frame) = e;
+   mcFrame_Parms(frame) = p;
+   value = NIL;
 
+   /* Bind arguments to the parameters. */
+   for ( i = 0, parms = p; mcPair(parms); parms = mcCdr(parms), ++i ) {
 	/* get the next argument */
-	R(value) = mcPopExpr();
+	value = mcPopExpr();
 
 	/* run out of arguments? */
-	if ( R(value) == CALL )
+	if ( value == CALL )
 		break;
 
-	/* strip off first variable name */
-	R(var) = mcCar( R(parms) );
-	R(parms) = mcCdr( R(parms) );
-
-	/* make binding */
-	R(var) = mcCons( R(var), R(value) );
+	*mcFrame_Ref(frame, i) = value;
+   }
 
-	/* add binding to environment */
-	R(n_env) = mcCons( R(var), R(n_env) );
+   /* handle atom parm-spec && improper list */
+   if ( !mcNull( parms ) && !mcPair( parms ) ) {
+	/* gather the rest of the args into a list, and bind this
+	 * list to the last parameter.  the frame may be old by now.
+	 */
+	value = evGatherExpr();
+	*mcFrame_Ref(frame, nparms) = value;
+	WBarrier( frame, value );
+	return frame;
    }
 
    /* #parms == #args */
-   if ( !mcNull( R(parms) ) || R(value) != CALL )
+   if ( !mcNull( parms ) || value != CALL )
 	RT_ERROR("Wrong number of args in call to form.");
 
-   MCLEAVE R(n_env);
+   return frame;
 }
 
 /* ----------------------------------------------------------------------- */
@@ -576,13 +777,12 @@ CONS p, e;
 static void evInvokeCont(c)
 CONS c;
 {
-   ENTER;
-   REG(val);
+   CONS val;
 
    assert( mcCont(c) );
 
    /* value to return */
-   R(val) = mcPopVal();
+   val = mcPopVal();
 
    /* restore the stacks */
    mcRestExpr( mcCont_Exp(c) );
@@ -590,10 +790,10 @@ CONS c;
    mcRestFunc( mcCont_Fnc(c) );
 
    /* restore environment */
+   SBarrier( mcGet_Nested(glo_env) );
    mcGet_Nested(glo_env) = mcCont_Env(c);
 
-   mcPushVal( R(val) );
-   MCLEAVE;
+   mcPushVal( val );
 }
 
 /* ----------------------------------------------------------------------- */
@@ -617,13 +817,9 @@ int pr;
 static void evInvokeForm(f)
 CONS f;
 {
-   ENTER;
-   REG(form);
-   R(form) = f;
-
    /* make sure the user really is invoking a special form */
    if ( mcExprStackTop() != PUSHFUNC ) {
-	MCLEAVE;
+	return;
    }
 
    /* pop the PUSHFUNC off the expression stack */
@@ -637,7 +833,7 @@ CONS f;
 	 * environment that the form was defined in.
 	 */
 	evInvokeUserForm( mcForm_Parms(f), mcForm_Body(f) );
-	MCLEAVE;
+	return;
    }
 
    /* evaluating a primitive special form */
@@ -650,7 +846,6 @@ CONS f;
 
    /* invoke the special form */
    (*mcPrim_Op(f))();
-   MCLEAVE;
 }
 
 /* ----------------------------------------------------------------------- */
@@ -726,6 +921,7 @@ static CONS evEvalAtom( atom )
 CONS atom;
 {
    CONS binding;
+   CONS *slot;
 
    /* (eval #T) => #T && (eval #F) => #F && (eval number) => number */
    if ( atom == T  || atom == F || mcNumber(atom) )
@@ -739,11 +935,9 @@ CONS atom;
 	RT_LERROR("EVAL: Can't evaluate non-symbol: ", atom);
 
    /* (eval symbol) => symbol's-binding */
-   binding = evAccNested( atom, glo_env );
-   if ( !mcNull(binding) ) {
-	/* symbol's-binding = cdr(binding) [remember they're dps!] */
-	binding = mcCdr( binding );
-	return binding;
+   slot = evAccNested( atom, glo_env );
+   if ( slot != NULL ) {
+	return *slot;
    }
    else if ( (binding = evAccGlobal( atom, glo_env )) != NULL ) {
 	return binding;
@@ -761,10 +955,8 @@ CONS atom;
 */
 void evEval()
 {
-   ENTER;
-
-   REG(exp);		/* expression to evaluate */
-   REG(func);		/* function to invoke */
+   CONS exp;		/* expression to evaluate */
+   CONS func;		/* function to invoke */
 
    /* Keep evaluating until there are no more expressions to evaluate */
    while ( mcHaveExprs() ) {
@@ -774,31 +966,31 @@ void evEval()
 		mcDumpStacks();
 
 	/* evaluate the expression on top of the expression stack */
-	R(exp) = mcPopExpr();
+	exp = mcPopExpr();
 
-	EV_DEBUG("\nExp to eval = ", R(exp) );
+	EV_DEBUG("\nExp to eval = ", exp );
 
-	if ( R(exp) == NIL ) {
+	if ( exp == NIL ) {
 		/* the Scheme standard says that () is an ILLEGAL SYNTAX
 		 * form, but for compatability with other Scheme's
 		 * (eval ()) => ()
 		 */
-		mcPushVal( R(exp) );
+		mcPushVal( exp );
 	}
-	else if ( R(exp) == PUSHFUNC ) {
+	else if ( exp == PUSHFUNC ) {
 		/* pop function off the value stack,
 		 * push it onto the function stack,
 		 * if it's a primitive var-args function then push MARK
 		 */
-		R(func) = mcPopVal();
-		mcPushFunc( R(func) );
+		func = mcPopVal();
+		mcPushFunc( func );
 
-		if ( mcFunc(R(func)) ) {
+		if ( mcFunc(func) ) {
 			/* make sure there are the correct # of args */
-			evCountArgs( R(func) );
+			evCountArgs( func );
 
 			/* if it's var-args then push a MARK */
-			if ( mcPrim_RA(R(func)) != mcPrim_AA(R(func)) )
+			if ( mcPrim_RA(func) != mcPrim_AA(func) )
 				mcPushVal( MARK );
 		} else {
 			/* user defined functions MUST have a MARK.  the
@@ -807,44 +999,45 @@ void evEval()
 			mcPushVal( MARK );
 		}
 	}
-	else if ( R(exp) == CALL ) {
+	else if ( exp == CALL ) {
 		/* pop the function off the function stack, and
 		 * apply it.
 		 */
-		R(func) = mcPopFunc();
+		func = mcPopFunc();
 
-		EV_DEBUG("\nInvoking func: ", R(func) );
+		EV_DEBUG("\nInvoking func: ", func );
 
 		/* apply func to it's arguments */
-		evApply( R(func) );
+		evApply( func );
 	}
-	else if ( mcCode(R(exp)) || mcExe(R(exp)) ) {
+	else if ( mcCode(exp) || mcExe(exp) ) {
 		/* executing byte-code */
-		evInvokeBC( R(exp) );
+		evInvokeBC( exp );
 	}
-	else if ( R(exp) == RESTORE ) {
+	else if ( exp == RESTORE ) {
 
 		EV_DEBUG("\tRestoring previous environment.", NIL);
 
 		/* restore previous environment */
+		SBarrier( mcGet_Nested(glo_env) );
 		mcGet_Nested(glo_env) = mcPopExpr();
 	}
-	else if ( mcResume( R(exp) ) ) {
+	else if ( mcResume( exp ) ) {
 
 		/* resume a func or form */
-		evInvokeRes( R(exp) );
+		evInvokeRes( exp );
 	}
-	else if ( mcAtom( R(exp) ) ) {
+	else if ( mcAtom( exp ) ) {
 
 		/* evaluate an atom */
-		R(exp) = evEvalAtom( R(exp) );
+		exp = evEvalAtom( exp );
 
 		/* invoke a special form before it's args are
 		 * evaluated.
 		 */
-		if ( mcForm( R(exp) ) || mcUserForm( R(exp) ) )
-			evInvokeForm( R(exp) );
-		else mcPushVal( R(exp) );
+		if ( mcForm( exp ) || mcUserForm( exp ) )
+			evInvokeForm( exp );
+		else mcPushVal( exp );
 	}
 	else {
 		/* evaluate list of expressions */
@@ -854,20 +1047,20 @@ void evEval()
 		/* does the current expression need to be expanded?  if so,
 		 * we need to skip evaluating it.
 		 */
-		if ( evExpandOnce( R(exp) ) )
+		if ( evExpandOnce( exp ) )
 			continue;
 
 		/* mark place on expr stack */
 		mcPushExpr( CALL );
 
 		/* separate function from args  */
-		R(func) = mcCar( R(exp) );
-		R(exp) = mcCdr( R(exp) );
+		func = mcCar( exp );
+		exp = mcCdr( exp );
 
 		/* push args onto expr stack */
-		while ( !mcNull( R(exp) ) ) {
-			mcPushExpr( mcCar( R(exp) ) );
-			R(exp) = mcCdr( R(exp) );
+		while ( !mcNull( exp ) ) {
+			mcPushExpr( mcCar( exp ) );
+			exp = mcCdr( exp );
 		}
 
 		/* push PUSHFUNC so function will be moved to func
@@ -876,10 +1069,9 @@ void evEval()
 		mcPushExpr( PUSHFUNC );
 
 		/* push function/form to be evaluated */
-		mcPushExpr( R(func) );
+		mcPushExpr( func );
 	}
    }
-   MCLEAVE;
 }
 
 /* ----------------------------------------------------------------------- */
@@ -895,6 +1087,20 @@ CONS func;
    EV_DEBUG( "\nIn evApply, func = ", func );
 
    if ( mcClosure(func) ) {
+	/* pre-analyze an interpreted closure the first time it's called,
+	 * and again if what the analysis saw has changed since.
+	 */
+	if ( mcPair( mcCl_Body(func) ) ) {
+		if ( mcNull( mcCl_Code(func) ) ||
+		     (mcCode( mcCl_Code(func) ) && mcBC_Gen( mcCl_Code(func) ) != cp_gen) )
+			mcAnalyze( func );
+
+		if ( mcCode( mcCl_Code(func) ) ) {
+			evInvokeUserFunc( mcCl_Parms(func), mcCl_Code(func), mcCl_Env(func) );
+			return;
+		}
+	}
+
 	/* invoke a user defined function */
 	EV_DEBUG("\n\tIn evApply, calling evInvokeUserFunc.", NIL);
 	evInvokeUserFunc( mcCl_Parms(func), mcCl_Body(func), mcCl_Env(func) );
@@ -927,11 +1133,13 @@ static void evInvokeBC(bc)
 CONS bc;
 {
    CONS sym, temp;
+   CONS *slot;
    unsigned char op;
    unsigned int pc;
 
    if ( mcExe(bc) ) {
 	/* execution point => restoring environment, byte-code, and pc */
+	SBarrier( mcGet_Nested(glo_env) );
 	mcGet_Nested(glo_env) = mcExe_Env(bc);
 	pc = mcExe_PC(bc);
 	bc = mcExe_BC(bc);
@@ -979,9 +1187,9 @@ CONS bc;
 		op = *(mcBC_Code(bc)+pc);
 		sym = *(mcBC_Const(bc)+op);
 
-		temp = evAccNested( sym, glo_env );
-		if ( !mcNull(temp) )
-			mcPushVal( mcCdr(temp) );
+		slot = evAccNested( sym, glo_env );
+		if ( slot != NULL )
+			mcPushVal( *slot );
 		else if ( (temp = evAccGlobal( sym, glo_env )) != NULL )
 			mcPushVal( temp );
 		else {
@@ -992,6 +1200,112 @@ CONS bc;
 		++pc;
 		break;
 
+	   case prPushLocal:
+		/* a parameter: how many frames out, then its slot */
+		temp = mcGet_Nested(glo_env);
+		for ( op = *(mcBC_Code(bc)+pc); op > 0; --op )
+			temp = mcFrame_Up(temp);
+		mcPushVal( *mcFrame_Ref(temp, *(mcBC_Code(bc)+pc+1)) );
+
+		/* increment pc beyond depth and slot */
+		pc += 2;
+		break;
+
+	   case prPushGlobal:
+		/* a global, if there's no frame beyond the ones in scope.
+		 * then it's in the global vector at the symbol's #.
+		 */
+		sym = *(mcBC_Const(bc) + *(mcBC_Code(bc)+pc));
+		temp = mcGet_Nested(glo_env);
+		for ( op = *(mcBC_Code(bc)+pc+1); op > 0; --op )
+			temp = mcFrame_Up(temp);
+
+		if ( mcNull(temp) )
+			temp = evAccGlobal( sym, glo_env );
+		else if ( (slot = evAccNested( sym, glo_env )) != NULL )
+			temp = *slot;
+		else temp = evAccGlobal( sym, glo_env );
+
+		if ( temp == NULL ) {
+			RT_LERROR("EVAL: Undefined symbol ", sym);
+		}
+		mcPushVal( temp );
+
+		/* increment pc beyond constant table pntr and depth */
+		pc += 2;
+		break;
+
+	   case prSetGlobal:
+		/* SET! a global, checked like prPushGlobal */
+		sym = *(mcBC_Const(bc) + *(mcBC_Code(bc)+pc));
+		temp = mcGet_Nested(glo_env);
+		for ( op = *(mcBC_Code(bc)+pc+1); op > 0; --op )
+			temp = mcFrame_Up(temp);
+
+		if ( mcNull(temp) && evAccGlobal( sym, glo_env ) != NULL ) {
+			evDefGlobal( sym, mcPopVal() );
+			mcPushVal( sym );
+		} else {
+			/* bcSet() wants the symbol under the value */
+			temp = mcPopVal();
+			mcPushVal( sym );
+			mcPushVal( temp );
+			bcSet();
+		}
+
+		/* increment pc beyond constant table pntr and depth */
+		pc += 2;
+		break;
+
+	   case prPushGlo:
+		/* a global in code that knows all its frames */
+		sym = *(mcBC_Const(bc) + *(mcBC_Code(bc)+pc));
+		if ( (temp = evAccGlobal( sym, glo_env )) == NULL ) {
+			RT_LERROR("EVAL: Undefined symbol ", sym);
+		}
+		mcPushVal( temp );
+
+		/* increment pc beyond constant table pntr */
+		++pc;
+		break;
+
+	   case prSetGlo:
+		/* SET! a global in code that knows all its frames */
+		sym = *(mcBC_Const(bc) + *(mcBC_Code(bc)+pc));
+		if ( evAccGlobal( sym, glo_env ) != NULL ) {
+			evDefGlobal( sym, mcPopVal() );
+			mcPushVal( sym );
+		} else {
+			/* bcSet() reports it; it wants the symbol under
+			 * the value.
+			 */
+			temp = mcPopVal();
+			mcPushVal( sym );
+			mcPushVal( temp );
+			bcSet();
+		}
+
+		/* increment pc beyond constant table pntr */
+		++pc;
+		break;
+
+	   case prSetLocal:
+		/* SET! a parameter: how many frames out, its slot, and
+		 * the symbol SET! returns.
+		 */
+		temp = mcGet_Nested(glo_env);
+		for ( op = *(mcBC_Code(bc)+pc); op > 0; --op )
+			temp = mcFrame_Up(temp);
+		slot = mcFrame_Ref(temp, *(mcBC_Code(bc)+pc+1));
+		SBarrier( *slot );
+		*slot = mcPopVal();
+		WBarrier( temp, *slot );
+		mcPushVal( *(mcBC_Const(bc) + *(mcBC_Code(bc)+pc+2)) );
+
+		/* increment pc beyond depth, slot and constant table pntr */
+		pc += 3;
+		break;
+
 	   case prReturn:
 		/* forced return from byte-code */
 		return;
@@ -1011,15 +1325,18 @@ CONS bc;
 		break;
 
 	   case prPopVal:
-		/* pop closure off val stack and push onto func stack */
-		temp = mcPopVal();
-		mcPushFunc( temp );
+		/* throw away the value of an expression in a sequence */
+		(void)mcPopVal();
 		break;
 
 	   case prMakeClosure:
 		opMakeClosure();
 		break;
 
+	   case prMakeAnalyzed:
+		opMakeAnalyzed();
+		break;
+
 	   case prPushMark:
 		mcPushVal( MARK );
 		break;
@@ -1032,26 +1349,29 @@ CONS bc;
 
 	   case prCall:
 		/* invoke a compiled user function */
+		if ( mcFunc( *Top_Func ) )
+			evMarkArgs( *Top_Func );
+
 		evSaveExe(pc,bc);
 		mcPushExpr( CALL );
 
 		return;
 
 	   default:
-		/* eval, apply, and call/cc require a break from the
-		 * byte-code to perform an evaluation -- use bcCall to
+		/* eval, apply, call/cc, and load require a break from
+		 * the byte-code to perform an evaluation -- use bcCall to
 		 * setup an execution point.
 		 */
-		if ( op == prEval || op == prApply || op == prCallCC )
+		if ( op == prEval || op == prApply || op == prCallCC || op == prLoad )
 			evSaveExe(pc,bc);
 
 		/* invoke the primitive function */
 		(*BOPS[op])();
 
-		/* eval, apply, and call/cc require a break from the
-		 * byte-code to perform an evaluation.
+		/* eval, apply, call/cc, and load require a break from
+		 * the byte-code to perform an evaluation.
 		 */
-		if ( op == prEval || op == prApply || op == prCallCC )
+		if ( op == prEval || op == prApply || op == prCallCC || op == prLoad )
 			return;
 
 		break;
@@ -1090,34 +1410,54 @@ CONS bc;
 /*                      Interpreter System Expander			   */
 /* ----------------------------------------------------------------------- */
 
+/* evExpHash(e) - The first of the 2 expansion cache entries form e can
+	be in.  A program's forms are in cells close together, and cells
+	that close never share a pair of entries.
+*/
+#define evExpHash(e)	( (int)( ((unsigned long)(e) >> 4) % (EXP_SLOTS/2) ) * 2 )
+
+/* evExpHit(h, e) - Is entry h of the expansion cache form e, unchanged? */
+#define evExpHit(h, e)	( *mcExp_Ref(EXP_CACHE, (h), 0) == (e) && \
+			  *mcExp_Ref(EXP_CACHE, (h), 1) == mcCar(e) && \
+			  *mcExp_Ref(EXP_CACHE, (h), 2) == mcCdr(e) )
+
 /* evExpandOnce(e) - Expand the given expression.  Returns TRUE if an
 	expansion is required.  Returns FALSE if no expansion is being
-	performed.  Works by looking up the car of the expression in the
-	expansion a-list.
+	performed.  Works by looking up the car of the expression in
+	MAC_TABLE.  If e was expanded before, its expansion is pushed
+	straight on the ExprStack.
 */
 static int evExpandOnce(exp)
 CONS exp;
 {
-   CONS etbl;
-   CONS binding;	/* no need for a register since it points into glo_env */
-
-   /* no need to expand if the car isn't a symbol */
-   if ( mcPair( mcCar(exp) ) ) {
-	return FALSE;
-   }
+   CONS f;
+   CONS binding;
+   int h;
 
-   /* get the expansion table */
-   etbl = evAccGlobal( EXP_TABLE, glo_env );
-   if ( mcNull( etbl ) )
+   /* no need to expand unless the car is a symbol that may be a macro */
+   f = mcCar(exp);
+   if ( !mcSymbol(f) || !mcSym_Macro(f) )
 	return FALSE;
 
    /* exp is a list of the form (func arg1 ...), lookup func in table */
-   binding = mcQAssoc( mcCar(exp), etbl );
+   binding = mcQAssoc( f, *mcMac_Bucket(MAC_TABLE, f) );
    if ( !mcNull( binding ) ) {
-	/* have to invoke the expander function on the exp */
+	/* expanded this very form before? */
+	h = evExpHash( exp );
+	if ( evExpHit( h, exp ) || evExpHit( ++h, exp ) ) {
+		++ev_exp_hits;
+		mcPushExpr( *mcExp_Ref(EXP_CACHE, h, 3) );
+		return TRUE;
+	}
+	++ev_exp_misses;
+
+	/* have to invoke the expander function on the exp.  the exp
+	 * is saved under the args so evResExpand() can cache it.
+	 */
 	mcPushExpr( EXP_RESUME );
 	mcPushExpr( CALL );
 
+	mcPushVal( exp );
 	mcPushVal( MARK );
 	mcPushVal( exp );
 
@@ -1133,11 +1473,118 @@ CONS exp;
 */
 static void evResExpand()
 {
-   ENTER;
-   REG(result);
-   R(result) = mcPopVal();
-   mcPushExpr( R(result) );
-   MCLEAVE;
+   CONS result;
+   CONS exp;
+
+   result = mcPopVal();
+   exp = mcPopVal();
+
+   evCacheExpand( exp, result );
+   mcPushExpr( result );
+}
+
+/* evCacheExpand(e, r) - Remember r as the expansion of form e.  It goes
+	in the first of e's entries; what was there moves to the second.
+*/
+static void evCacheExpand(exp, result)
+CONS exp, result;
+{
+   CONS *slot;
+   int h, f;
+
+   h = evExpHash( exp );
+
+   slot = mcExp_Ref( EXP_CACHE, h, 0 );
+   for ( f = 0; f < EXP_WIDTH; ++f ) {
+	SBarrier( slot[EXP_WIDTH + f] );
+	slot[EXP_WIDTH + f] = slot[f];
+	WBarrier( EXP_CACHE, slot[f] );
+   }
+
+   SBarrier( slot[0] );
+   SBarrier( slot[1] );
+   SBarrier( slot[2] );
+   SBarrier( slot[3] );
+   slot[0] = exp;
+   slot[1] = mcCar( exp );
+   slot[2] = mcCdr( exp );
+   slot[3] = result;
+   WBarrier( EXP_CACHE, exp );
+   WBarrier( EXP_CACHE, slot[1] );
+   WBarrier( EXP_CACHE, slot[2] );
+   WBarrier( EXP_CACHE, result );
+}
+
+/* evFlushExpand() - Forget every remembered expansion.  Called when a
+	macro is redefined or *EXPANSION-TABLE* is rebound.
+*/
+void evFlushExpand()
+{
+   int i;
+
+   for ( i = 0; i < EXP_SLOTS * EXP_WIDTH; ++i ) {
+	SBarrier( *mcVect_Ref(EXP_CACHE, i) );
+	*mcVect_Ref(EXP_CACHE, i) = NIL;
+   }
+}
+
+/* evMacroTable(etbl) - *EXPANSION-TABLE* was just bound to etbl.  Make
+	MAC_TABLE and the symbols' macro bits match it.  If etbl is the
+	last table with one pair consed on, only that pair is added.
+*/
+void evMacroTable(etbl)
+CONS etbl;
+{
+   static CONS mac_etbl = NULL;	/* the a-list MAC_TABLE matches */
+   CONS l;
+   int i;
+
+   if ( mcPair(etbl) && mcCdr(etbl) == mac_etbl )
+	evAddMacro( mcCar(etbl) );
+   else {
+	ssClearMacros();
+	for ( i = 0; i < MAC_BUCKETS; ++i ) {
+		SBarrier( *mcVect_Ref(MAC_TABLE, i) );
+		*mcVect_Ref(MAC_TABLE, i) = NIL;
+	}
+
+	/* the first pair for a name is the one that counts, as with
+	 * assoc, so later ones are left out.
+	 */
+	for ( l = etbl; mcPair(l); l = mcCdr(l) )
+		if ( mcPair(mcCar(l)) && mcSymbol(mcCar(mcCar(l))) &&
+		     !mcSym_Macro(mcCar(mcCar(l))) )
+			evAddMacro( mcCar(l) );
+   }
+
+   /* mac_etbl is always the binding of *EXPANSION-TABLE*, so it's
+    * never garbage.
+    */
+   mac_etbl = etbl;
+   evFlushExpand();
+
+   /* analyzed code may call a closure by a name that's a macro now */
+   ++cp_gen;
+}
+
+/* evAddMacro(b) - Put the pair b, ( MACRO-NAME . EXPANDER-FUNCTION ), in
+	front of the others for its name in MAC_TABLE.
+*/
+static void evAddMacro(binding)
+CONS binding;
+{
+   CONS name, bucket;
+
+   if ( !mcPair(binding) || !mcSymbol(mcCar(binding)) )
+	return;
+   name = mcCar(binding);
+
+   bucket = mcCons( binding, *mcMac_Bucket(MAC_TABLE, name) );
+   SBarrier( *mcMac_Bucket(MAC_TABLE, name) );
+   *mcMac_Bucket(MAC_TABLE, name) = bucket;
+   WBarrier( MAC_TABLE, bucket );
+
+   mcSym_Macro(name) = TRUE;
 }
 
 /* ----------------------------------------------------------------------- */
@@ -1164,7 +1611,7 @@ CONS *top, stack[];
 	printf("  <EMPTY>\n");
    else {
 	for ( l = 0, et = top; l < 5 && et > stack; ++l, --et ) {
-		mcWrite( R(et), currout );
+		mcWrite( *et, STDOUT );
 		printf(" | ");
 	}
 	printf("\n");
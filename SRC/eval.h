@@ -2,7 +2,9 @@
 
 void InitEval( C_INT X C_CHAR C_PTR C_ARRAY );
 void evDefGlobal( C_CONS X C_CONS );
-CONS evAccNested( C_CONS X C_CONS );
+CONS *evAccNested( C_CONS X C_CONS );
+int evSetNested( C_CONS X C_CONS X C_CONS );
+int evFrameIndex( C_CONS X C_CONS );
 CONS evAccGlobal( C_CONS X C_CONS );
 CONS evMkResume( C_INT );
 void evAddFunc( C_INT X C_VOID_F_PTR );
@@ -12,3 +14,7 @@ CONS evGatherVal( C_VOID );
 CONS evGatherExpr( C_VOID );
 void evEval( C_VOID );
 void evApply( C_CONS );
+void evFlushExpand( C_VOID );
+void evMacroTable( C_CONS );
+
+extern long ev_exp_hits, ev_exp_misses;
@@ -23,6 +23,15 @@
 		We need this because evAccGlobal() requires the symbol to
 		be in a CONS node.
 
+		* The pairs of the a-list are hashed by name in MAC_TABLE
+		too, and a macro's name has its symbol's macro bit set;
+		rebinding *EXPANSION-TABLE* keeps them up to date (see
+		evMacroTable() in eval.c).
+
+		* The interpreter remembers the expansion of each macro
+		call it evaluates (see eval.c).  opResMacro() makes it
+		forget them all so the new expander is used.
+
 	- Kent Dybvig's code for extend-syntax will make macro bindings.
 	After all, extend-syntax does create macros -- it's just that
 	extend-syntax generates the expansion function for you.
@@ -75,31 +84,26 @@ void bcMacro()
 /* (SET! symbol value) */
 void bcSet()
 {
-   ENTER;
-   REG(symbol);
-   REG(value);
-   REG(binding);
+   CONS symbol, value;
 
-   R(value) = mcPopVal();
-   R(symbol) = mcPopVal();
+   value = mcPopVal();
+   symbol = mcPopVal();
 
    /* SET! a local binding in the nested_env BEFORE trying to SET! a
     * global binding.
     */
-   R(binding) = evAccNested( R(symbol), glo_env );
-   if ( !mcNull( R(binding) ) ) {
-	mcSetCdr( R(binding), R(value) );
-   }
-   /* no local binding, see if there is a global binding */
-   else if ( evAccGlobal( R(symbol), glo_env ) != NULL ) {
-	evDefGlobal( R(symbol), R(value) );
-   }
-   else {
-	/* no binding at all => error */
-	RT_LERROR("SET!: Symbol undefined: ", R(symbol) );
+   if ( !evSetNested( symbol, value, glo_env ) ) {
+	/* no local binding, see if there is a global binding */
+	if ( evAccGlobal( symbol, glo_env ) != NULL ) {
+		evDefGlobal( symbol, value );
+	}
+	else {
+		/* no binding at all => error */
+		RT_LERROR("SET!: Symbol undefined: ", symbol );
+	}
    }
 
-   OPLEAVE( R(symbol) );
+   mcPushVal( symbol );
 }
 
 /* (DEFINE symbol value) */
@@ -139,24 +143,21 @@ void opQuote()
 /* opLambda() - Returns a closure of the lambda function. */
 void opLambda()
 {
-   ENTER;
-   REG(close);
-   REG(parms);
-   REG(body);
+   CONS close, parms, body;
 
    /* gather the parm-list and body off the expression stack */
-   R(close) = evGatherExpr();
-   R(parms) = mcCar( R(close) );
-   R(body) = mcCdr( R(close) );
+   close = evGatherExpr();
+   parms = mcCar( close );
+   body = mcCdr( close );
 
    /* build the closure */
-   R(close) = NewCons( CLOSURE, 0, 0 );
-   mcCl_Parms(R(close)) = R(parms);
-   mcCl_Body(R(close)) = R(body);
-   mcCl_Env(R(close)) = mcGet_Nested(glo_env);
+   close = NewCons( CLOSURE, 0, 0 );
+   mcCl_Parms(close) = parms;
+   mcCl_Body(close) = body;
+   mcCl_Env(close) = mcGet_Nested(glo_env);
 
    /* return the closure */
-   OPLEAVE( R(close) );
+   mcPushVal( close );
 }
 
 /* ----------------------------------------------------------------------- */
@@ -169,70 +170,66 @@ void opLambda()
 */
 void opDefine()
 {
-   ENTER;
-   REG(symbol);
-   REG(exp);
+   CONS symbol, exp;
 
    /* gather args */
-   R(exp) = evGatherExpr();
+   exp = evGatherExpr();
 
-   R(symbol) = mcCar( R(exp) );
+   symbol = mcCar( exp );
 
    /* special form of define:
 	(define (name parms) body) => (name (lambda (parms) body)) */
-   if ( !mcAtom( R(symbol) ) ) {
+   if ( !mcAtom( symbol ) ) {
 
-	REG(close);
+	CONS close;
 
 	/* build the closure */
-	R(close) = NewCons( CLOSURE, 0, 0 );
-	mcCl_Parms(R(close)) = mcCdr(R(symbol));
-	mcCl_Body(R(close)) = mcCdr( R(exp) );
-	mcCl_Env(R(close)) = mcGet_Nested(glo_env);
+	close = NewCons( CLOSURE, 0, 0 );
+	mcCl_Parms(close) = mcCdr(symbol);
+	mcCl_Body(close) = mcCdr( exp );
+	mcCl_Env(close) = mcGet_Nested(glo_env);
 
 	/* strip off function name */
-	R(symbol) = mcCar( R(symbol) );
+	symbol = mcCar( symbol );
 
 	/* is there an old binding? */
-	evDefGlobal( R(symbol), R(close) );
+	evDefGlobal( symbol, close );
 
-	OPLEAVE( R(symbol) );
+	mcPushVal( symbol );
+	return;
    }
 
-   if ( !mcSymbol( R(symbol) ) )
-	RT_LERROR("DEFINE: Can't bind to non-symbol: ", R(symbol) );
+   if ( !mcSymbol( symbol ) )
+	RT_LERROR("DEFINE: Can't bind to non-symbol: ", symbol );
 
    /* save symbol on value stack */
-   mcPushVal( R(symbol) );
+   mcPushVal( symbol );
 
    /* push MARK to separate symbol from value of exp */
    mcPushVal( MARK );
 
    /* evaluate exp then resume 'DEFINE' */
    mcPushExpr( evMkResume(prDefine) );
-   mcPushExpr( mcCadr( R(exp) ) );
+   mcPushExpr( mcCadr( exp ) );
 
-   OPVOIDLEAVE;
 }
 
 /* opResDefine() - Resume defining something. */
 void opResDefine()
 {
-   ENTER;
-   REG(symbol);
-   REG(value);
+   CONS symbol, value;
 
    /* pop value, MARK, and symbol */
-   R(value) = mcPopVal();
+   value = mcPopVal();
    (void)mcPopVal();
-   R(symbol) = mcPopVal();
+   symbol = mcPopVal();
 
-   if ( evAccGlobal( R(symbol), glo_env ) != NULL )
-	RT_LERROR("Symbol already defined: ", R(symbol) );
+   if ( evAccGlobal( symbol, glo_env ) != NULL )
+	RT_LERROR("Symbol already defined: ", symbol );
 
-   evDefGlobal( R(symbol), R(value) );
+   evDefGlobal( symbol, value );
 
-   OPLEAVE( R(symbol) );
+   mcPushVal( symbol );
 }
 
 /* opSet() - (SET ATOM EXP)  Evaluate EXP and bind it's value to
@@ -242,57 +239,49 @@ void opResDefine()
 */
 void opSet()
 {
-   ENTER;
-   REG(symbol);
-   REG(exp);
+   CONS symbol, exp;
 
    /* same trick as in 'DEFINE' */
-   R(exp) = mcPopExpr();
-   R(symbol) = mcPopExpr();
+   exp = mcPopExpr();
+   symbol = mcPopExpr();
    (void) mcPopExpr();
 
-   if ( !mcSymbol( R(symbol) ) )
-	RT_LERROR("SET!: Can't bind to non-symbol: ", R(symbol) );
+   if ( !mcSymbol( symbol ) )
+	RT_LERROR("SET!: Can't bind to non-symbol: ", symbol );
 
-   mcPushVal( R(symbol) );
+   mcPushVal( symbol );
    mcPushVal( MARK );
 
    /* setup to evaluate second exp */
    mcPushExpr( evMkResume(prSet) );
-   mcPushExpr( R(exp) );
+   mcPushExpr( exp );
 
-   OPVOIDLEAVE;
 }
 
 /* opResSet() - Resume "setting" something. */
 void opResSet()
 {
-   ENTER;
-   REG(symbol);
-   REG(value);
-   REG(binding);
+   CONS symbol, value;
 
-   R(value) = mcPopVal();
+   value = mcPopVal();
    (void) mcPopVal();
-   R(symbol) = mcPopVal();
+   symbol = mcPopVal();
 
    /* SET! a local binding in the nested_env BEFORE trying to SET! a
     * global binding.
     */
-   R(binding) = evAccNested( R(symbol), glo_env );
-   if ( !mcNull( R(binding) ) ) {
-	mcSetCdr( R(binding), R(value) );
-   }
-   /* no local binding, see if there is a global binding */
-   else if ( evAccGlobal( R(symbol), glo_env ) != NULL ) {
-	evDefGlobal( R(symbol), R(value) );
-   }
-   else {
-	/* no binding at all => error */
-	RT_LERROR("SET!: Symbol undefined: ", R(symbol) );
+   if ( !evSetNested( symbol, value, glo_env ) ) {
+	/* no local binding, see if there is a global binding */
+	if ( evAccGlobal( symbol, glo_env ) != NULL ) {
+		evDefGlobal( symbol, value );
+	}
+	else {
+		/* no binding at all => error */
+		RT_LERROR("SET!: Symbol undefined: ", symbol );
+	}
    }
 
-   OPLEAVE( R(symbol) );
+   mcPushVal( symbol );
 }
 
 /* ----------------------------------------------------------------------- */
@@ -305,26 +294,25 @@ void opResSet()
 */
 void opBegin()
 {
-   ENTER;
-   REG(exp);
+   CONS exp;
 
    /* pop args off expr stack and place on val stack */
-   R(exp) = mcPopExpr();
-   if ( R(exp) == CALL ) {
+   exp = mcPopExpr();
+   if ( exp == CALL ) {
 	/* (BEGIN) => NIL though it could be flagged as an error */
-	OPLEAVE( NIL );
+	mcPushVal( NIL );
+	return;
    } else mcPushVal( MARK );
 
-   while ( R(exp) != CALL ) {
-   	mcPushVal( R(exp) );
-	R(exp) = mcPopExpr();
+   while ( exp != CALL ) {
+   	mcPushVal( exp );
+	exp = mcPopExpr();
    }
 
    /* push a dummy value on the value stack so we can just call opResBegin() */
    mcPushVal( NIL );
 
    opResBegin( evMkResume(prBegin) );
-   OPVOIDLEAVE;
 }
 
 /* opResBegin() - Resume "beginning" */
@@ -357,70 +345,62 @@ CONS res;
 */
 void opIf()
 {
-   ENTER;
-   REG(cond);
-   REG(cons);
-   REG(alt);
+   CONS cond, cons, alt;
 
    /* pop parameters */
-   R(alt) = mcPopExpr();
-   R(cons) = mcPopExpr();
-   R(cond) = mcPopExpr();
+   alt = mcPopExpr();
+   cons = mcPopExpr();
+   cond = mcPopExpr();
 
-   if ( R(cond) == CALL ) {
+   if ( cond == CALL ) {
 	/* no alternative was specified shift values down into
 	 * their correct variables.
 	 */
-	R(cond) = R(cons);
-	R(cons) = R(alt);
-	R(alt) = CALL;
+	cond = cons;
+	cons = alt;
+	alt = CALL;
    }
    else
 	/* pop CALL */
 	mcPopExpr();
 
    /* save consequense and alternate on value stack */
-   mcPushVal( R(alt) );
-   mcPushVal( R(cons) );
+   mcPushVal( alt );
+   mcPushVal( cons );
    mcPushVal( MARK );
 
    mcPushExpr( evMkResume(prIf) );
-   mcPushExpr( R(cond) );
+   mcPushExpr( cond );
 
-   OPVOIDLEAVE;
 }
 
 /* opResIf() - Resume 'IF' */
 void opResIf()
 {
-   ENTER;
-   REG(cons);
-   REG(alt);
-   REG(value);
+   CONS cons, alt, value;
 
    /* pop value of exp, MARK, cons, alt */
-   R(value) = mcPopVal();
+   value = mcPopVal();
    (void) mcPopVal();
-   R(cons) = mcPopVal();
-   R(alt) = mcPopVal();
+   cons = mcPopVal();
+   alt = mcPopVal();
 
-   EV_DEBUG("\nBACK IN opResIf, VALUE = ", R(value) );
-   EV_DEBUG("\n               , CONS  = ", R(cons) );
-   EV_DEBUG("\n               , ALT   = ", R(alt) );
+   EV_DEBUG("\nBACK IN opResIf, VALUE = ", value );
+   EV_DEBUG("\n               , CONS  = ", cons );
+   EV_DEBUG("\n               , ALT   = ", alt );
 
    /* if the result is '() or #f then evaluate alt */
-   if ( mcNull( R(value) ) || R(value) == F ) {
+   if ( mcNull( value ) || value == F ) {
 	/* if there is no alternate, value of 'IF' is value of condition */
-	if ( R(alt) == CALL )
-		mcPushVal( R(value) );
+	if ( alt == CALL )
+		mcPushVal( value );
 	/* otherwise, evaluate alternate */
-	else mcPushExpr( R(alt) );
-	OPVOIDLEAVE;
+	else mcPushExpr( alt );
+	return;
    }
 
    /* evaluate the consequence */
-   mcPushExpr( R(cons) );
-   OPVOIDLEAVE;
+   mcPushExpr( cons );
 }
 
 /* opOr - (OR exp exp ...) - Return the value of the first non-nil exp (short-
@@ -429,26 +409,25 @@ void opResIf()
 */
 void opOr()
 {
-   ENTER;
-   REG(exp);
+   CONS exp;
 
    /* pop args off expr stack and place on val stack */
-   R(exp) = mcPopExpr();
-   if ( R(exp) == CALL ) {
+   exp = mcPopExpr();
+   if ( exp == CALL ) {
 	/* (OR) => #f */
-	OPLEAVE( F );
+	mcPushVal( F );
+	return;
    } else mcPushVal( MARK );
 
-   while ( R(exp) != CALL ) {
-	mcPushVal( R(exp) );
-	R(exp) = mcPopExpr();
+   while ( exp != CALL ) {
+	mcPushVal( exp );
+	exp = mcPopExpr();
    }
 
    /* push dummy value on val stack so we can just call opResOr() */
    mcPushVal( NIL );
 
    opResOr( evMkResume(prOr) );
-   OPVOIDLEAVE;
 }
 
 /* opResOr() - Resume "oring" */
@@ -488,26 +467,25 @@ CONS res;
 */
 void opAnd()
 {
-   ENTER;
-   REG(exp);
+   CONS exp;
 
    /* pop args off expr stack and place on val stack */
-   R(exp) = mcPopExpr();
-   if ( R(exp) == CALL ) {
+   exp = mcPopExpr();
+   if ( exp == CALL ) {
 	/* (AND) => #t */
-	OPLEAVE( T );
+	mcPushVal( T );
+	return;
    } else mcPushVal( MARK );
 
-   while ( R(exp) != CALL ) {
-	mcPushVal( R(exp) );
-	R(exp) = mcPopExpr();
+   while ( exp != CALL ) {
+	mcPushVal( exp );
+	exp = mcPopExpr();
    }
 
    /* push dummy value on val stack so we can just call opResAnd() */
    mcPushVal( T );
 
    opResAnd( evMkResume(prAnd) );
-   OPVOIDLEAVE;
 }
 
 /* opResAnd() - Resume "anding" */
@@ -543,57 +521,56 @@ CONS res;
 /* opMacro() - Defines a macro. */
 void opMacro()
 {
-   ENTER;
-   REG(func);
-   REG(symbol);
+   CONS func, symbol;
 
    /* pop args and CALL */
-   R(func) = mcPopExpr();
-   R(symbol) = mcPopExpr();
+   func = mcPopExpr();
+   symbol = mcPopExpr();
    (void) mcPopExpr();
 
-   if ( !mcSymbol( R(symbol) ) )
-	RT_LERROR("MACRO: Can't make macro of non-symbol: ", R(symbol) );
+   if ( !mcSymbol( symbol ) )
+	RT_LERROR("MACRO: Can't make macro of non-symbol: ", symbol );
 
    /* save symbol on val stack */
-   mcPushVal( R(symbol) );
+   mcPushVal( symbol );
 
    /* setup to evaluate func */
    mcPushExpr( evMkResume(prMacro) );
-   mcPushExpr( R(func) );
+   mcPushExpr( func );
 
-   OPVOIDLEAVE;
 }
 
 /* opResMacro() - Resume defining a macro. */
 void opResMacro()
 {
-   ENTER;
-   REG(name);		/* macro name */
-   REG(expand);		/* expander function */
-   REG(binding);	/* ( name . expander ) */
-   REG(etbl);		/* expansion table */
+   CONS name;		/* macro name */
+   CONS expand;		/* expander function */
+   CONS binding;	/* ( name . expander ) */
+   CONS etbl;		/* expansion table */
 
-   R(expand) = mcPopVal();
-   R(name) = mcPopVal();
+   expand = mcPopVal();
+   name = mcPopVal();
 
    /* get the expansion table from the environment */
-   R(etbl) = evAccGlobal( EXP_TABLE, glo_env );
+   etbl = evAccGlobal( EXP_TABLE, glo_env );
 
    /* is there an old macro binding? */
-   R(binding) = mcQAssoc( R(name), R(etbl) );
-   if ( !mcNull( R(binding) ) )
+   binding = mcQAssoc( name, etbl );
+   if ( !mcNull( binding ) )
 	/* replace old macro binding */
-	(void) mcSetCdr( R(binding), R(expand) );
+	(void) mcSetCdr( binding, expand );
 
    else {
 	/* build a new binding, tack on front of expansion table
 	 * and rebind the expansion table.
 	 */
-	R(binding) = mcCons( R(name), R(expand) );
-	R(etbl) = mcCons( R(binding), R(etbl) );
-	evDefGlobal( EXP_TABLE, R(etbl) );
+	binding = mcCons( name, expand );
+	etbl = mcCons( binding, etbl );
+	evDefGlobal( EXP_TABLE, etbl );
    }
 
-   OPLEAVE( R(name) );
+   /* forms expanded by the old expander have to be expanded again */
+   evFlushExpand();
+
+   mcPushVal( name );
 }
@@ -37,6 +37,12 @@
 /* cell_type for MM */
 #define FREE		50
 
+/* generations for MM -- see notes in memory.c */
+#define YOUNG		0		/* allocated since the last GC */
+#define OLD		1		/* survived a GC */
+#define REMEMBERED	2		/* OLD and on the remembered set */
+#define UNUSED		3		/* a FREE cell */
+
 /* port types */
 #define INPUT		1
 #define OUTPUT		2
@@ -47,9 +53,14 @@ struct Pair {
 	struct C *cdr;
 } ;
 
+/* defn of a port.  a string port has no FILE; its characters are in
+	a string nobody else has (see mcOpenInStr() and mcOpenOutStr()).
+*/
 struct Port {
-	FILE *fp;
+	FILE *fp;		/* NULL for a string port */
 	int type;		/* INPUT, OUTPUT, or CLOSED */
+	int pos;		/* string port: # of chars read or written */
+	struct C *str;		/* string port: its characters */
 } ;
 
 struct Vector {
@@ -62,6 +73,7 @@ struct B_Code {
 	struct C **const_table;		/* constant table */
 	unsigned int lcode;		/* last byte of code */
 	unsigned int lconst;		/* last constant */
+	long gen;			/* cp_gen it was compiled in */
 } ;
 
 struct E_Pnt {
@@ -83,6 +95,8 @@ struct Closure {
 	struct C *env;		/* saved env */
 	struct C *parms;	/* paramters */
 	struct C *body;		/* body of procedure */
+	struct C *code;		/* body pre-analyzed (see mcAnalyze()),
+				   NIL if not yet, F if it can't be */
 } ;
 
 /* defn of a continuation */
@@ -93,19 +107,34 @@ struct Continuation {
 	struct C *exps;		/* expression stack at capture */
 } ;
 
+/* defn of a string.  a string that owns its characters has a NULL
+	owner.  a slice (see mcSubStr()) shares the characters of its
+	owner, a string nobody else can change.  a rope (see mcStrApp())
+	has no characters, just two halves nobody else can change.
+*/
+struct Str {
+   char *chars;			/* the characters; EOS after them if owned */
+   int len;			/* # of characters */
+   int depth;			/* a rope's depth; 0 if it has characters */
+   struct C *owner;		/* the string they belong to, or NULL; or
+				   a rope's left half */
+   struct C *right;		/* a rope's right half */
+} ;
+
 /* defn of an environment */
 struct Envmnt {
-   struct C *nested;		/* nested bindings (an A-LIST) */
+   struct C *nested;		/* innermost frame, or NIL; frames are
+				   linked thru mcFrame_Up (see micro.h) */
    struct C *global;		/* global bindings (a VECTOR) */
 } ;
 
-/* the cons node datatype */
+/* the cons node datatype.  pairs aren't CONSNODEs -- a pair is just a
+	struct Pair, and its CONS is tagged (see notes in memory.c).
+*/
 struct C {
-   int cell_type;		/* PAIR, INT, FLOAT, SYMBOL, CHAR, etc. */
-   BOOL mmark;
+   int cell_type;		/* INT, FLOAT, SYMBOL, VECTOR, etc. */
 
    union {
-	struct Pair cons_node;
 	struct B_Code bcode;
 	struct E_Pnt  exepnt;
 	struct Port   port;
@@ -114,14 +143,25 @@ struct C {
 	struct Continuation cont;
 	struct Vector vector;
 	struct Envmnt env;
+	struct Str str;
 
 	int int_data;		/* also is symbol table entry index */
 	REAL_NUM float_data;
-	char *string;
-	char character;
    } data;
 } ;
 typedef struct C CONSNODE;
+
+/* INT, FLOAT, SYMBOL and RESUME cells only have room for this much of a
+	CONSNODE.
+*/
+struct Atom {
+   int cell_type;
+
+   union {
+	int int_data;
+	REAL_NUM float_data;
+   } data;
+} ;
 typedef struct C *CONS;
 
 /* global variables */
@@ -142,6 +182,8 @@ extern CONS MARK;
 extern CONS PUSHFUNC;
 extern CONS RESTORE;
 extern CONS EXP_RESUME;
+extern CONS EXP_CACHE;			/* memoized macro expansions */
+extern CONS MAC_TABLE;			/* hashed *EXPANSION-TABLE* */
 
 extern CONS glo_env;			/* see notes in eval.c */
 
@@ -46,6 +46,10 @@ static void add_predefs()
    deffunc("TORTURE", prTorture, opTorture, 0, 0);
    deffunc("GCDEBUG", prGcDebug, opGcDebug, 0, 0);
    deffunc("EVDEBUG", prEvDebug, opEvDebug, 0, 0);
+   deffunc("GC-BUDGET", prGcBudget, opGcBudget, 0, 1);
+   deffunc("GC-STATS", prGcStats, opGcStats, 0, 0);
+   deffunc("GC", prGc, opGc, 0, 0);
+   deffunc("EXPAND-STATS", prExpStats, opExpStats, 0, 0);
    deffunc("QUIT", prExit, opExit, 0, 0);
    deffunc("EXIT", prExit, opExit, 0, 0);
    deffunc("BYE", prExit, opExit, 0, 0);
@@ -143,6 +147,14 @@ static void add_predefs()
    deffunc("STRING<=?", prStrLE, opStrLE, 2, 2);
    deffunc("STRING>=?", prStrGE, opStrGE, 2, 2);
    deffunc("SUBSTRING", prSubStr, opSubStr, 3, 3);
+   deffunc("STRING-SET!", prStrSet, opStrSet, 3, 3);
+   deffunc("STRING-FILL!", prStrFill, opStrFill, 2, 2);
+   deffunc("STRING-INDEX", prStrIndex, opStrIndex, 2, 2);
+   deffunc("STRING-SEARCH-FORWARD", prStrSearch, opStrSearch, 3, 3);
+   deffunc("STRING-CONTAINS", prStrContains, opStrContains, 2, 2);
+   deffunc("STRING-SPLIT", prStrSplit, opStrSplit, 2, 2);
+   deffunc("STRING-PREFIX?", prStrPrefix, opStrPrefix, 2, 2);
+   deffunc("STRING-SUFFIX?", prStrSuffix, opStrSuffix, 2, 2);
    deffunc("STRING->LIST", prStrLst, opStrLst, 1, 1);
    deffunc("LIST->STRING", prLstStr, opLstStr, 1, 1);
    deffunc("SYMBOL->STRING", prSymStr, opSymStr, 1, 1);
@@ -176,6 +188,9 @@ static void add_predefs()
    deffunc("CURRENT-OUTPUT-PORT", prCurrOut, opCurrOut, 0, 0);
    deffunc("OPEN-INPUT-FILE", prOpenInFile, opOpenInFile, 1, 1);
    deffunc("OPEN-OUTPUT-FILE", prOpenOutFile, opOpenOutFile, 1, 1);
+   deffunc("OPEN-INPUT-STRING", prOpenInStr, opOpenInStr, 1, 1);
+   deffunc("OPEN-OUTPUT-STRING", prOpenOutStr, opOpenOutStr, 0, 0);
+   deffunc("GET-OUTPUT-STRING", prGetOutStr, opGetOutStr, 1, 1);
    deffunc("CLOSE-FILE", prClose, opClose, 1, 1);
    deffunc("LOAD", prLoad, opLoad, 1, 1);
 
@@ -202,26 +217,22 @@ int pr;
 void (*op)( C_VOID );
 int ra, aa;
 {
-   ENTER;
-   REG(symbol);
-   REG(func);
+   CONS symbol, func;
 
-   R(symbol) = NewCons( SYMBOL, 0, 0 );
-   mcCpy_Sym( R(symbol), name );
+   symbol = ssIntern( name );
 
    /* create the primitive function definition node */
-   R(func) = NewCons( CFUNC, 0, 0 );
-   mcPrim_Name( R(func) ) = mcGet_Sym( R(symbol) );
-   mcPrim_PR( R(func) ) = pr;
-   mcPrim_RA( R(func) ) = ra;
-   mcPrim_AA( R(func) ) = aa;
-   mcPrim_Op( R(func) ) = op;
+   func = NewCons( CFUNC, 0, 0 );
+   mcPrim_Name( func ) = mcGet_Sym( symbol );
+   mcPrim_PR( func ) = pr;
+   mcPrim_RA( func ) = ra;
+   mcPrim_AA( func ) = aa;
+   mcPrim_Op( func ) = op;
 
    evAddFunc( pr, op );
 
-   evDefGlobal( R(symbol), R(func) );
+   evDefGlobal( symbol, func );
 
-   MCLEAVE;
 }
 
 /* defform(name, pr, op, bc, ra, aa) - Creates the binding for the system
@@ -240,25 +251,21 @@ void (*op)( C_VOID );
 void (*bc)( C_VOID );
 int ra, aa;
 {
-   ENTER;
-   REG(symbol);
-   REG(form);
+   CONS symbol, form;
 
-   R(symbol) = NewCons( SYMBOL, 0, 0 );
-   mcCpy_Sym( R(symbol), name );
+   symbol = ssIntern( name );
 
    /* create the form's definition node */
-   R(form) = NewCons( CFORM, 0, 0 );
-   mcPrim_Name( R(form) ) = mcGet_Sym( R(symbol) );
-   mcPrim_PR( R(form) ) = pr;
-   mcPrim_RA( R(form) ) = ra;
-   mcPrim_AA( R(form) ) = aa;
-   mcPrim_Op( R(form) ) = op;
+   form = NewCons( CFORM, 0, 0 );
+   mcPrim_Name( form ) = mcGet_Sym( symbol );
+   mcPrim_PR( form ) = pr;
+   mcPrim_RA( form ) = ra;
+   mcPrim_AA( form ) = aa;
+   mcPrim_Op( form ) = op;
 
    /* let the compiler know about this form */
    evAddFunc( pr, bc );
 
-   evDefGlobal( R(symbol), R(form) );
+   evDefGlobal( symbol, form );
 
-   MCLEAVE;
 }
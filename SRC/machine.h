@@ -44,6 +44,42 @@
 */
 #define FILE_WRITE_BIN	"wb"
 
+/* PTR_INT - an unsigned integer type as wide as a pointer.  The memory
+	manager masks cell addresses with it to find their segment.
+*/
+#define PTR_INT		unsigned long
+
+/* MMAP_ARENA - Define this if you have mmap() and madvise().  The memory
+	manager reserves the whole heap (--heap-max) as one arena up front,
+	and empty segments are given back to the OS.  Without it segments
+	are malloc'ed and an empty segment is only kept for reuse.  The
+	stacks in micro.c are reserved the same way (--stack-max); without
+	it each is malloc'ed at its full size.
+*/
+#if defined(__unix__) || defined(__APPLE__)
+#	define MMAP_ARENA
+#endif
+
+/* GC_THREADS - Define this if you have POSIX threads and gcc's __atomic
+	builtins (gcc 4.7 or later).  A major GC that marks all at once
+	splits the marking between -G<n> threads.  Link with -lpthread.
+*/
+#if (defined(__unix__) || defined(__APPLE__)) && defined(__ATOMIC_RELAXED)
+#	define GC_THREADS
+#endif
+
+/* SIMD_SSE2, SIMD_AVX2 - Define these if gcc (or clang) targets SSE2
+	or AVX2.  ssMemChr() and ssMemMem() in symstr.c, which STRING-INDEX,
+	STRING-SEARCH-FORWARD and the like scan with, look at 16 or 32
+	characters at a time.  Without them they look at one.
+*/
+#if defined(__GNUC__) && defined(__SSE2__)
+#	define SIMD_SSE2
+#endif
+#if defined(__GNUC__) && defined(__AVX2__)
+#	define SIMD_AVX2
+#endif
+
 /* ----------------------------------------------------------------------- */
 /*                End of user configurable parameters.			   */
 /* ----------------------------------------------------------------------- */
@@ -55,10 +91,33 @@
 #	define STDLIB_H		<stdlib.h>
 #endif
 
+/* PREFETCH - hint that the cell at p is about to be read */
+#ifdef __GNUC__
+#	define PREFETCH(p)	__builtin_prefetch( (p) )
+#else
+#	define PREFETCH(p)
+#endif
+
+/* NO_ASAN - the GC scans the whole C stack, red zones and all, so its
+	scan mustn't be checked by AddressSanitizer.
+*/
+#if defined(__SANITIZE_ADDRESS__)
+#	define NO_ASAN	__attribute__((no_sanitize_address))
+#elif defined(__has_feature)
+#	if __has_feature(address_sanitizer)
+#		define NO_ASAN	__attribute__((no_sanitize_address))
+#	endif
+#endif
+#ifndef NO_ASAN
+#	define NO_ASAN
+#endif
+
 /* definitions for traditional compilers */
 #ifdef TRAD
 #	define C_VOID
 #	define C_INT
+#	define C_LONG
+#	define C_REAL
 #	define C_CHAR
 #	define C_FILE
 #	define C_CONS
@@ -71,6 +130,8 @@
 #else		/* defs for ANSI compilers */
 #	define C_VOID	void
 #	define C_INT	int
+#	define C_LONG	long
+#	define C_REAL	double
 #	define C_CHAR	char
 #	define C_FILE	FILE
 #	define C_CONS	CONS
@@ -25,11 +25,15 @@
 #define TEMP_SYMBOL_SIZE	500
 
 /* local prototypes */
-static CONS mcReadList( C_FILE C_PTR );
-static CONS mcReadAtom( C_FILE C_PTR );
-static void mcWriteAtom( C_CONS X C_FILE C_PTR X C_INT );
-static CONS mcReadQuote( C_FILE C_PTR );
-static CONS mcReadVector( C_FILE C_PTR );
+static void str_room( C_CONS X C_INT );
+static void put_s( C_CONS X C_CHAR C_PTR );
+static CONS mcReadList( C_CONS );
+static CONS mcReadAtom( C_CONS );
+static void mcWriteAtom( C_CONS X C_CONS X C_INT );
+static CONS mcReadQuote( C_CONS );
+static CONS mcReadVector( C_CONS );
+static void mcWriteStr( C_CONS X C_CONS );
+static void mcDumpStr( C_CONS X C_FILE C_PTR );
 static void mcDumpCons( C_CONS X C_FILE C_PTR );
 static CONS mcRestCons( C_FILE C_PTR );
 
@@ -62,27 +66,180 @@ char *n, *m;
    return port;
 }
 
-/* mcClose(p) - Closes port p. */
+/* mcClose(p) - Closes port p.  A string output port's characters stay
+	put for (GET-OUTPUT-STRING); a string input port's are let go.
+*/
 void mcClose(p)
 CONS p;
 {
-   if ( mcGet_PortType(p) != CLOSED ) {
+   if ( mcGet_PortType(p) == CLOSED )
+	return;
+
+   if ( !mcStrPort(p) )
 	fclose( mcGet_Port(p) );
-	mcCpy_PortType(p, CLOSED);
+   else if ( mcGet_PortType(p) == INPUT ) {
+	SBarrier( mcPort_Str(p) );
+	mcPort_Str(p) = NULL;
+	mcPort_Pos(p) = 0;
    }
+
+   mcCpy_PortType(p, CLOSED);
+}
+
+/* mcOpenInStr(s) - Returns an input port reading the characters of
+	string s.  The port reads a slice of s (see mcSubStr()), or a copy
+	if s is short, so changing s later doesn't change what's read.
+*/
+CONS mcOpenInStr(s)
+CONS s;
+{
+   CONS str, port;
+
+   str = mcSubStr( s, 0, mcStr_Len(s) - 1 );
+
+   port = NewCons( PORT, 0, 0 );
+   mcPort_Str(port) = str;
+   mcCpy_PortType(port, INPUT);
+   return port;
+}
+
+/* mcOpenOutStr() - Returns an output port that collects what's written to
+	it in a string.  The string is allocated by the first write.
+*/
+CONS mcOpenOutStr()
+{
+   CONS port;
+
+   port = NewCons( PORT, 0, 0 );
+   mcCpy_PortType(port, OUTPUT);
+   return port;
+}
+
+/* mcOutStr(p) - Returns the characters written so far to string output
+	port p.  Unless they're short they're a slice of the port's
+	string, not a copy: the port only ever writes past them.
+*/
+CONS mcOutStr(p)
+CONS p;
+{
+   CONS str;
+   char *new;
+   int len;
+
+   len = mcPort_Pos(p);
+   if ( len < SLICE_MIN ) {
+	new = NewStr( len );
+	if ( len > 0 )
+		memcpy( new, mcGet_Str( mcPort_Str(p) ), (size_t)len );
+	str = NewCons( STRING, 0, 0 );
+	mcSet_Str( str, new );
+	return str;
+   }
+
+   str = NewCons( STRING, 0, 0 );
+   mcGet_Str(str) = mcGet_Str( mcPort_Str(p) );
+   mcStr_Len(str) = len;
+   mcStr_Owner(str) = mcPort_Str(p);
+   return str;
+}
+
+/* ----------------------------------------------------------------------- */
+/*                           Port Characters				   */
+/* ----------------------------------------------------------------------- */
+
+/* mcGetChar(p) - Reads and returns the next character from input port p,
+	or EOF.
+*/
+int mcGetChar(p)
+CONS p;
+{
+   if ( !mcStrPort(p) )
+	return getc( mcGet_Port(p) );
+
+   if ( mcPort_Pos(p) >= mcStr_Len( mcPort_Str(p) ) )
+	return EOF;
+
+   return (unsigned char)mcGet_Str( mcPort_Str(p) )[mcPort_Pos(p)++];
+}
+
+/* mcUngetChar(p, c) - Puts c, the character just read from port p, back. */
+void mcUngetChar(p, c)
+CONS p;
+int c;
+{
+   if ( !mcStrPort(p) )
+	ungetc(c, mcGet_Port(p));
+   else if ( c != EOF )
+	--mcPort_Pos(p);
+}
+
+/* mcPutStr(p, s, n) - Writes the n characters at s to output port p. */
+void mcPutStr(p, s, n)
+CONS p;
+char *s;
+int n;
+{
+   if ( !mcStrPort(p) ) {
+	fwrite( s, sizeof(char), (size_t)n, mcGet_Port(p) );
+	return;
+   }
+
+   str_room( p, n );
+   memcpy( mcGet_Str( mcPort_Str(p) ) + mcPort_Pos(p), s, (size_t)n );
+   mcPort_Pos(p) += n;
+}
+
+/* put_s(p, s) - Writes the EOS terminated s to output port p. */
+static void put_s(p, s)
+CONS p;
+char *s;
+{
+   mcPutStr( p, s, (int)strlen(s) );
+}
+
+/* str_room(p, n) - Makes sure there's room for n more characters in the
+	string of port p, if it's a string port.  A full string is copied
+	into one twice as big, so writing a character is O(1) amortized.
+*/
+static void str_room(p, n)
+CONS p;
+int n;
+{
+   CONS old, new;
+   int size;
+
+   if ( !mcStrPort(p) )
+	return;
+
+   old = mcPort_Str(p);
+   if ( old != NULL && mcPort_Pos(p) + n <= mcStr_Len(old) )
+	return;
+
+   size = old == NULL ? PORT_BUF : 2 * mcStr_Len(old);
+   while ( size < mcPort_Pos(p) + n )
+	size *= 2;
+
+   new = NewCons( STRING, 0, 0 );
+   mcSet_Str( new, NewStr( size ) );
+   if ( mcPort_Pos(p) > 0 )
+	memcpy( mcGet_Str(new), mcGet_Str(old), (size_t)mcPort_Pos(p) );
+
+   SBarrier( old );
+   mcPort_Str(p) = new;
+   WBarrier( p, new );
 }
 
 /* ----------------------------------------------------------------------- */
 /*                              Scheme READ				   */
 /* ----------------------------------------------------------------------- */
 
-/* mcRead(f) - Gets and returns the next Scheme object from stream f.  If
+/* mcRead(f) - Gets and returns the next Scheme object from port f.  If
 	it encounters a token it can't handle, it puts the token back and
 	returns NULL.  Remember that NULL shouldn't occur anywhere in a
 	list.
 */
 CONS mcRead(f)
-FILE *f;
+CONS f;
 {
    token_type = GetToken(f);
 
@@ -129,17 +286,13 @@ FILE *f;
 
 /* mcReadList(f) */
 static CONS mcReadList(f)
-FILE *f;
+CONS f;
 {
-   ENTER;
-
-   REG(head);
-   REG(tail);
-   REG(elem);
+   CONS head, tail, elem;
    int end;
 
    token_type = GetToken(f);
-   R(head) = R(tail) =  R(elem) = NIL;
+   head = tail =  elem = NIL;
 
    if ( token_type == LP )
 	end = RP;
@@ -156,20 +309,20 @@ FILE *f;
 	PutBack();
 
 	/* get this element */
-	R(elem) = mcRead(f);
-	assert( R(elem) );
+	elem = mcRead(f);
+	assert( elem );
 
-	R(elem) = mcCons( R(elem), NIL );	/* building lists here! */
+	elem = mcCons( elem, NIL );	/* building lists here! */
 
 	/* link the element into the current list */
-	if ( R(head) == NIL ) {
+	if ( head == NIL ) {
 		/* just starting the list */
-		R(head) = R(elem);
-		R(tail) = R(head);
+		head = elem;
+		tail = head;
 	} else {
 		/* adding to end of current list */
-		mcSetCdr( R(tail), R(elem) );
-		R(tail) = R(elem);
+		mcSetCdr( tail, elem );
+		tail = elem;
 	}
 
 	/* next element */
@@ -179,15 +332,15 @@ FILE *f;
    /* quit on DP? cdr = next expression (and is end of list) */
    if ( token_type == DOT ) {
 
-	R(elem) = mcRead(f);
-	assert( R(elem) );
+	elem = mcRead(f);
+	assert( elem );
 
 	/* insert the expression, NOTE: list must already exist! */
-	if ( mcNull( R(head) ) ) {
+	if ( mcNull( head ) ) {
 		RT_ERROR("Misplaced dot!");
 	}
 	else
-		mcSetCdr( R(tail), R(elem) );
+		mcSetCdr( tail, elem );
 
 	/* make sure we've read the end of the list */
 	if ( (token_type = GetToken(f)) != end ) {
@@ -204,7 +357,7 @@ FILE *f;
 	RT_ERROR("Unexpected end of input.");
    }
 
-   MCLEAVE R(head);
+   return head;
 }
 
 /* mcReadAtom() - Gets the next atom in the input stream and returns it in
@@ -216,12 +369,9 @@ FILE *f;
 	- Easy to handle keyword `EXPR   => (QUASIQUOTE EXPR)
 	- Easy to handle keyword ,EXPR   => (UNQUOTE EXPR)
 	- Easy to handle keyword ,@ EXPR => (UNQUOTE-SPLICE EXPR)
-
-	- MM Note: No need to declare elem as REG() because it's defined
-	after possible GC happens.
 */
 static CONS mcReadAtom(f)
-FILE *f;
+CONS f;
 {
    CONS elem;
 
@@ -246,18 +396,15 @@ FILE *f;
 	break;
 
      case INT:
-	elem = NewCons( INT, 0, 0 );
-	mcCpy_Int(elem, inum);
+	elem = mcIntToCons( inum );
 	break;
 
      case SYMBOL:
-	elem = NewCons( SYMBOL, 0, 0 );
-	mcCpy_Sym(elem, token);
+	elem = ssIntern( token );
 	break;
 
      case CHAR:
-	elem = NewCons( CHAR, 0, 0 );
-	mcCpy_Char(elem, *token);
+	elem = mcCharToCons( (unsigned char)*token );
 	break;
 
      case STRING:
@@ -275,52 +422,48 @@ FILE *f;
 
 /* mcReadQuote(f) */
 static CONS mcReadQuote(f)
-FILE *f;
+CONS f;
 {
-   ENTER;
-   REG(quote);
-   REG(elem);
+   CONS quote, elem;
 
    token_type = GetToken(f);
 
-   R(quote) = NewCons( SYMBOL, 0, 0 );
    switch ( token_type ) {
 
      case QUOTE:
-	mcCpy_Sym( R(quote), "QUOTE");
+	quote = ssIntern( "QUOTE" );
 	break;
 
      case QUASI:
-	mcCpy_Sym( R(quote), "QUASIQUOTE");
+	quote = ssIntern( "QUASIQUOTE" );
 	break;
 
      case UNQUOTE:
-	mcCpy_Sym( R(quote), "UNQUOTE");
+	quote = ssIntern( "UNQUOTE" );
 	break;
 
      case UNQ_SPLICE:
-	mcCpy_Sym( R(quote), "UNQUOTE-SPLICE");
+	quote = ssIntern( "UNQUOTE-SPLICE" );
 	break;
 
      default:
 	assert(0);
    }
 
-   R(elem) = mcRead(f);
-   assert( R(elem) );
+   elem = mcRead(f);
+   assert( elem );
 
-   R(elem) = mcCons( R(elem), NIL );
-   R(quote) = mcCons( R(quote), R(elem) );
+   elem = mcCons( elem, NIL );
+   quote = mcCons( quote, elem );
 
-   MCLEAVE R(quote);
+   return quote;
 }
 
 /* mcReadVector(f) */
 static CONS mcReadVector(f)
-FILE *f;
+CONS f;
 {
-   ENTER;
-   REG(v);
+   CONS v;
 
    token_type = GetToken(f);
    assert( token_type == VECTOR );
@@ -329,12 +472,9 @@ FILE *f;
 	/* unknown # of elements, read the elements into a list and then
 	 * convert this list into a vector
 	 */
-	ENTER;
-	REG(head);
-	REG(tail);
-	REG(elem);
+	CONS head, tail, elem;
 
-	R(head) = R(tail) = R(elem) = NIL;
+	head = tail = elem = NIL;
 
 	token_type = GetToken(f);
 	while ( token_type != RP && token_type != NO_TOKEN && token_type != EOF ) {
@@ -342,26 +482,26 @@ FILE *f;
 		PutBack();
 
 		/* get this element */
-		R(elem) = mcRead(f);
-		assert( R(elem) );
-		R(elem) = mcCons( R(elem), NIL );
+		elem = mcRead(f);
+		assert( elem );
+		elem = mcCons( elem, NIL );
 
 		/* link the element into the current list */
-		if ( R(head) == NIL ) {
+		if ( head == NIL ) {
 			/* just starting the list */
-			R(head) = R(elem);
-			R(tail) = R(head);
+			head = elem;
+			tail = head;
 		} else {
 			/* adding to end of current list */
-			mcSetCdr( R(tail), R(elem) );
-			R(tail) = R(elem);
+			mcSetCdr( tail, elem );
+			tail = elem;
 		}
 
 		/* next element */
 		token_type = GetToken(f);
 	}
 
-	R(v) = mcLstVector( R(head) );
+	v = mcLstVector( head );
 
    } else {
 	/* user specified the # of elements, allocate a vector big enough
@@ -373,12 +513,13 @@ FILE *f;
 		RT_ERROR("READ: Negative vector size specified for vector.");
 	}
 
-	R(v) = mcMakeVector( inum, NIL );
+	v = mcMakeVector( inum, NIL );
 
 	for ( cnt = 0; cnt < inum; ++cnt ) {
-		*mcVect_Ref(R(v), cnt) = mcRead(f);
-		if ( *mcVect_Ref( R(v),cnt ) == NULL ) {
-			*mcVect_Ref( R(v), cnt ) = NIL;
+		*mcVect_Ref(v, cnt) = mcRead(f);
+		WBarrier( v, *mcVect_Ref(v, cnt) );
+		if ( *mcVect_Ref( v,cnt ) == NULL ) {
+			*mcVect_Ref( v, cnt ) = NIL;
 			break;
 		}
 	}
@@ -389,131 +530,171 @@ FILE *f;
 	}
    }
 
-   MCLEAVE( R(v) );
+   return( v );
 }
 
 /* ----------------------------------------------------------------------- */
 /*                             Scheme WRITE				   */
 /* ----------------------------------------------------------------------- */
 
-/* mcWriteAtom(c) - Writes the atom c to the file stream f. */
+/* mcWriteStr(c, f) - Writes the characters of string c to port f.  A
+	slice isn't EOS terminated, and a rope is written a piece at a time
+	rather than flattened.
+*/
+static void mcWriteStr(c, f)
+CONS c;
+CONS f;
+{
+   if ( mcRope(c) ) {
+	mcWriteStr( mcRope_Left(c), f );
+	mcWriteStr( mcRope_Right(c), f );
+	return;
+   }
+
+   /* c's characters are only good as long as c is, so make room for
+    * them before taking the char *.
+    */
+   str_room( f, mcStr_Len(c) );
+   mcPutStr( f, mcGet_Str(c), mcStr_Len(c) );
+}
+
+/* mcWriteAtom(c) - Writes the atom c to port f. */
 static void mcWriteAtom(c, f, d)
 CONS c;
-FILE *f;
+CONS f;
 int d;
 {
+   char buf[TEMP_SYMBOL_SIZE];
+
    /* '() is an atom */
    if ( mcNull(c) ) {
-	fprintf(f, "()");
+	put_s(f, "()");
 	return;
    }
 
    switch ( mcKind(c) ) {
 	case TOBJ:
-		fprintf(f, "#T");
+		put_s(f, "#T");
 		break;
 
 	case FOBJ:
-		fprintf(f, "#F");
+		put_s(f, "#F");
 		break;
 
 	case EOFOBJ:
-		fprintf(f, "#EOF");
+		put_s(f, "#EOF");
 		break;
 
 	case SYMBOL:
-		fprintf(f, "%s", mcGet_Sym(c));
+		str_room( f, (int)strlen( mcGet_Sym(c) ) );
+		put_s(f, mcGet_Sym(c));
 		break;
 
 	case INT:
-		fprintf(f, "%d", mcGet_Int(c));
+		sprintf(buf, "%d", mcGet_Int(c));
+		put_s(f, buf);
 		break;
 
 	case FLOAT:
-		fprintf(f, REAL_FORMAT, mcGet_Float(c));
+		sprintf(buf, REAL_FORMAT, mcGet_Float(c));
+		put_s(f, buf);
 		break;
 
 	case STRING:
-		if ( d )
-			fprintf(f, "%s", mcGet_Str(c));
-		else fprintf(f, "\"%s\"", mcGet_Str(c));
+		if ( !d )
+			put_s(f, "\"");
+		mcWriteStr( c, f );
+		if ( !d )
+			put_s(f, "\"");
 		break;
 
 	case CHAR:
 		if ( d )
-			fprintf(f, "%c", mcGet_Char(c));
+			sprintf(buf, "%c", mcGet_Char(c));
 		else {
 			if ( mcGet_Char(c) == '\n' )
-				fprintf(f, "#\\newline");
+				sprintf(buf, "#\\newline");
 			else if ( mcGet_Char(c) == ' ' )
-				fprintf(f, "#\\space");
-			else fprintf(f, "#\\%c", mcGet_Char(c));
+				sprintf(buf, "#\\space");
+			else sprintf(buf, "#\\%c", mcGet_Char(c));
 		}
+		put_s(f, buf);
 		break;
 
 	case PORT:
-		fprintf(f, "#<PORT,%p>", mcGet_Port(c));
+		if ( mcStrPort(c) )
+			sprintf(buf, "#<PORT,string>");
+		else sprintf(buf, "#<PORT,%p>", (void *)mcGet_Port(c));
+		put_s(f, buf);
 		break;
 
 	case CFUNC:
-		fprintf(f, "#<Primitive procedure %s>", mcPrim_Name(c));
+		put_s(f, "#<Primitive procedure ");
+		put_s(f, mcPrim_Name(c));
+		put_s(f, ">");
 		break;
 
 	case CFORM:
-		fprintf(f, "#<Primitive form %s>", mcPrim_Name(c));
+		put_s(f, "#<Primitive form ");
+		put_s(f, mcPrim_Name(c));
+		put_s(f, ">");
 		break;
 
 	case FORM:
-		fprintf(f, "#<Form>");
+		put_s(f, "#<Form>");
 		break;
 
 	case BCODES:
-		fprintf(f, "#<Code,%d>", mcBC_CSize(c));
+		sprintf(buf, "#<Code,%d>", mcBC_CSize(c));
+		put_s(f, buf);
 		break;
 
 	case EXEPOINT:
-		fprintf(f, "#<PC,%d>", mcExe_PC(c));
+		sprintf(buf, "#<PC,%d>", mcExe_PC(c));
+		put_s(f, buf);
 		break;
 
 	case CLOSURE:
-		fprintf(f, "#<Closure>");
+		put_s(f, "#<Closure>");
 		break;
 
 	case CONT:
-		fprintf(f, "#<Continuation>");
+		put_s(f, "#<Continuation>");
 		break;
 
 	case VECTOR:
 	      {
 		int cnt;
 
-		fprintf(f, "#(");
+		put_s(f, "#(");
 
 		cnt = 0;
 		if ( cnt < mcVect_Size(c) ) {
 			mcWrite( *mcVect_Ref(c, cnt), f );
 			for ( cnt = 1; cnt < mcVect_Size(c); ++cnt ) {
-				fprintf(f, " ");
+				put_s(f, " ");
 				mcWrite( *mcVect_Ref(c, cnt), f );
 			}
 		}
 
-		fprintf(f, ")");
+		put_s(f, ")");
 	      }
 		break;
 
 	case RESUME:
-		fprintf(f, "#<Resume, %d>", mcGet_Int(c));
+		sprintf(buf, "#<Resume, %d>", mcGet_Int(c));
+		put_s(f, buf);
 		break;
 
 	default:
 		assert(0);
    }
 
-   fflush(f);
+   if ( !mcStrPort(f) )
+	fflush( mcGet_Port(f) );
 }
 
-/* mcEmit(c, f) - Writes the Scheme object c to the file stream f.  Used
+/* mcEmit(c, f) - Writes the Scheme object c to port f.  Used
 	to be called mcWrite() except that I didn't want the definition of
 	mcWrite() to change when I added (DISPLAY obj).  mcWrite(l,p) is a
 	macro expanding to: mcEmit(l, p, FALSE).  mcDisplay(l,p) is a macro
@@ -521,7 +702,7 @@ int d;
 */
 void mcEmit(c, f, d)
 CONS c;
-FILE *f;
+CONS f;
 int d;
 {
    /* NULL is illegal in the list data-type! */
@@ -534,7 +715,7 @@ int d;
    }
 
    /* beginning of a list */
-   fprintf(f, "(");
+   put_s(f, "(");
 
    /* walk thru list */
    while ( !mcNull(c) ) {
@@ -544,16 +725,16 @@ int d;
 
 	/* improper list? */
 	if ( !mcNull(c) && !mcPair(c) ) {
-		fprintf(f, " . ");
+		put_s(f, " . ");
 		mcWriteAtom(c, f, d);
 		break;
 	}
 
 	if ( !mcNull(c) )
-		fprintf(f, " ");
+		put_s(f, " ");
    }
 
-   fprintf(f, ")");
+   put_s(f, ")");
 }
 
 /* ----------------------------------------------------------------------- */
@@ -589,29 +770,26 @@ char *name;
 int mcResLoad(resume)
 CONS resume;
 {
-   ENTER;
-   REG(port);
-   REG(exp);
-   REG(res);
+   CONS port, exp, res;
 
    /* save the resume since it's not guaranteed to be held */
-   R(res) = resume;
+   res = resume;
 
    /* throw away last evaluation */
    mcPopVal();
 
-   R(port) = mcPopVal();
+   port = mcPopVal();
 
    /* read the next expr */
-   if ( (R(exp) = mcRead( mcGet_Port(R(port)) )) == EOF_OBJ ) {
-	mcClose( R(port) );
-	MCLEAVE TRUE;
+   if ( (exp = mcRead( port )) == EOF_OBJ ) {
+	mcClose( port );
+	return TRUE;
    }
 
-   mcPushVal( R(port) );
-   mcPushExpr( R(res) );
-   mcPushExpr( R(exp) );
-   MCLEAVE TRUE;
+   mcPushVal( port );
+   mcPushExpr( res );
+   mcPushExpr( exp );
+   return TRUE;
 }
 
 /* ----------------------------------------------------------------------- */
@@ -627,7 +805,7 @@ FILE *f;
    CONS val;
    int sym, len;
 
-   for ( sym = 0; sym < MAX_SYMBOLS; ++sym ) {
+   for ( sym = 0; sym < (int)mcVect_Size( mcGet_Global(glo_env) ); ++sym ) {
 	/* don't dump:
 	 *	o NULL bindings
 	 *	o CFORMS and CFUNCS
@@ -648,16 +826,34 @@ FILE *f;
    return TRUE;
 }
 
+/* mcDumpStr(c, f) - Writes the characters of string c to the file stream
+	f, a rope a piece at a time.
+*/
+static void mcDumpStr(c, f)
+CONS c;
+FILE *f;
+{
+   if ( mcRope(c) ) {
+	mcDumpStr( mcRope_Left(c), f );
+	mcDumpStr( mcRope_Right(c), f );
+   }
+   else fwrite( mcGet_Str(c), sizeof(char), (size_t)mcStr_Len(c), f );
+}
+
 /* mcDumpCons(c) - Dumps the cons c to the file stream f. */
 static void mcDumpCons(c, f)
 CONS c;
 FILE *f;
 {
+   int kind, i;
+   char ch;
+
    /* write out the scheme type */
-   fwrite( &mcKind(c), sizeof(int), 1, f );
+   kind = mcKind(c);
+   fwrite( &kind, sizeof(int), 1, f );
 
    /* write out the data */
-   switch ( mcKind(c) ) {
+   switch ( kind ) {
 	case NILNODE:
 	case NULLNODE:
 	case TOBJ:
@@ -680,7 +876,8 @@ FILE *f;
 	}
 
 	case INT:
-		fwrite( &mcGet_Int(c), sizeof(int), 1, f );
+		i = mcGet_Int(c);
+		fwrite( &i, sizeof(int), 1, f );
 		return;
 
 	case FLOAT:
@@ -691,17 +888,18 @@ FILE *f;
 	{
 		int len;
 
-		/* write length of symbol */
-		len = strlen( mcGet_Str(c) );
+		/* write length of string */
+		len = (int)mcStr_Len(c);
 		fwrite( &len, sizeof(int), 1, f );
 
 		/* write symbol */
-		fwrite( mcGet_Str(c), sizeof(char), len, f );
+		mcDumpStr( c, f );
 		return;
 	}
 
 	case CHAR:
-		fwrite( &mcGet_Char(c), sizeof(char), 1, f );
+		ch = mcGet_Char(c);
+		fwrite( &ch, sizeof(char), 1, f );
 		return;
 
 	case BCODES:
@@ -759,9 +957,7 @@ FILE *f;
 int mcRestEnv(f)
 FILE *f;
 {
-   ENTER;
-   REG(sym);
-   REG(val);
+   CONS sym, val;
    char *tsym;
    int len;
 
@@ -775,8 +971,6 @@ FILE *f;
 	return FALSE;
    }
 
-   R(sym) = NewCons( SYMBOL, 0, 0 );
-
    while ( TRUE ) {
 
 	/* restore the symbol */
@@ -785,26 +979,25 @@ FILE *f;
 		break;
 	fread( tsym, sizeof(char), len, f );
 	*(tsym+len) = EOS;
-	mcCpy_Sym( R(sym), tsym );
+	sym = ssIntern( tsym );
 
 	/* restore the value */
-	R(val) = mcRestCons( f );
+	val = mcRestCons( f );
 
 	/* bind */
-	evDefGlobal( R(sym), R(val) );
+	evDefGlobal( sym, val );
    }
 
    free( tsym );
 
-   MCLEAVE TRUE;
+   return TRUE;
 }
 
 /* mcRestCons(c) - Restore the next CONS from stream f and return it. */
 static CONS mcRestCons(f)
 FILE *f;
 {
-   ENTER;
-   REG(c);
+   CONS c;
    int kind, len;
    char *tsym;
 
@@ -819,58 +1012,63 @@ FILE *f;
    /* read in the data */
    switch ( kind ) {
 	case NILNODE:
-		R(c) = NIL;
+		c = NIL;
 		break;
 
 	case TOBJ:
-		R(c) = T;
+		c = T;
 		break;
 
 	case FOBJ:
-		R(c) = F;
+		c = F;
 		break;
 
 	case EOFOBJ:
-		R(c) = EOF_OBJ;
+		c = EOF_OBJ;
 		break;
 
 	case SYMBOL:
-		R(c) = NewCons( SYMBOL, 0, 0 );
-
 		/* read the symbol */
 		fread( &len, sizeof(int), 1, f );
 		fread( tsym, sizeof(char), len, f );
 		*(tsym+len) = EOS;
 
-		/* copy the symbol into the CONS node */
-		mcCpy_Sym( R(c), tsym );
+		/* it's the one cell for the symbol */
+		c = ssIntern( tsym );
 		break;
 
 	case INT:
-		R(c) = NewCons( INT, 0, 0 );
-		fread( &mcGet_Int(R(c)), sizeof(int), 1, f );
+	{
+		int i;
+
+		fread( &i, sizeof(int), 1, f );
+		c = mcIntToCons( i );
+	}
 		break;
 
 	case FLOAT:
-		R(c) = NewCons( FLOAT, 0, 0 );
-		fread( &mcGet_Float(R(c)), sizeof(REAL_NUM), 1, f );
+		c = NewCons( FLOAT, 0, 0 );
+		fread( &mcGet_Float(c), sizeof(REAL_NUM), 1, f );
 		break;
 
 	case STRING:
-		R(c) = NewCons( STRING, 0, 0 );
+		c = NewCons( STRING, 0, 0 );
 
-		/* read the symbol */
+		/* read the string straight into the string heap -- it may
+		 * be longer than tsym.
+		 */
 		fread( &len, sizeof(int), 1, f );
-		fread( tsym, sizeof(char), len, f );
-		*(tsym+len) = EOS;
-
-		/* copy the symbol into the CONS node */
-		mcCpy_Str( R(c), tsym );
+		mcSet_Str( c, NewStr( len ) );
+		fread( mcGet_Str(c), sizeof(char), len, f );
 		break;
 
 	case CHAR:
-		R(c) = NewCons( CHAR, 0, 0 );
-		fread( &mcGet_Char(R(c)), sizeof(char), 1, f );
+	{
+		char ch;
+
+		fread( &ch, sizeof(char), 1, f );
+		c = mcCharToCons( (unsigned char)ch );
+	}
 		break;
 
 	case BCODES:
@@ -881,23 +1079,29 @@ FILE *f;
 		fread( &len, sizeof(int), 1, f );
 		fread( &cst, sizeof(int), 1, f );
 
-		R(c) = NewCons( BCODES, len, cst );
+		c = NewCons( BCODES, len, cst );
 
 		/* read the code */
-		fread( mcBC_Code(R(c)), sizeof(char), len, f );
+		fread( mcBC_Code(c), sizeof(char), len, f );
 
 		/* read the constants */
 		for ( cst2 = 0; cst2 < cst; ++cst2 )
-			*(mcBC_Const(R(c))+cst2) = mcRestCons(f);
+		{
+			*(mcBC_Const(c)+cst2) = mcRestCons(f);
+			WBarrier( c, *(mcBC_Const(c)+cst2) );
+		}
 
 	}
 		break;
 
 	case CLOSURE:
-		R(c) = NewCons( CLOSURE, 0, 0 );
-		mcCl_Env( R(c) ) = mcRestCons(f);
-		mcCl_Parms( R(c) ) = mcRestCons(f);
-		mcCl_Body( R(c) ) = mcRestCons(f);
+		c = NewCons( CLOSURE, 0, 0 );
+		mcCl_Env( c ) = mcRestCons(f);
+		WBarrier( c, mcCl_Env(c) );
+		mcCl_Parms( c ) = mcRestCons(f);
+		WBarrier( c, mcCl_Parms(c) );
+		mcCl_Body( c ) = mcRestCons(f);
+		WBarrier( c, mcCl_Body(c) );
 		break;
 
 	case VECTOR:
@@ -905,17 +1109,21 @@ FILE *f;
 		int cnt;
 
 		fread( &len, sizeof(int), 1, f );
-		R(c) = NewCons( VECTOR, len, 0 );
+		c = NewCons( VECTOR, len, 0 );
 
-		for ( cnt = 0; cnt < len; ++cnt )
-			*mcVect_Ref( R(c), cnt) = mcRestCons(f);
+		for ( cnt = 0; cnt < len; ++cnt ) {
+			*mcVect_Ref( c, cnt) = mcRestCons(f);
+			WBarrier( c, *mcVect_Ref(c, cnt) );
+		}
 	}
 		break;
 
 	case PAIR:
-		R(c) = NewCons( PAIR, 0, 0 );
-		mcGet_Car( R(c) ) = mcRestCons(f);
-		mcGet_Cdr( R(c) ) = mcRestCons(f);
+		c = NewCons( PAIR, 0, 0 );
+		mcGet_Car( c ) = mcRestCons(f);
+		WBarrier( c, mcGet_Car(c) );
+		mcGet_Cdr( c ) = mcRestCons(f);
+		WBarrier( c, mcGet_Cdr(c) );
 		break;
 
 	default:
@@ -926,5 +1134,5 @@ FILE *f;
    }
 
    free( tsym );
-   MCLEAVE R(c);
+   return c;
 }
@@ -1,5 +1,13 @@
 /* mc_math.c - the C, low-level MATH functions.
 
+   Version 2
+	- The arithmetic is done on C ints and REAL_NUMs and the result is
+	made into a CONS at the end.  Integer results are fixnums (see
+	micro.c), so integer arithmetic doesn't allocate.  A FLOAT result
+	is still a new cell.
+
+	- The comparisons don't copy their args anymore.
+
    Version 1
 	- Lowest level C routines which manipulate the structures directly.
 
@@ -12,10 +20,6 @@
 
 	- Overflow and Underflow in arithmetic for integers is NOT
 	handled.  Solutions: convert to FLOAT or use long integers.
-
-	- R(num1) = new_cons(); R(num2) = new_cons() results in two cons
-	nodes whose mcKind() == FREE.  Can't figure out why.  Rearranged to
-	be R(num1) = new_cons(); mcCopyCons( R(num1), ...);
 */
 
 #include "machine.h"
@@ -27,33 +31,11 @@
 #include "memory.h"
 #include "error.h"
 
-/* local prototypes */
-void mcCoerce( C_CONS X C_CONS );
+/* the number n as a REAL_NUM */
+#define mcReal(n)	( mcInteger(n) ? (REAL_NUM) mcGet_Int(n) : mcGet_Float(n) )
 
-/* mcCoerce(num1, num2) - Coerces either num1 or num2 so that they're the
-	same type.  Must convert INT's to FLOAT's.
-*/
-void mcCoerce(num1, num2)
-CONS num1, num2;
-{
-   REAL_NUM tfloat;
-
-   /* coerce the numbers to floating point if necessary */
-   if ( mcKind(num1) != mcKind(num2) && mcKind(num1) == FLOAT ) {
-
-	/* num1 = FLOAT, num2 = INT, coerce num2 into float */
-	tfloat = (REAL_NUM) mcGet_Int(num2);
-	mcCpy_Float(num2, tfloat);
-	mcKind(num2) = FLOAT;
-  }
-  else if ( mcKind(num1) != mcKind(num2) && mcKind(num2) == FLOAT ) {
-
-	/* num1 = INT, num2 = FLOAT, coerce num1 into float */
-	tfloat = (REAL_NUM) mcGet_Int(num1);
-	mcCpy_Float(num1, tfloat);
-	mcKind(num1) = FLOAT;
-  }
-}
+/* local prototypes */
+static int mcNumCmp( C_CHAR C_PTR );
 
 /* mcPlus() - Adds the args together and returns their sum.  If only
 	one arg is given, it's added to 0.  If no args are given, 0 is
@@ -61,17 +43,15 @@ CONS num1, num2;
 */
 CONS mcPlus()
 {
-   CONS result, farg;
+   CONS farg;
    int tint;
    REAL_NUM tfloat;
-
-   /* need a node for the result; assume it's an integer, coerce into
-    * float only if need be
-    */
-   result = NewCons( INT, 0, 0 );
+   BOOL real;		/* has a FLOAT turned up? */
 
    /* (+) => 0 */
-   mcCpy_Int(result, 0);
+   tint = 0;
+   tfloat = 0;
+   real = FALSE;
 
    /* loop thru args, summing them */
    while ( (farg = mcPopVal()) != MARK ) {
@@ -80,25 +60,19 @@ CONS mcPlus()
 	if ( !mcNumber(farg) )
 		RT_ERROR("+ requires numbers.");
 
-	/* coerce numbers to same type */
-	mcCoerce(result, farg);
-
-	/* add the numbers */
-	if ( mcInteger(result) ) {
-
-		/* add two integers */
-		tint = mcGet_Int(result) + mcGet_Int(farg);
-		mcCpy_Int(result, tint);
-	}
-	else if ( mcFloat(result) ) {
-
-		/* add two floats */
-		tfloat = mcGet_Float(result) + mcGet_Float(farg);
-		mcCpy_Float(result, tfloat);
+	/* add two integers until a float shows up */
+	if ( !real && mcInteger(farg) )
+		tint += mcGet_Int(farg);
+	else {
+		if ( !real ) {
+			tfloat = (REAL_NUM) tint;
+			real = TRUE;
+		}
+		tfloat += mcReal(farg);
 	}
    }
 
-   return result;
+   return real ? mcFloatToCons(tfloat) : mcIntToCons(tint);
 }
 
 /* mcMinus() - With two or more arguments, - repeatedly subtracts it's
@@ -106,36 +80,28 @@ CONS mcPlus()
 */
 CONS mcMinus()
 {
-   CONS result, farg;
+   CONS farg;
    int tint;
    REAL_NUM tfloat;
+   BOOL real;
 
    /* (-) => 0 */
-   if ( (farg = mcPopVal()) == MARK ) {
-	result = NewCons( INT, 0, 0 );
-	mcCpy_Int(result, 0);
-	return result;
-   }
-   else result = mcCopyCons( farg );
+   if ( (farg = mcPopVal()) == MARK )
+	return mcIntToCons(0);
 
    /* legal input? */
-   if ( !mcNumber(result) )
+   if ( !mcNumber(farg) )
 	RT_ERROR("- requires numbers.");
 
-   /* (- NUMBER) => -NUMBER */
-   if ( (farg = mcPopVal()) == MARK ) {
-
-	/* multiply by -1 */
-	if ( mcInteger(result) ) {
-		tint = mcGet_Int(result) * -1;
-		mcCpy_Int(result, tint);
-	} else if ( mcFloat(result) ) {
-		tfloat = mcGet_Float(result) * -1;
-		mcCpy_Float(result, tfloat);
-	}
+   tint = 0;
+   tfloat = 0;
+   if ( (real = mcFloat(farg)) )
+	tfloat = mcGet_Float(farg);
+   else tint = mcGet_Int(farg);
 
-	return result;
-   }
+   /* (- NUMBER) => -NUMBER */
+   if ( (farg = mcPopVal()) == MARK )
+	return real ? mcFloatToCons(-tfloat) : mcIntToCons(-tint);
 
    /* loop thru args, subtracting them */
    while ( farg != MARK ) {
@@ -144,27 +110,21 @@ CONS mcMinus()
 	if ( !mcNumber(farg) )
 		RT_ERROR("- requires numbers.");
 
-	/* coerce numbers to same type */
-	mcCoerce(result, farg);
-
-	/* subtract the numbers */
-	if ( mcInteger(result) ) {
-
-		/* subtract two integers */
-		tint = mcGet_Int(result) - mcGet_Int(farg);
-		mcCpy_Int(result, tint);
-	}
-	else if ( mcFloat(result) ) {
-
-		/* subtract two floats */
-		tfloat = mcGet_Float(result) - mcGet_Float(farg);
-		mcCpy_Float(result, tfloat);
+	/* subtract two integers until a float shows up */
+	if ( !real && mcInteger(farg) )
+		tint -= mcGet_Int(farg);
+	else {
+		if ( !real ) {
+			tfloat = (REAL_NUM) tint;
+			real = TRUE;
+		}
+		tfloat -= mcReal(farg);
 	}
 
 	farg = mcPopVal();
    }
 
-   return result;
+   return real ? mcFloatToCons(tfloat) : mcIntToCons(tint);
 }
 
 /* mcMult(args) - Multiplies it's args and returns the product.  If only one
@@ -172,18 +132,15 @@ CONS mcMinus()
 */
 CONS mcMult()
 {
-   CONS result, farg;
+   CONS farg;
    int tint;
    REAL_NUM tfloat;
-
-   /* need a node for the result; assume it's an integer, coerce into
-    * float only if need be
-    */
-   result = NewCons( INT, 0, 0 );
+   BOOL real;
 
    /* (*) => 1 */
-   mcKind(result) = INT;
-   mcCpy_Int(result, 1);
+   tint = 1;
+   tfloat = 1;
+   real = FALSE;
 
    /* loop thru args, multiplying them */
    while ( (farg = mcPopVal()) != MARK ) {
@@ -192,25 +149,19 @@ CONS mcMult()
 	if ( !mcNumber(farg) )
 		RT_ERROR("* requires numbers.");
 
-	/* coerce numbers to same type */
-	mcCoerce(result, farg);
-
-	/* multiply the numbers */
-	if ( mcInteger(result) ) {
-
-		/* multiply two integers */
-		tint = mcGet_Int(result) * mcGet_Int(farg);
-		mcCpy_Int(result, tint);
-	}
-	else if ( mcFloat(result) ) {
-
-		/* multiply two floats */
-		tfloat = mcGet_Float(result) * mcGet_Float(farg);
-		mcCpy_Float(result, tfloat);
+	/* multiply two integers until a float shows up */
+	if ( !real && mcInteger(farg) )
+		tint *= mcGet_Int(farg);
+	else {
+		if ( !real ) {
+			tfloat = (REAL_NUM) tint;
+			real = TRUE;
+		}
+		tfloat *= mcReal(farg);
 	}
    }
 
-   return result;
+   return real ? mcFloatToCons(tfloat) : mcIntToCons(tint);
 }
 
 /* mcDiv() - With two or more args, repeatedly divides them in LR order.
@@ -220,34 +171,35 @@ CONS mcMult()
 */
 CONS mcDiv()
 {
-   CONS result, farg;
+   CONS farg;
    int tint;
    REAL_NUM tfloat;
+   BOOL real;
 
    /* have args? */
-   if ( (farg = mcPopVal()) == MARK ) {
+   if ( (farg = mcPopVal()) == MARK )
 	RT_ERROR("/ requires numbers.");
-   } else result = mcCopyCons( farg );
 
    /* is it a number? */
-   if ( !mcNumber(result) )
+   if ( !mcNumber(farg) )
 	RT_ERROR("/ requires numbers.");
 
    /* better not be zero! */
-   if ( mcZero(result) )
+   if ( mcZero(farg) )
 	RT_ERROR("Division by zero.");
 
+   tint = 0;
+   tfloat = 0;
+   if ( (real = mcFloat(farg)) )
+	tfloat = mcGet_Float(farg);
+   else tint = mcGet_Int(farg);
+
    /* (/ NUMBER) => 1/NUMBER */
    if ( (farg = mcPopVal()) == MARK ) {
-	if ( mcInteger(result) )
-		tfloat = (REAL_NUM) mcGet_Int(result);
-	else tfloat = mcGet_Float(result);
+	if ( !real )
+		tfloat = (REAL_NUM) tint;
 
-	tfloat = 1 / tfloat;
-
-	mcKind(result) = FLOAT;
-	mcCpy_Float(result, tfloat);
-	return result;
+	return mcFloatToCons( 1 / tfloat );
    }
 
    /* loop thru args, dividing them */
@@ -261,42 +213,29 @@ CONS mcDiv()
 	if ( mcZero(farg) )
 		RT_ERROR("Division by zero.");
 
-	/* coerce numbers to same type */
-	mcCoerce(result, farg);
-
-	/* divide the numbers */
-	if ( mcInteger(result) ) {
-
-		/* divide two integers */
-		tint = mcGet_Int(result) / mcGet_Int(farg);
-		mcCpy_Int(result, tint);
-	}
-	else if ( mcFloat(result) ) {
-
-		/* divide two floats */
-		tfloat = mcGet_Float(result) / mcGet_Float(farg);
-		mcCpy_Float(result, tfloat);
+	/* divide two integers until a float shows up */
+	if ( !real && mcInteger(farg) )
+		tint /= mcGet_Int(farg);
+	else {
+		if ( !real ) {
+			tfloat = (REAL_NUM) tint;
+			real = TRUE;
+		}
+		tfloat /= mcReal(farg);
 	}
 
 	farg = mcPopVal();
    }
 
-   return result;
+   return real ? mcFloatToCons(tfloat) : mcIntToCons(tint);
 }
 
 /* mcAbs() - 1 arg.  Returns it's absolute value. */
 CONS mcAbs()
 {
-   CONS arg, result;
-   int tint;
+   CONS arg;
    REAL_NUM tfloat;
 
-   /* need node for result; use type INT just temporarily since
-    * rearranging these expressions requires using registers so
-    * the arg won't disappear.
-    */
-   result = NewCons( INT, 0, 0 );
-
    /* pop the argument */
    arg = mcPopVal();
 
@@ -304,247 +243,80 @@ CONS mcAbs()
    if ( !mcNumber(arg) )
 	RT_ERROR("ABS requires a number.");
 
-   mcKind(result) = mcKind(arg);
-
    /* take the absolute value */
-   if ( mcInteger(arg) ) {
-	tint = (int) abs( mcGet_Int(arg) );
-	mcCpy_Int(result, tint);
-   } else {
-	tfloat = mcGet_Float(arg);
-	if ( tfloat < 0 ) tfloat = tfloat * -1;
-	mcCpy_Float(result, tfloat);
-   }
+   if ( mcInteger(arg) )
+	return mcIntToCons( (int) abs( mcGet_Int(arg) ) );
 
-   return result;
+   tfloat = mcGet_Float(arg);
+   if ( tfloat < 0 ) tfloat = tfloat * -1;
+   return mcFloatToCons(tfloat);
 }
 
-/* mcLT() - 2 args */
-CONS mcLT()
+/* mcNumCmp(err) - Pops 2 args and compares them.  Returns < 0, 0, or > 0
+	as the first is less than, equal to, or greater than the second.
+	err is the error message if they aren't both numbers.
+*/
+static int mcNumCmp(err)
+char *err;
 {
-   ENTER;
-   REG(num1);
-   REG(num2);
+   CONS num1, num2;
+   REAL_NUM f1, f2;
 
-   /* get temporary CONS nodes */
-   R(num1) = mcCopyCons( mcPopVal() );
-   R(num2) = mcCopyCons( mcPopVal() );
+   num1 = mcPopVal();
+   num2 = mcPopVal();
 
    /* make sure they're numbers */
-   if ( ! (mcNumber( R(num1) ) && mcNumber( R(num2) )) )
-	RT_ERROR("< requires numbers.");
-
-   /* coerce to same type */
-   mcCoerce( R(num1), R(num2) );
+   if ( ! (mcNumber(num1) && mcNumber(num2)) )
+	RT_ERROR(err);
 
-   if ( mcInteger( R(num1) ) ) {
-	if ( mcGet_Int( R(num1) ) < mcGet_Int( R(num2) ) ) {
-		MCLEAVE T;
-	}
-	else {
-		MCLEAVE F;
-	}
-   }
-   else if ( mcFloat( R(num1) ) ) {
-	if ( mcGet_Float( R(num1) ) < mcGet_Float( R(num2) ) ) {
-		MCLEAVE T;
-	}
-	else {
-		MCLEAVE F;
-	}
+   if ( mcInteger(num1) && mcInteger(num2) ) {
+	if ( mcGet_Int(num1) < mcGet_Int(num2) )
+		return -1;
+	return mcGet_Int(num1) > mcGet_Int(num2);
    }
 
-   MCLEAVE F;
+   /* coerce to float */
+   f1 = mcReal(num1);
+   f2 = mcReal(num2);
+   if ( f1 < f2 )
+	return -1;
+   return f1 > f2;
+}
+
+/* mcLT() - 2 args */
+CONS mcLT()
+{
+   return mcNumCmp("< requires numbers.") < 0 ? T : F;
 }
 
 /* mcGT() - 2 args */
 CONS mcGT()
 {
-   ENTER;
-   REG(num1);
-   REG(num2);
-
-   /* get temporary CONS nodes */
-   R(num1) = mcCopyCons( mcPopVal() );
-   R(num2) = mcCopyCons( mcPopVal() );
-
-   /* make sure they're numbers */
-   if ( ! (mcNumber( R(num1) ) && mcNumber( R(num2) )) )
-	RT_ERROR("> requires numbers.");
-
-   /* coerce to same type */
-   mcCoerce( R(num1), R(num2) );
-
-   if ( mcInteger( R(num1) ) ) {
-	if ( mcGet_Int( R(num1) ) > mcGet_Int( R(num2) ) ) {
-		MCLEAVE T;
-	}
-	else {
-		MCLEAVE F;
-	}
-   }
-   else if ( mcFloat( R(num1) ) ) {
-	if ( mcGet_Float( R(num1) ) > mcGet_Float( R(num2) ) ) {
-		MCLEAVE T;
-	}
-	else {
-		MCLEAVE F;
-	}
-   }
-
-   MCLEAVE F;
+   return mcNumCmp("> requires numbers.") > 0 ? T : F;
 }
 
 /* mcLTE() - 2 args */
 CONS mcLTE()
 {
-   ENTER;
-   REG(num1);
-   REG(num2);
-
-   /* get temporary CONS nodes */
-   R(num1) = mcCopyCons( mcPopVal() );
-   R(num2) = mcCopyCons( mcPopVal() );
-
-   /* make sure they're numbers */
-   if ( ! (mcNumber( R(num1) ) && mcNumber( R(num2) )) )
-	RT_ERROR("<= requires numbers.");
-
-   /* coerce to same type */
-   mcCoerce( R(num1), R(num2) );
-
-   if ( mcInteger( R(num1) ) ) {
-	if ( mcGet_Int( R(num1) ) <= mcGet_Int( R(num2) ) ) {
-		MCLEAVE T;
-	}
-	else {
-		MCLEAVE F;
-	}
-   }
-   else if ( mcFloat( R(num1) ) ) {
-	if ( mcGet_Float( R(num1) ) <= mcGet_Float( R(num2) ) ) {
-		MCLEAVE T;
-	}
-	else {
-		MCLEAVE F;
-	}
-   }
-
-   MCLEAVE F;
+   return mcNumCmp("<= requires numbers.") <= 0 ? T : F;
 }
 
 /* mcGTE() - 2 args */
 CONS mcGTE()
 {
-   ENTER;
-   REG(num1);
-   REG(num2);
-
-   /* get temporary CONS nodes */
-   R(num1) = mcCopyCons( mcPopVal() );
-   R(num2) = mcCopyCons( mcPopVal() );
-
-   /* make sure they're numbers */
-   if ( ! (mcNumber( R(num1) ) && mcNumber( R(num2) )) )
-	RT_ERROR(">= requires numbers.");
-
-   /* coerce to same type */
-   mcCoerce( R(num1), R(num2) );
-
-   if ( mcInteger( R(num1) ) ) {
-	if ( mcGet_Int( R(num1) ) >= mcGet_Int( R(num2) ) ) {
-		MCLEAVE T;
-	}
-	else {
-		MCLEAVE F;
-	}
-   }
-   else if ( mcFloat( R(num1) ) ) {
-	if ( mcGet_Float( R(num1) ) >= mcGet_Float( R(num2) ) ) {
-		MCLEAVE T;
-	}
-	else {
-		MCLEAVE F;
-	}
-   }
-
-   MCLEAVE F;
+   return mcNumCmp(">= requires numbers.") >= 0 ? T : F;
 }
 
 /* mcE() - 2 args */
 CONS mcE()
 {
-   ENTER;
-   REG(num1);
-   REG(num2);
-
-   /* get temporary CONS nodes */
-   R(num1) = mcCopyCons( mcPopVal() );
-   R(num2) = mcCopyCons( mcPopVal() );
-
-   /* make sure they're numbers */
-   if ( ! (mcNumber( R(num1) ) && mcNumber( R(num2) )) )
-	RT_ERROR("= requires numbers.");
-
-   /* coerce to same type */
-   mcCoerce( R(num1), R(num2) );
-
-   if ( mcInteger( R(num1) ) ) {
-	if ( mcGet_Int( R(num1) ) == mcGet_Int( R(num2) ) ) {
-		MCLEAVE T;
-	}
-	else {
-		MCLEAVE F;
-	}
-   }
-   else if ( mcFloat( R(num1) ) ) {
-	if ( mcGet_Float( R(num1) ) == mcGet_Float( R(num2) ) ) {
-		MCLEAVE T;
-	}
-	else {
-		MCLEAVE F;
-	}
-   }
-
-   MCLEAVE F;
+   return mcNumCmp("= requires numbers.") == 0 ? T : F;
 }
 
 /* mcNE() - 2 args */
 CONS mcNE()
 {
-   ENTER;
-   REG(num1);
-   REG(num2);
-
-   /* get temporary CONS nodes */
-   R(num1) = mcCopyCons( mcPopVal() );
-   R(num2) = mcCopyCons( mcPopVal() );
-
-   /* make sure they're numbers */
-   if ( ! (mcNumber( R(num1) ) && mcNumber( R(num2) )) )
-	RT_ERROR("<> requires numbers.");
-
-   /* coerce to same type */
-   mcCoerce( R(num1), R(num2) );
-
-   if ( mcInteger( R(num1) ) ) {
-	if ( mcGet_Int( R(num1) ) != mcGet_Int( R(num2) ) ) {
-		MCLEAVE T;
-	}
-	else {
-		MCLEAVE F;
-	}
-   }
-   else if ( mcFloat( R(num1) ) ) {
-	if ( mcGet_Float( R(num1) ) != mcGet_Float( R(num2) ) ) {
-		MCLEAVE T;
-	}
-	else {
-		MCLEAVE F;
-	}
-   }
-
-   MCLEAVE F;
+   return mcNumCmp("<> requires numbers.") != 0 ? T : F;
 }
 
 /* mcPos() */
@@ -1,7 +1,358 @@
-/* the memory manager - Ver 2 */
+/* the memory manager - Ver 19 */
 
 /* MM notes:
 
+   Version 19 - Small vectors
+
+	- A VECTOR of VECT_INLINE elements or fewer is a VECT_CLS cell, 64
+	bytes with its elements right after the header: mcGet_Vector() is
+	vect_inline() of the cell itself.  Every call of a closure makes a
+	frame (eval.c), and most frames are that small, so a call is one
+	allocation instead of a cell and a payload.  Those vectors have no
+	payload to release or count.
+
+   Version 18 - Stack low-water marks
+
+	- The stacks can be millions of entries deep now (see micro.c),
+	and a minor GC that shaded every entry would cost as much as the
+	recursion.  Everything a minor GC finds on the stacks is OLD after
+	it, so only the entries above the lowest each stack has been since
+	(Low_Expr, Low_Val, Low_Func) can point at a YOUNG cell.  The pops
+	keep the marks; code that stores into a stack below its top has
+	to lower the mark (mcTouchVal()).  A major GC still shades them
+	all.
+
+   Version 17 - String ports
+
+	- A PORT cell with no FILE is a string port (mc_io.c); its
+	characters are a STRING only the port has.  Marking it shades
+	that string.
+
+   Version 16 - Ropes
+
+	- A rope (mcStrApp(), micro.c) is a STRING cell with no characters
+	and two halves, the owner field and a right field.  Marking it
+	shades both.
+
+   Version 15 - String slices
+
+	- A STRING cell is a view: its characters, its length and an owner
+	(struct Str, glo.h).  A slice (mcSubStr()) points into its owner's
+	characters and has no payload of its own; it's a BIG_CLS cell now,
+	and marking it shades the owner.  Only a string with no owner
+	frees its characters.
+
+   Version 14 - Weak symbols
+
+	- The symbol cells (SymCell[], symstr.c) used to be roots, all of
+	them, so a symbol was never collected.  Now a major GC only takes
+	the cells of the symbols bound in glo_env as roots; sweep_symbols()
+	drops every other symbol whose cell it didn't mark from the table.
+	A minor GC takes the symbols added since the last GC (SymNew[]) as
+	roots, as the cells it can't see otherwise are all YOUNG.
+
+	- ssIntern() can hand out a cell the snapshot hasn't reached, so it
+	shades what it finds while a major GC is marking.
+
+	- (GC-STATS) reports the # of symbols in the table.
+
+   Version 13 - String heap
+
+	- A string's characters used to be copied into STRING_SPACE, a
+	fixed buffer that was never reclaimed; a program that made enough
+	strings ran out of it.  Now a string is a payload too: NewStr()
+	hands out a block with the length in front of the characters and
+	an EOS after them (so C can still treat them as a char *), and the
+	block goes back when the STRING cell dies.  mcStr_Len() (micro.h)
+	is the length, without a strlen().
+
+	- The length is in the payload, not the cell, so the cell frees its
+	payload itself even when it's big: a string's large payload isn't
+	on the large object list, it's malloc'ed and dropped when the cell
+	is swept.
+
+	- A program that makes few cells with big payloads wouldn't collect
+	often enough by the cell count alone.  A minor GC also runs once
+	PAY_NURSERY payload bytes have been allocated since the last one,
+	and a major GC is requested when the payloads live have doubled
+	since the last major GC.
+
+   Version 12 - Conservative roots
+
+	- C code used to protect the cells in its locals by declaring them
+	REG() and pushing them on the register stack, and paid a push and
+	a pointer indirection per local for it.  Now a GC scans the C
+	stack itself: every word from shade_stack()'s frame up to the
+	stack base main() hands InitMem() that could point into a cell
+	in use shades the cell.  The registers are spilled onto the stack
+	first (setjmp(), and __builtin_unwind_init() with gcc), so a CONS
+	only held in a register is found too.
+
+	- A word could point into a cell if it's an address within a
+	segment of the heap (the arena, or one of the chunks without
+	MMAP_ARENA) past the header.  A pointer into the middle of a cell
+	counts (the compiler may keep &car instead of the pair), and so
+	does a CONS with the PAIR_TAG.  A FREE cell doesn't.  A minor GC
+	only bothers with YOUNG cells; the sweeper may be at the others.
+
+	- It's conservative: an int that looks like a pointer, or a stale
+	CONS left in a dead frame, keeps a cell alive that isn't.  Cells
+	never move, so that's all it does.  The payloads are only held
+	by their cells, so C code holding a CONS * into a vector must
+	hold the vector too.
+
+	- The register stack is still a root, for the system constants
+	and for cells only held where the GC can't look, like a code
+	buffer's constant table.
+
+   Version 11 - Payload space
+
+	- A vector's elements and a byte-code's code and constant table
+	(the payloads) used to be malloc'ed and free'd one at a time.  Now
+	a payload of up to POOL_MAX bytes comes out of a pool of blocks of
+	its size class (16, 32, ... POOL_MAX bytes).  A pool gets its
+	blocks POOL_CHUNK bytes at a time and keeps them; a dead payload's
+	block just goes back on the pool's free list.  The size of a
+	payload is known from its cell, so a block has no header.
+
+	- A bigger payload is a large object (the 1000 slot global vector
+	is one), malloc'ed with a header that puts it on the large object
+	list.  The list has its own mark and sweep: a major GC marks the
+	payloads of the cells it marks, and sweeps the list as soon as
+	it's done marking.  The unmarked ones are unlinked and handed to
+	the sweeper to free().  The cells that owned them are swept later
+	and leave them alone.  A minor GC frees the large payloads of the
+	YOUNG cells it finds dead itself.
+
+	- The sweeper gives the blocks it frees back in bulk: a segment's
+	worth of blocks at a time goes on the pool's back list, and the
+	allocator takes the whole list when its own free list runs out.
+
+	- (GC-STATS) reports the payload bytes live, and how many the last
+	minor and the last major GC freed.
+
+   Version 10 - Background sweeping
+
+	- The segments a major GC leaves unswept are swept by a sweeper
+	thread, started with the store, as soon as the major GC is over.
+	It goes down every class in the order the allocator does, one
+	segment of each class at a time, so it keeps ahead of the
+	allocators and next_cell() finds the segments swept.  Only the
+	young segments are still swept on the spot (the next minor GC
+	can't find its YOUNG cells otherwise).  --fg-sweep sweeps lazily
+	on the mutator as before.
+
+	- A segment is swept by whoever claims it first: swept goes from
+	FALSE to SWEEPING with a compare and swap.  If the allocator gets
+	to a segment before the sweeper it sweeps it itself; if the
+	sweeper is at it, it waits for it.  Before the next major GC can
+	start marking, the mutator sweeps whatever is still unclaimed and
+	waits for the sweeper to finish.
+
+	- The vectors and byte-code of cells the mutator frees (in a minor
+	GC, or sweeping a segment itself) are handed to the sweeper to
+	free().
+
+	- The sweeper only touches unswept segments.  They hold no YOUNG
+	cells, so a minor GC never needs to look at their marks, and it
+	checks the generation first.
+
+	- (GC-STATS) reports how long next_cell() spent sweeping, which
+	is what the mutator still pays for outside of the GC pauses.
+
+   Version 9 - Parallel marking
+
+	- A major GC that marks all at once (-p0, (GC), or an incremental
+	one that has to be finished) splits the marking between -G<n>
+	threads, the mutator's and n-1 helpers started with the store.
+	Incremental slices and minor GCs are too short to be worth waking
+	the helpers and are still marked by the mutator alone.
+
+	- Every marker has its own work-stealing deque of DEQUE_SIZE gray
+	cells (Chase and Lev).  A marker pushes and pops at the bottom of
+	its own deque without a lock; when it runs dry it steals from the
+	top of somebody else's.  The cells at the top were pushed first,
+	so a thief takes the oldest and biggest pieces of work.  Marking
+	is over when every marker has run dry at once.
+
+	- The roots are dealt out round-robin: whatever shade_roots() left
+	on the gray stack, and the global bindings one binding at a time,
+	since that vector is most of the roots and one marker would
+	otherwise get all of it.
+
+	- Two markers can reach the same cell; a mark bit is set with an
+	atomic or, and only the marker that set it scans the cell.  A
+	marker whose deque is full marks the cell on the spot and notes
+	the overflow, and rescan() picks it up as before.
+
+	- Mark and pause times are wall clock times now (clock() counts
+	the cpu time of every thread).
+
+   Version 8 - Heap policy
+
+	- The heap is sized by how much of it is live.  After a major GC
+	every class is given room for its live cells to be LIVE_PCT of it,
+	on top of the nurseries it needs.  A class that has to grow grows
+	to at least GROW_PCT of its size, so a heap that is filling up
+	isn't collected again for every segment it gains.  Segments that a
+	major GC leaves empty are given back while a class has more than
+	GROW_PCT of what it needs.
+
+	- -H<size> is the size the heap may grow to before the old
+	generation is collected at all: below it, a class that runs short
+	after a minor GC gets more segments instead of a major GC.
+	--heap-min=<size> is the size the heap won't be shrunk below, and
+	--heap-max=<size> the size it can't grow past.  Sizes are in
+	bytes, or K, M or G with a suffix.
+
+	- With MMAP_ARENA (machine.h) the whole of --heap-max is reserved
+	as one arena at startup and segments are handed out of it in
+	order.  It's only address space until a segment is touched.  An
+	empty segment is given back to the OS with madvise() and reused
+	before the arena gives out another.  --thp asks for transparent
+	huge pages on the arena: fewer TLB misses, but a segment given
+	back splits its huge page.  Without MMAP_ARENA segments are
+	malloc'ed in chunks as before, and empty ones are kept for reuse.
+
+   Version 7 - Size classes
+
+	- A pair used to be a whole CONSNODE: a type, a generation and a
+	union as big as a continuation, 40 bytes on a 64 bit machine to
+	hold two pointers.  Now every segment holds cells of one size
+	class:
+
+		PAIR_CLS  pairs, a bare car and cdr (16 bytes)
+		ATOM_CLS  INT, FLOAT, SYMBOL and RESUME cells -- a
+			  type and one word of data (struct Atom, 16 bytes)
+		BIG_CLS   everything else, whole CONSNODEs
+
+	A cache line holds four pairs instead of one and a half.
+
+	- A pair has no room for a type, so the type is in the CONS: a
+	pair's CONS is its address plus PAIR_TAG (micro.h).  mcPair() is a
+	test of the low bits and never touches memory.  Every other cell
+	is 8 byte aligned and untagged.
+
+	- The generations moved out of the cells and into the segment
+	header next to the mark bits, one byte per cell (GenOf() in
+	memory.h).  A FREE cell's generation is UNUSED; the allocator and
+	the sweeps only look at the header to find FREE cells.
+
+	- Each class has its own allocator and its own list of segments.
+	A class that runs out of FREE cells gets a segment of its own
+	after a GC fails to make room.  How much room a class needs is
+	judged by how many cells of it were allocated in the last nursery:
+	a minor GC that leaves a class less than one nursery's worth
+	forces a major GC, less than two requests one.  After a major GC
+	every class is given room for its live cells to double.
+
+   Version 6 - Mark bitmaps and lazy sweeping
+
+	- Cells don't carry a mark anymore.  Every segment has a bitmap
+	with one mark bit per cell.  A segment is SEG_BYTES long and
+	aligned on SEG_BYTES, so masking a cell's address finds the
+	segment and the bit.  Segments are carved out of chunks of
+	CHUNK_SEGS segments to get the alignment.  Clearing the marks of a
+	segment is a memset of its bitmap.
+
+	- Sweeping is lazy.  When a major GC is done marking, it counts the
+	mark bits to find out how much is live, and sweeps the segments on
+	the young list so no YOUNG cell lives on into the next minor GC.
+	Every other segment is left unswept.  next_cell() sweeps a segment
+	just before it bumps thru it, so the sweep is paid for a segment at
+	a time as cells are allocated, and segments the allocator never
+	gets to aren't touched at all.  Whatever is left has to be swept
+	before the next major GC can start marking; that's done a slice
+	at a time too, gc_budget cells every INC_ALLOCS allocations.
+
+	- The snapshot barrier can't look at a mark without finding the
+	segment, so it leaves that to Shade().
+
+   Version 5 - Non-recursive marking
+
+	- The marker no longer recurses.  Shading a cell pushes it on the
+	mark stack (the gray stack) unmarked; the cell is marked when it
+	comes off the stack and its fields are shaded in turn.  Deep car
+	nesting or long chains of continuations can't blow the C stack.
+
+	- The mark stack grows up to MAX_GRAY entries.  Past that, a cell
+	that can't be pushed is marked on the spot and the overflow is
+	noted.  Once the stack drains, the marker rescans the cells being
+	collected: every marked cell has its fields shaded again.  A
+	marked cell with unmarked fields is exactly a cell that overflowed,
+	so the rescan picks up where the overflow left off.
+
+	- Cells come off the mark stack thru a FIFO of PREFETCH_DIST
+	cells.  A cell is prefetched as it goes into the FIFO, so by the
+	time it comes out and is marked it should be in the cache.
+
+	- (GC) forces a full collection.  (GC-STATS) reports how fast the
+	last major GC marked, in cells/second.
+
+   Version 4 - Incremental major collection
+
+	- A major GC is a tri-color mark: white cells are unmarked, gray
+	cells are on the gray stack, black cells are marked and their
+	fields have been shaded.  The roots are shaded all at once
+	when the major GC starts (the snapshot); after that every
+	INC_ALLOCS allocations NewCons() scans gc_budget cells worth of the
+	gray stack.  When the gray stack runs dry, the sweep finishes the
+	collection.  The sweep is still done all at once.
+
+	- Cells allocated while marking are black (allocated marked).
+	Minor GCs are put off until the major GC is over, so an
+	incremental major GC starts while there are still MAJOR_ROOM free
+	cells.  If the store runs out anyway, the major GC is finished all
+	at once.
+
+	- The snapshot barrier.  Storing over a pointer while marking
+	could hide a white cell from the marker: load it into a C
+	variable, overwrite the last pointer to it, then store it into a
+	black cell.  Every store that overwrites a pointer in an existing
+	cell must use SBarrier() (memory.h) on the old value before the
+	store.  Stacks and C variables are roots, shaded at the snapshot,
+	and need no barrier.
+
+	- gc_budget (-p<n> on the command line, or (GC-BUDGET n)) is the
+	pause budget.  0 makes every major GC stop-the-world.  The length
+	of every pause is recorded and (GC-STATS) reports the distribution.
+
+   Version 3 - Generational collection
+
+	- Every cell has a generation: YOUNG cells were allocated since
+	the last GC, OLD cells survived one.  NewCons() hands out YOUNG
+	cells; a collection that finds a YOUNG cell reachable promotes it
+	to OLD in place.  Cells never move, so C code holding a CONS
+	across an allocation is no worse off than before.
+
+	- The nursery: NewCons() bumps a pointer thru the current
+	allocation segment, skipping cells that are still in use.  Fresh
+	segments are all FREE so this is a pure bump-pointer.  Every
+	segment the allocator has bumped thru since the last minor GC is
+	on the young list.
+
+	- Minor GC runs every NURSERY_CONS allocations.  It marks only
+	YOUNG cells -- OLD cells are assumed live and never traced -- and
+	sweeps only the segments on the young list.  Roots are the stacks,
+	the nested bindings of glo_env, and the remembered set.  The cost
+	is proportional to the surviving cells, not the size of the heap.
+
+	- Major GC marks and sweeps the entire store.  It runs when a minor
+	GC leaves fewer than NURSERY_CONS free cells, or when the cells
+	promoted since the last major GC outnumber the cells that were
+	live after it (the old generation doubled).
+
+	- The write barrier.  An OLD cell that is made to point at a YOUNG
+	cell must be on the remembered set or a minor GC would never see
+	the YOUNG cell.  Any code storing a CONS into a field of a cell
+	that could have been allocated before the last allocation must use
+	WBarrier() (memory.h) after the store.  mcSetCar(), mcSetCdr(),
+	evDefGlobal() and opVectSet() do this already.  Storing into a
+	cell straight out of NewCons() with no allocation in between needs
+	no barrier.  The nested bindings of glo_env are a root instead.
+
+   Version 2
+
 	- When collecting byte-code, the code and the constant table must
 	be explicity freed since they were explicity alloced.
 
@@ -24,9 +375,6 @@
 		doesn't steal the nodes invisiblely.  register variables
 		are placed on the stack.
 
-	- free_cons is a free-list linked by the cdr.  use the macro:
-	next_free(c).
-
 	- segment size is 850 cons nodes, roughly 10k on a PC
 */
 
@@ -38,6 +386,24 @@
 
 #include STDLIB_H
 #include MEMORY_H
+#include STRING_H
+#include <stddef.h>
+#include <time.h>
+
+#ifdef GC_THREADS
+#	include <pthread.h>
+#	include <sched.h>
+#endif
+
+#ifdef MMAP_ARENA
+#	include <sys/mman.h>
+#	ifndef MAP_ANONYMOUS
+#		define MAP_ANONYMOUS	MAP_ANON
+#	endif
+#	ifndef MAP_NORESERVE
+#		define MAP_NORESERVE	0
+#	endif
+#endif
 
 #include "glo.h"
 #include "symstr.h"
@@ -46,46 +412,374 @@
 #include "memory.h"
 
 /* macros */
-#define next_free(c)		mcGet_Cdr(c)	/* next node on free-list */
-#define mark(p)			((p) -> mmark)	/* set mark */
+#define mark(p)			(mark_byte(p) & mark_bit(p))	/* marked? */
+#define set_mark(p)		(mark_byte(p) |= mark_bit(p))
+
+/* during a minor GC, OLD cells are taken to be live and aren't traced.
+	the sweeper may be clearing the marks of OLD cells.
+*/
+#define marked(p)		( minor ? GenOf(p) != YOUNG || mark(p) : mark(p) )
+
+/* a segment is swept by whoever claims it first.  see the notes. */
+#define SWEEPING		2
+#ifdef GC_THREADS
+#	define is_swept(s)	( __atomic_load_n( &(s)->swept, __ATOMIC_ACQUIRE ) == TRUE )
+#	define set_swept(s)	__atomic_store_n( &(s)->swept, TRUE, __ATOMIC_RELEASE )
+#else
+#	define is_swept(s)	( (s)->swept == TRUE )
+#	define set_swept(s)	( (s)->swept = TRUE )
+#endif
+
+/* the sweeper reads the generations of live OLD cells while the mutator
+	remembers them.  it only cares that they aren't YOUNG or UNUSED.
+*/
+#ifdef GC_THREADS
+#	define gen_at(s, i)	__atomic_load_n( &(s)->gen[i], __ATOMIC_RELAXED )
+#	define set_gen(p, g)	__atomic_store_n( &GenOf(p), (g), __ATOMIC_RELAXED )
+#else
+#	define gen_at(s, i)	( (s)->gen[i] )
+#	define set_gen(p, g)	( GenOf(p) = (g) )
+#endif
+
+/* shade p from marker m, or onto the gray stack if m is NULL */
+#ifdef GC_THREADS
+#	define shade(m, p)	( (m) == NULL ? Shade(p) : m_shade( (m), (p) ) )
+
+/* the markers of a parallel major GC share the mark bits.  m_set_mark()
+	is TRUE for the one marker that sets it.
+*/
+#	define m_mark(p)	(__atomic_load_n( &mark_byte(p), __ATOMIC_RELAXED ) & mark_bit(p))
+#	define m_set_mark(p)	((__atomic_fetch_or( &mark_byte(p), mark_bit(p), __ATOMIC_RELAXED ) & mark_bit(p)) == 0)
+#else
+#	define shade(m, p)	Shade(p)
+#endif
 
 /* global definitions */
 int torture = FALSE;
 int gc_debug = FALSE;
+int gc_marking = FALSE;			/* incremental major GC marking? */
+long gc_budget;				/* cells to scan per GC slice */
 
 /* private definitions */
-#define ALLOC_CONS	500	/* # of cons nodes to allocate for malloc */
-#define INIT_SEGS	1	/* initial # of segments */
+#define CHUNK_SEGS	16	/* # of segments to malloc at a time */
+#define INIT_SEGS	1	/* initial # of segments per class */
+#define LIVE_PCT	50	/* live cells as a % of a class, after a major GC */
+#define GROW_PCT	150	/* a class that has to grow grows to this % */
+#define DEF_HEAP_MAX	(1024L * 1024L * 1024L)	/* default --heap-max */
+#define NURSERY_CONS	2000	/* allocations between minor GCs */
+#define PAY_NURSERY	(256L * 1024L)	/* payload bytes between minor GCs */
+#define INIT_REMSET	256	/* initial size of the remembered set */
+#define INIT_GRAY	256	/* initial size of the gray stack */
+#define MAX_GRAY	65536L	/* max size of the gray stack */
+#define PREFETCH_DIST	8	/* size of the mark FIFO */
+#define MAX_THREADS	64	/* max -G */
+#define DEQUE_SIZE	32768L	/* gray cells a marker's deque holds; a power of 2 */
+#define INIT_DEAD	256	/* initial size of the sweeper's free queue */
+#define POOL_MIN	16	/* bytes in the smallest pool block */
+#define POOL_CNT	6	/* # of pools, 16 to 512 byte blocks */
+#define POOL_MAX	(POOL_MIN << (POOL_CNT-1))	/* larger payloads are large objects */
+#define POOL_CHUNK	16384L	/* bytes a pool gets at a time */
+#define INC_ALLOCS	32	/* allocations between GC slices */
+#define DEF_BUDGET	256L	/* default gc_budget */
+#define PAUSE_BUCKETS	6	/* # of buckets in the pause histogram */
+
+/* size classes */
+#define PAIR_CLS	0	/* pairs */
+#define ATOM_CLS	1	/* cells with one word of data */
+#define BIG_CLS		2	/* CONSNODEs */
+#define VECT_CLS	3	/* small VECTORs with their elements */
+#define NUM_CLS		4
+
+#define class_of(k)	( (k) == PAIR ? PAIR_CLS : \
+			  (k) == INT || (k) == FLOAT || (k) == SYMBOL || \
+			  (k) == RESUME ? ATOM_CLS : BIG_CLS )
+
+/* the elements of a VECT_CLS vector start right after its header */
+#define VECT_INLINE	5
+#define VECT_BYTES	((int)(offsetof(CONSNODE, data) + sizeof(struct Vector) + VECT_INLINE * sizeof(CONS)))
+#define vect_inline(a)	((CONS *)(&(a)->data.vector + 1))
 
 /* private structures */
-struct Seg {
-   struct Seg *next;
-   CONS first;
+struct Cls {
+   char *name;
+   int size;			/* bytes per cell */
+   int shift;			/* log2(size); 0 for BIG_CLS */
+   int tag;			/* added to a cell's address to make a CONS */
+   int ncells;			/* # of cells in one of its segments */
+   SEGMENT *segs;		/* its segments */
+   SEGMENT *alloc_seg;		/* segment being bumped thru */
+   SEGMENT *scan_seg;		/* next segment to bump thru */
+   int alloc_next;		/* next cell in alloc_seg to look at */
+   long total, free;		/* # of cells, # of FREE cells */
+   long live;			/* # live after the last major GC */
+   long nursery;		/* # allocated since the last minor GC */
+   long allocs;			/* # allocated between the last two minor GCs */
+   long made;			/* # allocated before the last GC */
 } ;
-typedef struct Seg SEGMENT;
+typedef struct Cls CLASS;
+
+/* a marker thread of a parallel major GC.  the owner pushes and pops at
+	bottom, thieves take from top.
+*/
+struct Marker {
+   CONS *deque;			/* DEQUE_SIZE gray cells */
+   long top, bottom;
+   long cells;			/* # of cells it marked */
+   long bytes;			/* payload bytes of those cells */
+   int id;
+   char pad[64];		/* keep markers out of each other's cache lines */
+} ;
+typedef struct Marker MARKER;
+
+/* payloads (vectors, byte-code, strings) waiting for the sweeper to free them */
+struct Dead {
+   void **p;
+   long cnt, max;
+} ;
+typedef struct Dead DEAD;
+
+/* a pool of payload blocks of one size.  FREE blocks are linked thru
+	their first word.
+*/
+struct Pool {
+   int size;			/* bytes per block */
+   void *free;			/* the allocator's FREE blocks */
+   void *back;			/* blocks the sweeper gave back (sweep_lock) */
+   long chunks;			/* # of chunks malloc'ed */
+} ;
+typedef struct Pool POOL;
+
+/* the header of a large object, in front of the payload */
+struct Large {
+   struct Large *next, *prev;	/* the large object list */
+   long bytes;			/* payload bytes */
+   long mark;			/* marked in this major GC? */
+} ;
+typedef struct Large LARGE;
+
+/* the header of large payload p; the pool of a small payload of n bytes */
+#define large_of(p)	((LARGE *)(p) - 1)
+#define is_large(n)	((n) > POOL_MAX)
+
+/* does cell a have payloads? */
+#define has_payload(a)	( !mcPair(a) && (mcKind(a) == VECTOR || mcKind(a) == BCODES || \
+				mcKind(a) == STRING) )
+
+/* payload bytes of a vector of n elements */
+#define vect_bytes(n)	((long)(n) * (long)sizeof(CONS))
+
+/* a string's payload: its length, the characters and an EOS */
+#define str_block(s)	((long *)(s) - 1)
+#define str_bytes(n)	((long)sizeof(long) + (long)(n) + 1L)
+
+/* the sweeper lets go of payloads too */
+#ifdef GC_THREADS
+#	define pay_add(n)	((void)__atomic_add_fetch( &pay_live, (n), __ATOMIC_RELAXED ))
+#	define pay_bytes()	__atomic_load_n( &pay_live, __ATOMIC_RELAXED )
+#else
+#	define pay_add(n)	( pay_live += (n) )
+#	define pay_bytes()	pay_live
+#endif
+
+/* the header takes up the front of a segment, the cells the rest */
+#define HDR_BYTES	((sizeof(SEGMENT) + 15) & ~(unsigned)15)
+
+/* the mark bit of cell p */
+#define mark_byte(p)	(seg_of(p)->marks[cell_no(seg_of(p), (p)) >> 3])
+#define mark_bit(p)	(1 << (cell_no(seg_of(p), (p)) & 7))
+
+/* is the i'th cell in segment s marked?  the i'th cell itself. */
+#define seg_marked(s, i)	((s)->marks[(i) >> 3] & (1 << ((i) & 7)))
+#define cell_at(s, i)	((CONS)((s)->first + (long)(i) * (s)->size + (s)->tag))
+
+/* FREE cells a class should have to get thru n nurseries, and for its
+	live cells to be LIVE_PCT of it.
+*/
+#define room(cl, n)	((n) * (cl)->allocs)
+#define need(cl)	((cl)->live * (100 - LIVE_PCT) / LIVE_PCT)
 
 /* private variables */
-static CONS free_cons;			/* free list for cons nodes */
 static SEGMENT *store;			/* pointer to first SEG */
+static char *chunk_next;		/* next segment in the arena/chunk */
+static long chunk_left;			/* # of segments left in it */
+#ifdef MMAP_ARENA
+static char *arena;			/* the first segment in the arena */
+#else
+static char **chunk_tab;		/* the chunks, in address order */
+static long chunk_cnt;
+#endif
+static char *stack_base;		/* the C stack is scanned up to here */
+static long stack_words, stack_cells;	/* scanned by the last GC, shaded */
+static char **free_segs;		/* segments given back */
+static long free_seg_cnt;
+
+static long heap_goal;			/* -H, bytes */
+static long heap_min, heap_max;		/* --heap-min, --heap-max, bytes */
+static long heap_segs;			/* # of segments in the heap */
+static long given_back;			/* # of segments given back */
+static BOOL use_thp;			/* --thp */
+static SEGMENT *young_segs;		/* segments holding YOUNG cells */
+static CLASS classes[NUM_CLS];		/* the size classes */
+
+static SEGMENT *lazy_seg;		/* next segment to sweep in a slice */
+static BOOL sweep_pending;		/* sweeping so a major GC can start? */
+
+static long total_cnt;			/* # of cells in the store */
+static long free_cnt;			/* # of FREE cells in the store */
+static long nursery_cnt;		/* # allocated since the last minor GC */
+static long promoted;			/* # promoted since the last major GC */
+static long live_major;			/* # live after the last major GC */
+static long minor_cnt, major_cnt;	/* # of collections, for stats */
+static long lazy_cnt;			/* # of segments swept lazily */
+static double lazy_us;			/* time next_cell() spent sweeping */
+static long bg_cnt;			/* # of them swept by the sweeper */
+
+static CONS *remset;			/* the remembered set */
+static int rem_cnt, rem_max;
+
+static BOOL minor;			/* is the GC in progress minor? */
+
+static CONS *gray;			/* the gray stack */
+static long gray_cnt, gray_max;
+static BOOL overflow;			/* gray stack overflowed? */
+static BOOL rescanning;			/* in rescan()? */
+static CONS fifo[PREFETCH_DIST];	/* cells on their way to be marked */
+static int fifo_in, fifo_out, fifo_cnt;
+
+static int gc_threads;			/* -G, # of markers */
+#ifdef GC_THREADS
+static MARKER *markers;
+static pthread_mutex_t mark_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t mark_go = PTHREAD_COND_INITIALIZER;	/* mark_phase changed */
+static pthread_cond_t mark_done = PTHREAD_COND_INITIALIZER;	/* mark_running is 0 */
+static long mark_phase;			/* bumped to start the helpers */
+static int mark_running;		/* # of helpers still marking */
+static int mark_idle;			/* # of markers out of work */
+#endif
+
+static BOOL bg_sweep;			/* is there a sweeper? */
+#ifdef GC_THREADS
+static pthread_mutex_t sweep_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sweep_go = PTHREAD_COND_INITIALIZER;	/* work for the sweeper */
+static pthread_cond_t sweep_idle = PTHREAD_COND_INITIALIZER;	/* sweep_busy is FALSE */
+static BOOL sweep_run;			/* a store to sweep */
+static BOOL sweep_busy;			/* sweeping it */
+static SEGMENT *sweep_from[NUM_CLS];	/* where it is in each class */
+static void *bg_blocks[POOL_CNT];	/* blocks it freed in this segment */
+static void *bg_last[POOL_CNT];		/* the last of them */
+static DEAD dead_q, dead_own;		/* queued payloads; the sweeper's */
+#endif
+
+/* the payload space */
+static POOL pools[POOL_CNT];
+static LARGE los;			/* head of the large object list */
+static long los_cnt;			/* # of large objects */
+static long pay_live;			/* payload bytes in use */
+static long pay_minor, pay_major;	/* bytes freed by the last minor, major GC */
+static long pay_young;			/* bytes allocated since the last minor GC */
+static long pay_old;			/* bytes live after the last major GC */
+
+/* mark statistics for the last major GC */
+static long mark_cells;			/* cells marked */
+static long mark_bytes;			/* payload bytes of cells marked */
+static double mark_us;			/* time spent marking */
+static int mark_threads;		/* # of markers that took part */
+static long last_cells;
+static double last_us;
+static int last_threads;
+static int slice_cnt;			/* allocations since the last slice */
+
+/* pause statistics */
+static double pause_start;
+static long pause_cnt[PAUSE_BUCKETS];
+static long pause_tot;			/* # of pauses */
+static double pause_sum, pause_max;	/* in micro-seconds */
+static long pause_lim[PAUSE_BUCKETS-1] = { 10L, 100L, 1000L, 10000L, 100000L };
 
 /* private prototypes */
-static BOOL add_segment( C_VOID );
-static void old_cons( C_CONS );
-static void mrkatom( C_CONS );
-static void mrklist( C_CONS );
-static void mark_all( C_VOID );
-static BOOL GC( C_VOID );
-static int cnt_free( C_VOID );
-
-/* init_mem() - setup MM.  Initialize globals and store. */
-void InitMem(argc, argv)
+static void init_class( CLASS *, char *, int, int );
+static SEGMENT *get_segment( C_VOID );
+static void put_segment( SEGMENT * );
+static SEGMENT *heap_seg( PTR_INT );
+static BOOL add_segment( CLASS * );
+static CONS next_cell( CLASS * );
+static void reset_alloc( C_VOID );
+static BOOL short_of( C_INT );
+static void grow( C_INT X C_INT X C_LONG );
+static BOOL seg_empty( SEGMENT * );
+static void shrink( C_VOID );
+static void old_cons( SEGMENT *, int, BOOL );
+static int pool_of( C_LONG );
+static void *pay_alloc( C_LONG );
+static void pay_release( void *, long, BOOL );
+static void str_release( char *, BOOL );
+static void mark_payload( CONS, MARKER * );
+static long sweep_large( C_VOID );
+static void drop( void *, BOOL );
+static BOOL claim( SEGMENT * );
+static long sweep_seg( SEGMENT *, BOOL );
+static void sweep_all( C_VOID );
+static BOOL sweep_slice( long );
+#ifdef GC_THREADS
+static void start_sweeper( C_VOID );
+static void *sweeper_main( void * );
+static void bg_sweep_store( C_VOID );
+static void bg_give_back( C_VOID );
+static void sweep_post( BOOL );
+static void sweep_wait( C_VOID );
+#endif
+static long count_marks( SEGMENT * );
+static void mrkfields( CONS, MARKER * );
+static CONS mark_pop( C_VOID );
+static BOOL mark_drain( long );
+#ifdef GC_THREADS
+static void start_markers( C_VOID );
+static void *marker_main( void * );
+static void par_mark( C_VOID );
+static void m_drain( MARKER * );
+static void m_shade( MARKER *, CONS );
+static BOOL m_push( MARKER *, CONS );
+static CONS m_pop( MARKER * );
+static CONS m_steal( MARKER * );
+static BOOL m_work( C_VOID );
+#endif
+static void rescan( C_VOID );
+static CONS stack_cell( PTR_INT );
+static void shade_stack( C_VOID );
+static void shade_roots( C_VOID );
+static void minor_gc( C_VOID );
+static void major_request( C_VOID );
+static void major_start( C_VOID );
+static BOOL major_slice( long );
+static void major_sweep( C_VOID );
+static void sweep_symbols( C_VOID );
+static void major_gc( C_VOID );
+static void collect( C_VOID );
+static double now_us( C_VOID );
+static void begin_pause( C_VOID );
+static void end_pause( C_VOID );
+
+/* init_mem() - setup MM.  Initialize globals and store.  base is the
+	address of a local in main(); the C stack is scanned up to it.
+*/
+void InitMem(argc, argv, base)
 int argc;
 char *argv[];
+char *base;
 {
    int l;
 
    gc_debug = FALSE;
    torture = FALSE;
+   gc_marking = FALSE;
+   gc_budget = DEF_BUDGET;
+   heap_goal = heap_min = 0;
+   heap_max = DEF_HEAP_MAX;
+   use_thp = FALSE;
+   gc_threads = 1;
+   bg_sweep = TRUE;
+   stack_base = base;
+   stack_words = stack_cells = 0;
 
    /* command line arguments */
    for ( l = 0; l < argc; l++ ) {
@@ -98,30 +792,164 @@ char *argv[];
 		   case 't':
 			torture = TRUE;
 			break;
+
+		   case 'p':
+			gc_budget = atol( &argv[l][2] );
+			break;
+
+		   case 'H':
+			heap_goal = MemSize( &argv[l][2] );
+			break;
+
+		   case 'G':
+			gc_threads = atoi( &argv[l][2] );
+			break;
+
+		   case '-':
+			if ( strncmp( argv[l], "--heap-min=", 11 ) == 0 )
+				heap_min = MemSize( &argv[l][11] );
+			else if ( strncmp( argv[l], "--heap-max=", 11 ) == 0 )
+				heap_max = MemSize( &argv[l][11] );
+			else if ( strcmp( argv[l], "--thp" ) == 0 )
+				use_thp = TRUE;
+			else if ( strcmp( argv[l], "--fg-sweep" ) == 0 )
+				bg_sweep = FALSE;
+			break;
 		}
 	}
    }
 
-   /* no free-list yet */
-   free_cons = NULL;
+   /* the heap holds at least the initial segments; -H and --heap-min
+    * are within --heap-max.
+    */
+   if ( heap_max < heap_min )
+	heap_max = heap_min;
+   if ( heap_max < NUM_CLS * INIT_SEGS * SEG_BYTES )
+	heap_max = NUM_CLS * INIT_SEGS * SEG_BYTES;
+   heap_max -= heap_max % SEG_BYTES;
+   if ( heap_goal < heap_min )
+	heap_goal = heap_min;
+   if ( heap_goal > heap_max )
+	heap_goal = heap_max;
+
+   /* no store yet */
+   store = young_segs = lazy_seg = NULL;
+   sweep_pending = FALSE;
+   chunk_next = NULL;
+   chunk_left = 0;
+   heap_segs = given_back = 0;
+
+   /* room to keep track of every segment given back */
+   free_seg_cnt = 0;
+   if ( (free_segs = (char **)malloc( (size_t)(heap_max / SEG_BYTES) * sizeof(char *) )) == NULL ) {
+	FATAL("MM ERROR in InitMem: Can't allocate segment table.");
+   }
+
+#ifdef MMAP_ARENA
+   /* reserve the whole heap, with a segment to spare to align it */
+   if ( (chunk_next = (char *)mmap( NULL, (size_t)(heap_max + SEG_BYTES), PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 )) == (char *)MAP_FAILED ) {
+	FATAL("MM ERROR in InitMem: Can't reserve the heap; try a smaller --heap-max.");
+   }
+
+   chunk_next = arena = (char *)( ((PTR_INT)chunk_next + SEG_BYTES-1) & ~(PTR_INT)(SEG_BYTES-1) );
+   chunk_left = heap_max / SEG_BYTES;
+
+#ifdef MADV_HUGEPAGE
+   if ( use_thp )
+	(void)madvise( chunk_next, (size_t)heap_max, MADV_HUGEPAGE );
+#endif
+#else
+   /* room for every chunk the heap could need */
+   chunk_cnt = 0;
+   if ( (chunk_tab = (char **)malloc( (size_t)(heap_max / (CHUNK_SEGS * SEG_BYTES) + 2) * sizeof(char *) )) == NULL ) {
+	FATAL("MM ERROR in InitMem: Can't allocate chunk table.");
+   }
+#endif
+
+   init_class( &classes[PAIR_CLS], "pairs", sizeof(struct Pair), PAIR_TAG );
+   init_class( &classes[ATOM_CLS], "atoms", sizeof(struct Atom), 0 );
+   init_class( &classes[BIG_CLS], "cells", (int)BIG_BYTES, 0 );
+   init_class( &classes[VECT_CLS], "vectors", VECT_BYTES, 0 );
+   reset_alloc();
+
+   /* empty payload space */
+   for ( l = 0; l < POOL_CNT; ++l ) {
+	pools[l].size = POOL_MIN << l;
+	pools[l].free = pools[l].back = NULL;
+	pools[l].chunks = 0;
+   }
+   los.next = los.prev = &los;
+   los_cnt = pay_live = pay_minor = pay_major = pay_young = pay_old = 0;
+
+   total_cnt = free_cnt = nursery_cnt = promoted = live_major = 0;
+   minor_cnt = major_cnt = lazy_cnt = bg_cnt = 0;
+   lazy_us = 0.0;
+
+   /* empty remembered set */
+   if ( (remset = (CONS *)malloc( INIT_REMSET * sizeof(CONS) )) == NULL ) {
+	FATAL("MM ERROR in InitMem: Can't allocate remembered set.");
+   }
+   rem_cnt = 0;
+   rem_max = INIT_REMSET;
+
+   /* empty gray stack */
+   if ( (gray = (CONS *)malloc( INIT_GRAY * sizeof(CONS) )) == NULL ) {
+	FATAL("MM ERROR in InitMem: Can't allocate gray stack.");
+   }
+   gray_cnt = 0;
+   gray_max = INIT_GRAY;
+   overflow = FALSE;
+   fifo_in = fifo_out = fifo_cnt = 0;
+
+   last_cells = 0;
+   last_us = 0.0;
+   last_threads = mark_threads = 1;
+   slice_cnt = 0;
+
+   /* the markers */
+   if ( gc_threads < 1 )
+	gc_threads = 1;
+   if ( gc_threads > MAX_THREADS )
+	gc_threads = MAX_THREADS;
+#ifdef GC_THREADS
+   if ( gc_threads > 1 )
+	start_markers();
+   if ( bg_sweep )
+	start_sweeper();
+#else
+   gc_threads = 1;
+   bg_sweep = FALSE;
+#endif
 
-   /* no store yet either */
-   store = NULL;
+   pause_tot = 0;
+   pause_sum = pause_max = 0.0;
+   for ( l = 0; l < PAUSE_BUCKETS; ++l )
+	pause_cnt[l] = 0;
 }
 
 /* GetMem() - Get initial memory. */
 void GetMem()
 {
-   int l;
+   int l, c;
 
    /* get initial memory */
-   for (l = 1; l <= INIT_SEGS; l++) {
-	if ( (add_segment()) == FALSE ) {
-		FATAL("MM ERROR in get_memory:  Not enough initial memory.");
+   for (c = 0; c < NUM_CLS; c++) {
+	for (l = 1; l <= INIT_SEGS; l++) {
+		if ( (add_segment( &classes[c] )) == FALSE ) {
+			FATAL("MM ERROR in get_memory:  Not enough initial memory.");
+		}
 	}
    }
 }
 
+/* CellBytes(type) - returns the # of bytes in a cell of the type. */
+int CellBytes(type)
+int type;
+{
+   return classes[class_of(type)].size;
+}
+
 /* NewCons(type, size, csize) - returns a new cons node with specified type.
 	some types require additional memory of specified size.
 */
@@ -129,40 +957,70 @@ CONS NewCons(type, size, csize)
 int type, size, csize;
 {
    CONS temp;		/* safe because GC will come before allocation */
+   CLASS *cl;
+
+   cl = &classes[type == VECTOR && size <= VECT_INLINE ? VECT_CLS : class_of(type)];
+
+   if ( torture && store != NULL ) {
+	/* TORTURE: GC before EVERY allocation!  alternate minor and
+	 * major collections so both get exercised.  a major GC is
+	 * done a cell at a time to exercise the snapshot barrier.
+	 */
+	begin_pause();
+	if ( gc_marking )
+		(void)major_slice( 1L );
+	else if ( (minor_cnt + major_cnt) % 2 == 0 )
+		minor_gc();
+	else major_start();
+	end_pause();
+   }
+   else if ( gc_marking ) {
+	/* incremental major GC in progress */
+	if ( ++slice_cnt >= INC_ALLOCS ) {
+		slice_cnt = 0;
+		begin_pause();
+		(void)major_slice( gc_budget );
+		end_pause();
+	}
+   }
+   else if ( sweep_pending && ++slice_cnt >= INC_ALLOCS ) {
+	/* a major GC is waiting for the last one's sweep to finish */
+	slice_cnt = 0;
+	begin_pause();
+	if ( sweep_slice( gc_budget ) )
+		major_start();
+	end_pause();
+   }
+   else if ( nursery_cnt >= NURSERY_CONS || pay_young >= PAY_NURSERY ) {
+	/* nursery is full */
+	GC_DEBUG( "\nGCing\n" );
+	collect();
+   }
 
-   /* the new cons node is the first in line from the free list.
-    * if the free list is empty, a new segment	is allocated.
-    * if we fail again, the program is terminated.
+   /* the new cons node is the next FREE cell of its class in the
+    * nursery.  if the class is full, collect.  if that doesn't free
+    * any, the class gets another segment.  if we fail again, the
+    * program is terminated.
     */
-   if ( torture ) {
-	/* TORTURE: GC before EVERY allocation! */
-	if ( GC() != TRUE ) {
-		if ( add_segment() != TRUE )
-			FATAL("MM ERROR WITH TORTURE: No memory left.\n");
-	}
-   } else {
-	/* do we need memory? (1) GC (2) all nodes in use so get more */
-	if ( free_cons == NULL ) {
-		GC_DEBUG( "\nGCing\n" );
-		if ( GC() != TRUE ) {
-			GC_DEBUG( "\nGC failed.  adding segment!\n" );
-			if ( add_segment() != TRUE )
-				FATAL("MM ERROR in new_cons: No more memory.\n");
-		}
+   if ( (temp = next_cell(cl)) == NULL ) {
+	GC_DEBUG( "\nGCing\n" );
+	collect();
+	if ( (temp = next_cell(cl)) == NULL ) {
+		GC_DEBUG( "\nGC failed.  adding segment!\n" );
+		if ( add_segment(cl) == FALSE || (temp = next_cell(cl)) == NULL )
+			FATAL("MM ERROR in new_cons: No more memory.\n");
 	}
    }
 
-   /* we better have memory by now! */
-   assert( free_cons != NULL );
+   /* cells allocated while marking are black */
+   if ( gc_marking )
+	set_mark(temp);
 
-   /* take first cons node from free_cons */
-   temp = free_cons;
-   free_cons = next_free(free_cons);
-
-   assert( mcKind(temp) == FREE );	/* just to make sure */
-
-   mark(temp) = FALSE;
-   mcKind(temp) = type;
+   /* a pair's type is in its CONS */
+   if ( type != PAIR ) {
+	assert( mcKind(temp) == FREE );	/* just to make sure */
+	mcSetKind(temp, type);
+   }
 
    /* reset pntrs so that a garbage-collection won't send us off
     * into never-never land.
@@ -170,26 +1028,38 @@ int type, size, csize;
    switch ( type ) {
       case VECTOR:
 	mcVect_Size(temp) = size;
-	if ( (mcGet_Vector(temp) = (CONS *)malloc( size * sizeof(CONS) )) == NULL ) {
+	if ( size <= VECT_INLINE )
+		mcGet_Vector(temp) = vect_inline(temp);
+	else if ( (mcGet_Vector(temp) = (CONS *)pay_alloc( vect_bytes(size) )) == NULL ) {
+		mcVect_Size(temp) = 0;
 		RT_ERROR("Out of memory; can't allocate vector.");
 	}
 
-	mcVectorFill( temp, NIL );
+      {
+	int elt;
+
+	/* not mcVectorFill() -- there's nothing to shade yet */
+	for ( elt = 0; elt < size; ++elt )
+		*(mcGet_Vector(temp)+elt) = NIL;
+      }
 	break;
 
       case BCODES:
       {
 	int cst;
 
-	if ( (mcBC_Code(temp) = (unsigned char *)malloc( size )) == NULL ) {
+	/* an old_cons() of the cell frees what got allocated */
+	mcBC_Const(temp) = NULL;
+	mcBC_CSize(temp) = mcBC_CCSize(temp) = 0;
+	if ( (mcBC_Code(temp) = (unsigned char *)pay_alloc( (long)size )) == NULL ) {
 		RT_ERROR("Out of memory; can't allocate byte-code.");
 	}
-	if ( (mcBC_Const(temp)= (CONS *)malloc( csize * sizeof(CONS) )) == NULL ) {
+	mcBC_CSize(temp) = size;
+	if ( (mcBC_Const(temp)= (CONS *)pay_alloc( vect_bytes(csize) )) == NULL ) {
 		RT_ERROR("Out of memory; can't allocate constant table.");
 	}
 
-	/* set the code and constant table sizes */
-	mcBC_CSize(temp) = size;
+	/* set the constant table size */
 	mcBC_CCSize(temp) = csize;
 
 	for ( cst = 0; cst < csize; ++cst )
@@ -201,6 +1071,7 @@ int type, size, csize;
 	mcCl_Env(temp) = NIL;
 	mcCl_Parms(temp) = NIL;
 	mcCl_Body(temp) = NIL;
+	mcCl_Code(temp) = NIL;
 	break;
 
       case CONT:
@@ -225,319 +1096,2085 @@ int type, size, csize;
 	mcExe_Env(temp) = NIL;
 	break;
 
+      case PORT:
+	mcCpy_Port(temp, NULL);
+	mcPort_Pos(temp) = 0;
+	mcPort_Str(temp) = NULL;
+	break;
+
+      case STRING:
+	/* the caller hands it its characters -- see NewStr() */
+	mcGet_Str(temp) = NULL;
+	mcStr_Len(temp) = mcRope_Depth(temp) = 0;
+	mcStr_Owner(temp) = mcRope_Right(temp) = NULL;
+	break;
+
       default:
 	break;
    }
 
+   /* ... and so are their payloads */
+   if ( gc_marking && (type == VECTOR || type == BCODES) )
+	mark_payload( temp, (MARKER *)NULL );
+
    return temp;
 }
 
-/* ----------------------------------------------------------------------- */
-/*                 Low level Memory Management Routines			   */
-/* ----------------------------------------------------------------------- */
-
-/* add_segment() - Adds a segment of new cons nodes.  The cons nodes are
-	placed on the free_list.  Returns TRUE if successful, FALSE if
-	failed.
+/* NewStr(len) - Returns room for a string of len characters in the
+	string heap, EOS terminated.  It's a payload: give it to a STRING
+	cell (mcSet_Str()) before the next allocation, and it's freed
+	when the cell dies.
 */
-static BOOL add_segment()
+char *NewStr(len)
+int len;
 {
-   SEGMENT *new;
-   CONS temp;		/* garbage collection not possible right now */
-   int i;
-
-   /* allocate segment then allocate cons nodes */
-   if ( (new = (SEGMENT *) malloc( sizeof(SEGMENT) )) != NULL &&
-	((new->first) = (CONS) malloc( sizeof(CONSNODE) * ALLOC_CONS )) != NULL) {
-
-	/* we got our SEGMENT, add it to store */
-	new -> next = store;
-	store = new;
-
-	/* carve up cons nodes and put them on the free-list */
-	for (temp = (new->first), i = 1; i <= ALLOC_CONS ; i++, temp++) {
-		/* set the kind of this node to free because old_cons()
-		 * checks to see if the cons node is code.  at this point,
-		 * the cons node has no type -- just left over junk in
-		 * memory.
-		 */
-		mcKind(temp) = FREE;
-		old_cons(temp);
+   long *b, n;
+   char *s;
+
+   b = NULL;
+   n = str_bytes(len);
+   if ( len < 0 )
+	;
+   else if ( is_large(n) ) {
+	/* not a large object -- the cell frees it (see notes) */
+	if ( (b = (long *)malloc( (size_t)n )) != NULL ) {
+		pay_add( n );
+		pay_young += n;
 	}
+   }
+   else b = (long *)pay_alloc( n );
 
-	return TRUE;
+   if ( b == NULL ) {
+	RT_ERROR("Out of memory; can't allocate string.");
+	return NULL;
+   }
 
-   } /* else return FALSE; */
+   /* the cell it's for was allocated black */
+   if ( gc_marking )
+	mark_bytes += n;
 
-   return FALSE;
+   *b = len;
+   s = (char *)(b + 1);
+   s[len] = EOS;
+   return s;
 }
 
-/* old_cons(c) - Takes a cons node c and puts it on the free list. */
-static void old_cons(c)
-CONS c;
+/* Remember(o) - The write barrier found the OLD cell o pointing at a
+	YOUNG cell.  Put o on the remembered set so the next minor GC
+	traces its fields.
+*/
+void Remember(o)
+CONS o;
 {
-   switch ( mcKind(c) ) {
-      case VECTOR:
-	free( mcGet_Vector(c) );
-	break;
-
-      case BCODES:
-	free( mcBC_Code(c) );
-	free( mcBC_Const(c) );
-	break;
+   if ( GenOf(o) != OLD )
+	return;
 
-      default:
-	break;
+   if ( rem_cnt >= rem_max ) {
+	rem_max *= 2;
+	if ( (remset = (CONS *)realloc( remset, rem_max * sizeof(CONS) )) == NULL ) {
+		FATAL("MM ERROR in Remember: Can't grow remembered set.");
+	}
    }
 
-   /* clear all information in the CONS node to help farret out dangling
-    * pointer problems.
-    */
-   memset( c, 0, sizeof(CONSNODE) );
-
-   /* node nolonger in use */
-   mcKind(c) = FREE;
-
-   /* add node c to the front of the free list */
-   next_free(c) = free_cons;
-   free_cons = c;
+   set_gen(o, REMEMBERED);
+   remset[rem_cnt++] = o;
 }
 
-/* mrkatom(a) - Marks this atom. */
-static void mrkatom(a)
-CONS a;
+/* Shade(p) - Make the white cell p gray: push it on the gray stack.
+	The snapshot barrier calls this for a cell about to be
+	overwritten while marking.  If the gray stack is full, p is marked
+	instead and picked up by rescan().  Immediates aren't cells and
+	are ignored.
+*/
+void Shade(p)
+CONS p;
 {
-   assert( a != NULL );
+   CONS *new;
 
-   if ( mark(a) == TRUE )
+   if ( p == NULL || mcImm(p) || marked(p) )
 	return;
 
-   mark(a) = TRUE;
+   if ( gray_cnt >= gray_max ) {
+	if ( gray_max >= MAX_GRAY ||
+	     (new = (CONS *)realloc( gray, (size_t)(2*gray_max) * sizeof(CONS) )) == NULL ) {
+		/* overflow: mark it now, scan its fields later */
+		set_mark(p);
+		if ( !minor && has_payload(p) )
+			mark_payload(p, (MARKER *)NULL);
+		overflow = TRUE;
+		return;
+	}
 
-   /* '() is an atom */
-   if ( mcNull(a) )
-	return;
+	gray = new;
+	gray_max *= 2;
+   }
 
-   /* this switch statement isn't really needed -- it's for my own
-    * protection.  there are a lot of "atom" nodes.  if i forget to
-    * handle one, this marker will terminate.  without the switch, if
-    * i forget to handle one, the atom isn't marked and disappears right
-    * out from underneath me.
-    */
-   switch ( mcKind(a) ) {
-	case SYMBOL:
-	case INT:
-	case FLOAT:
-	case STRING:
-	case CHAR:
-	case PORT:
-	case CFUNC:
-	case CFORM:
-	case RESUME:
-	case TOBJ:
-	case FOBJ:
-	case EOFOBJ:
-		/* nothing to do for these data-types */
-		break;
+   gray[gray_cnt++] = p;
+}
 
-	case FORM:
-		/* have to mark the form's information */
-		mrklist( mcForm_Parms(a) );
-		mrklist( mcForm_Body(a) );
-		break;
+/* FullGc() - Collect the entire store now. */
+void FullGc()
+{
+   if ( store == NULL )
+	return;
 
-	case CLOSURE:
-		/* have to mark the closure's information */
-		mrklist( mcCl_Parms(a) );
-		mrklist( mcCl_Body(a) );
-		mrklist( mcCl_Env(a) );
-		break;
+   begin_pause();
+   major_gc();
+   end_pause();
+}
 
-	case CONT:
-		/* have to mark the continuation's info */
-		mrklist( mcCont_Env(a) );
-		mrklist( mcCont_Val(a) );
-		mrklist( mcCont_Fnc(a) );
-		mrklist( mcCont_Exp(a) );
-		break;
+/* GcStats() - Print the GC pause distribution. */
+void GcStats()
+{
+   int b, c;
+   CLASS *cl;
+
+   printf("GC: %ld minor, %ld major, %ld pauses, gc_budget %ld\n",
+	minor_cnt, major_cnt, pause_tot, gc_budget);
+   for ( c = 0; c < NUM_CLS; ++c ) {
+	cl = &classes[c];
+	printf("    %s: %ld segments of %d %d-byte cells, %ld allocated\n",
+		cl->name, cl->total / cl->ncells, cl->ncells, cl->size,
+		cl->made + cl->nursery);
+   }
+   printf("    heap %ldK (-H %ldK, min %ldK, max %ldK), %ld segments given back\n",
+	heap_segs * SEG_BYTES / 1024, heap_goal / 1024, heap_min / 1024,
+	heap_max / 1024, given_back);
+   printf("    %ld segments swept lazily (%.0fus allocating), %ld by the sweeper\n",
+	lazy_cnt, lazy_us,
+#ifdef GC_THREADS
+	__atomic_load_n( &bg_cnt, __ATOMIC_RELAXED )
+#else
+	bg_cnt
+#endif
+	);
+
+   printf("    payloads: %ld bytes live, %ld freed by the last minor, %ld by the last major\n",
+	pay_bytes(), pay_minor, pay_major);
+   printf("    %ld large objects, pools of", los_cnt);
+   for ( c = 0; c < POOL_CNT; ++c )
+	printf(" %d:%ldK", pools[c].size, pools[c].chunks * POOL_CHUNK / 1024);
+   printf("\n");
+
+   printf("    last GC scanned %ld words of C stack, %ld cells found\n",
+	stack_words, stack_cells);
+   printf("    %d symbols (%d #'s used)\n", ssSymCount(), SymCount);
+
+   if ( last_cells > 0 ) {
+	printf("    last major marked %ld cells in %.0fus", last_cells, last_us);
+	if ( last_threads > 1 )
+		printf(" with %d threads", last_threads);
+	if ( last_us > 0.0 )
+		printf(", %.0f cells/second", last_cells * 1000000.0 / last_us);
+	printf("\n");
+   }
 
-	case BCODES:
-	   {
-		/* byte-code: have to mark the constant table */
-		int l;
+   if ( pause_tot == 0 )
+	return;
 
-		for ( l = 0; l < mcBC_CCSize(a); ++l )
-			mrklist( *(mcBC_Const(a)+l) );
+   printf("    mean %.1fus, max %.1fus\n", pause_sum / pause_tot, pause_max);
+   for ( b = 0; b < PAUSE_BUCKETS; ++b ) {
+	if ( b < PAUSE_BUCKETS-1 )
+		printf("    < %6ldus: %ld\n", pause_lim[b], pause_cnt[b]);
+	else printf("    >=%6ldus: %ld\n", pause_lim[b-1], pause_cnt[b]);
+   }
+}
 
-	   }
-		break;
+/* ----------------------------------------------------------------------- */
+/*                 Low level Memory Management Routines			   */
+/* ----------------------------------------------------------------------- */
 
-	case VECTOR:
-	   {
-		int l;
+/* MemSize(s) - Returns the size given by the command line argument s:
+	a # of bytes, or of K, M or G bytes with a suffix.
+*/
+long MemSize(s)
+char *s;
+{
+   char *end;
+   long n;
+
+   n = strtol( s, &end, 10 );
+   switch ( *end ) {
+      case 'g':
+      case 'G':
+	n *= 1024L;
+	/* fall thru */
+      case 'm':
+      case 'M':
+	n *= 1024L;
+	/* fall thru */
+      case 'k':
+      case 'K':
+	n *= 1024L;
+	break;
+   }
 
-		for ( l = 0; l < mcVect_Size(a); l++ )
-			/* vectors can have NULL's since we use vectors
-			 * to implement environments.
-			 */
-			if ( *mcVect_Ref(a, l) )
-				mrklist( *mcVect_Ref(a, l) );
-	   }
+   return n;
+}
 
-		break;
+/* init_class(cl, name, size, tag) - Sets up a size class for cells of
+	size bytes.  Its segments come later.
+*/
+static void init_class(cl, name, size, tag)
+CLASS *cl;
+char *name;
+int size, tag;
+{
+   cl->name = name;
+   cl->tag = tag;
 
-	case ENVMNT:
-		/* mark the nested bindings and the global bindings */
-		mrklist( mcGet_Nested(a) );
-		mrkatom( mcGet_Global(a) );
-		break;
+   /* the classes but BIG_CLS are a power of 2 so a cell's # is a
+    * shift.  everything is 8 byte aligned so a pair's tag can't be
+    * mistaken.
+    */
+   if ( size != (int)BIG_BYTES ) {
+	for ( cl->size = 8, cl->shift = 3; cl->size < size; cl->size *= 2 )
+		++cl->shift;
+   }
+   else {
+	cl->size = size;
+	cl->shift = 0;
+   }
 
-	case EXEPOINT:
-		/* execution point: have to mark the byte-code. */
-		mrkatom( mcExe_BC(a) );
+   cl->ncells = (int)((SEG_BYTES - HDR_BYTES) / cl->size);
+   cl->segs = NULL;
+   cl->total = cl->free = cl->live = 0;
+   cl->nursery = cl->allocs = cl->made = 0;
+}
 
-		/* have to mark the environment */
-		mrklist( mcExe_Env(a) );
-		break;
+/* get_segment() - Returns a segment for the heap, aligned on SEG_BYTES.
+	One that was given back is reused first.  Returns NULL if the
+	heap is at --heap-max or there's no more memory.
+*/
+static SEGMENT *get_segment()
+{
+   char *seg;
+#ifndef MMAP_ARENA
+   char *chunk;
+   long c;
+#endif
 
-	default:
-		/* woops, forgot to handle an atom data-type.  terminate. */
-		printf("\nForgot %d.\n", mcKind(a));
-		assert(0);
+   if ( (heap_segs + 1) * SEG_BYTES > heap_max )
+	return NULL;
+
+   if ( free_seg_cnt > 0 )
+	seg = free_segs[--free_seg_cnt];
+   else {
+#ifndef MMAP_ARENA
+	/* segments have to be aligned on SEG_BYTES, so get a chunk of
+	 * them with room to spare and carve them out of it.
+	 */
+	if ( chunk_left == 0 ) {
+		if ( (chunk = (char *) malloc( (size_t)((CHUNK_SEGS+1) * SEG_BYTES) )) == NULL )
+			return NULL;
+
+		chunk_next = (char *)( ((PTR_INT)chunk + SEG_BYTES-1) & ~(PTR_INT)(SEG_BYTES-1) );
+		chunk_left = CHUNK_SEGS;
+
+		/* keep the chunk table in order for heap_seg() */
+		for ( c = chunk_cnt++; c > 0 && chunk_tab[c-1] > chunk_next; --c )
+			chunk_tab[c] = chunk_tab[c-1];
+		chunk_tab[c] = chunk_next;
+	}
+#endif
+	if ( chunk_left == 0 )
+		return NULL;
+
+	seg = chunk_next;
+	chunk_next += SEG_BYTES;
+	--chunk_left;
    }
+
+   ++heap_segs;
+   return (SEGMENT *)seg;
 }
 
-/* mrklist( l ) - Marks all of the nodes in the list l. */
-static void mrklist(l)
-CONS l;
+/* put_segment(seg) - Gives back a segment that's out of the heap. */
+static void put_segment(seg)
+SEGMENT *seg;
 {
-   assert( l != NULL );
-   assert( mcKind(l) != FREE );			/* should NEVER happen! */
+   seg->first = NULL;		/* no cells; see heap_seg() */
+#ifdef MMAP_ARENA
+   (void)madvise( (char *)seg, (size_t)SEG_BYTES, MADV_DONTNEED );
+#endif
 
-   /* already done this list? */
-   if ( mark(l) == TRUE )
-	return;
+   free_segs[free_seg_cnt++] = (char *)seg;
+   --heap_segs;
+   ++given_back;
+}
 
-   /* l is an atom */
-   if ( !mcPair(l) ) {
-	mrkatom(l);
-	return;
+/* heap_seg(w) - Returns the segment in the heap w points into, or NULL
+	if it doesn't point into the heap.  A segment given back has a
+	NULL first cell; with MMAP_ARENA its header reads as 0's.
+*/
+static SEGMENT *heap_seg(w)
+PTR_INT w;
+{
+   SEGMENT *seg;
+#ifndef MMAP_ARENA
+   long lo, hi, mid;
+#endif
+
+#ifdef MMAP_ARENA
+   if ( w < (PTR_INT)arena || w >= (PTR_INT)chunk_next )
+	return NULL;
+#else
+   /* the last chunk that starts at or below w */
+   lo = 0;
+   hi = chunk_cnt;
+   while ( lo < hi ) {
+	mid = (lo + hi) / 2;
+	if ( (PTR_INT)chunk_tab[mid] <= w )
+		lo = mid + 1;
+	else hi = mid;
    }
+   if ( lo == 0 || w >= (PTR_INT)chunk_tab[lo-1] + CHUNK_SEGS * SEG_BYTES )
+	return NULL;
+
+   /* the rest of the current chunk hasn't been handed out yet */
+   if ( w >= (PTR_INT)chunk_next && w < (PTR_INT)chunk_next + chunk_left * SEG_BYTES )
+	return NULL;
+#endif
 
-   /* mark the list */
-   while ( !mcNull(l) ) {
+   seg = seg_of(w);
+   return seg->first == NULL ? NULL : seg;
+}
 
-	mark(l) = TRUE;
+/* add_segment(cl) - Adds a segment of new cons nodes to class cl.  The
+	segment is put at the front of the class so the allocator bumps
+	thru it next.  Returns TRUE if successful, FALSE if failed.
+*/
+static BOOL add_segment(cl)
+CLASS *cl;
+{
+   SEGMENT *new;
+   int i;
 
-	/* recur on CAR */
-	mrklist( mcCar(l) );
+   if ( (new = get_segment()) == NULL )
+	return FALSE;
+
+   /* we got our SEGMENT, add it to store and the class */
+   new -> next = store;
+   new -> cnext = cl->segs;
+   new -> ynext = NULL;
+   new -> first = (char *)new + HDR_BYTES;
+   new -> cls = (int)(cl - classes);
+   new -> size = cl->size;
+   new -> shift = cl->shift;
+   new -> tag = cl->tag;
+   new -> ncells = cl->ncells;
+   new -> young = FALSE;
+   new -> swept = TRUE;
+   new -> nfree = cl->ncells;
+   memset( new->marks, 0, sizeof(new->marks) );
+   memset( new->gen, UNUSED, sizeof(new->gen) );
+   store = new;
+   cl->segs = new;
+   cl->total += cl->ncells;
+   cl->free += cl->ncells;
+   total_cnt += cl->ncells;
+   free_cnt += cl->ncells;
+
+   /* at this point, the cons nodes have no type -- just left over
+    * junk in memory.  make them all FREE.  pairs have no type.
+    */
+   memset( new->first, 0, (size_t)cl->size * cl->ncells );
+   if ( new->cls != PAIR_CLS )
+	for (i = 0; i < cl->ncells ; i++)
+		mcSetKind(cell_at(new, i), FREE);
+
+   cl->alloc_seg = NULL;
+   cl->scan_seg = cl->segs;
+   return TRUE;
+}
 
-	/* iterate on CDR */
-	l = mcCdr(l);
+/* reset_alloc() - Start the allocators over at the front of their
+	classes.
+*/
+static void reset_alloc()
+{
+   int c;
 
-	/* handle DP's */
-	if ( !mcPair(l) ) {
-		mrkatom(l);
-		return;
-	}
+   for ( c = 0; c < NUM_CLS; ++c ) {
+	classes[c].alloc_seg = NULL;
+	classes[c].scan_seg = classes[c].segs;
    }
 }
 
-/* mark_all() - Marks all of the nodes in use.
-	NOTE:  NULL is used in environments to denote symbols which haven't
-	been bound.  These need to be caught before mrklist() since NULL
-	is totally illegal in any list.
+/* next_cell(cl) - Bump the allocation pointer of class cl to its next
+	FREE cell and return it.  Returns NULL if there are no FREE cells
+	left in the class.
 */
-static void mark_all()
+static CONS next_cell(cl)
+CLASS *cl;
 {
-   CONS *i;
+   SEGMENT *seg;
+   int i;
+   double start;
+
+   while ( TRUE ) {
+	/* bump thru the current segment, stepping over cells in use */
+	if ( (seg = cl->alloc_seg) != NULL ) {
+		for ( i = cl->alloc_next; i < seg->ncells; ++i ) {
+			if ( seg->gen[i] == UNUSED ) {
+				seg->gen[i] = YOUNG;
+				cl->alloc_next = i + 1;
+				--seg->nfree;
+				--cl->free;
+				--free_cnt;
+				++cl->nursery;
+				++nursery_cnt;
+				return cell_at(seg, i);
+			}
+		}
+	}
 
-   /* mark the register stack */
-   for (i = Top_RegS; i > RegStack ; i--) {
+	/* on to the next segment with FREE cells in it.  sweep it first
+	 * if the last major GC left it unswept and the sweeper hasn't got
+	 * to it, or wait for the sweeper if it's at it.
+	 */
+	while ( (seg = cl->scan_seg) != NULL ) {
+		if ( !is_swept(seg) ) {
+			if ( claim(seg) ) {
+				start = now_us();
+				(void)sweep_seg( seg, TRUE );
+				lazy_us += now_us() - start;
+				++lazy_cnt;
+			}
+#ifdef GC_THREADS
+			else while ( !is_swept(seg) )
+				sched_yield();
+#endif
+		}
 
-	/* if pointer isn't NULL then mark the list, see note above */
-	if ( *i != NULL )
-		mrklist( *i );
-   }
+		if ( seg->nfree > 0 )
+			break;
 
-   /* mark the expression stack */
-   for (i = Top_Expr; i > ExprStack ; i--)
-	mrklist( *i );
+		cl->scan_seg = seg->cnext;
+	}
 
-   /* mark the value stack */
-   for (i = Top_Val; i > ValStack ; i--)
-	mrklist( *i );
+	if ( seg == NULL )
+		return NULL;
 
-   /* mark the function stack */
-   for (i = Top_Func; i > FuncStack ; i--)
-	mrklist( *i );
+	cl->alloc_seg = seg;
+	cl->scan_seg = seg->cnext;
+	cl->alloc_next = 0;
 
-   /* mark the environment; see notes in eval.c about the environment */
-   if ( glo_env )
-	mrkatom( glo_env );
+	/* the cells we're about to hand out are YOUNG */
+	if ( !seg->young ) {
+		seg->young = TRUE;
+		seg->ynext = young_segs;
+		young_segs = seg;
+	}
+   }
 }
 
-/* GC() - Garbage Collection.  Gathers all unneeded nodes and puts them on
-	the free-list.  returns TRUE if successful, returns FALSE if failed.
+/* short_of(n) - Returns TRUE if some class has fewer FREE cells than it
+	needs for n more nurseries.
 */
-static BOOL GC()
+static BOOL short_of(n)
+int n;
 {
-   SEGMENT *cseg;	/* current segment */
-   CONS ccons;		/* current cons node */
-   int i;		/* # of cons nodes */
-   int used, rec;	/* for stats: used nodes, recovered nodes */
+   int c;
 
-   if ( !torture )
-	assert( free_cons == NULL );		/* should we be here? */
+   for ( c = 0; c < NUM_CLS; ++c )
+	if ( classes[c].free < room(&classes[c], n) )
+		return TRUE;
 
-   /* we've gotta have mem inorder to GC */
-   if ( store == NULL ) return FALSE;
+   return FALSE;
+}
 
-   GC_DEBUG("\nGC: marking, ");
+/* grow(n, major, limit) - Adds segments to every class with fewer FREE
+	cells than it needs for n more nurseries.  After a major GC, there
+	has to be room for the live cells to be LIVE_PCT of the class as
+	well.  A class that grows grows to GROW_PCT of its size at least,
+	but the heap doesn't grow past limit bytes.
+*/
+static void grow(n, major, limit)
+int n;
+BOOL major;
+long limit;
+{
+   CLASS *cl;
+   long want;		/* cells the class should have */
 
-   /* mark all nodes in use */
-   mark_all();
+   for ( cl = classes; cl < classes + NUM_CLS; ++cl ) {
+	want = cl->total - cl->free + room(cl, n) + (major ? need(cl) : 0);
+	if ( want <= cl->total )
+		continue;
 
-   GC_DEBUG("collecting, ");
+	if ( want < cl->total * GROW_PCT / 100 )
+		want = cl->total * GROW_PCT / 100;
 
-   used = rec = 0;
-   /* step thru mem, collecting cons nodes not marked */
-   /* reset mark on used nodes for next GC */
-   for ( cseg = store ; cseg != NULL ; cseg = cseg->next) {
-	for ( i = 1, ccons = cseg->first ; i <= ALLOC_CONS ; ++i, ++ccons ) {
-
-	   /* skip nodes already on the free-list */
-	   if ( mcKind(ccons) != FREE ) {
-		if ( mark(ccons) == FALSE ) {	/* not being used? */
-			++rec;
-			old_cons(ccons);
-		} else {
-			++used;
-			mark(ccons) = FALSE;	/* setup for next GC */
-		}
-	   }
+	while ( cl->total < want && (heap_segs + 1) * SEG_BYTES <= limit ) {
+		GC_DEBUG( "\nGC failed.  adding segment!\n" );
+		if ( add_segment(cl) != TRUE )
+			return;
 	}
    }
+}
 
-   if ( gc_debug )
-	printf("Used: %d  Recovered: %d Free-list: %d\n", used, rec, cnt_free());
+/* seg_empty(seg) - Returns TRUE if nothing in seg survived the last
+	major GC.
+*/
+static BOOL seg_empty(seg)
+SEGMENT *seg;
+{
+   return seg->swept ? seg->nfree == seg->ncells : count_marks(seg) == 0;
+}
+
+/* shrink() - After a major GC, gives back the empty segments of every
+	class that has more than GROW_PCT of what grow() would give it, so
+	it isn't shrunk just to grow again.  The heap isn't shrunk below
+	--heap-min.
+*/
+static void shrink()
+{
+   CLASS *cl;
+   SEGMENT **p, *seg;
+   long keep;		/* cells the class keeps */
+   BOOL gave;
+
+   gave = FALSE;
+   for ( cl = classes; cl < classes + NUM_CLS; ++cl ) {
+	keep = (cl->live + room(cl, 3) + need(cl)) * GROW_PCT / 100;
+
+	for ( p = &cl->segs; (seg = *p) != NULL; ) {
+		if ( cl->total - cl->ncells < keep || (heap_segs - 1) * SEG_BYTES < heap_min )
+			break;
+
+		if ( !seg_empty(seg) ) {
+			p = &seg->cnext;
+			continue;
+		}
+
+		/* vectors and byte-code have memory to free */
+		if ( !seg->swept && seg->cls == BIG_CLS )
+			(void)sweep_seg( seg, TRUE );
+
+		*p = seg->cnext;
+		cl->total -= cl->ncells;
+		cl->free -= cl->ncells;
+		total_cnt -= cl->ncells;
+		free_cnt -= cl->ncells;
+		put_segment( seg );
+		gave = TRUE;
+	}
+   }
+
+   /* the store is every class's segments */
+   if ( gave ) {
+	store = NULL;
+	for ( cl = classes; cl < classes + NUM_CLS; ++cl ) {
+		for ( seg = cl->segs; seg != NULL; seg = seg->cnext ) {
+			seg->next = store;
+			store = seg;
+		}
+	}
+   }
+}
+
+/* old_cons(seg, i, defer) - Takes the i'th cons node in seg and makes it
+	FREE.  The caller is responsible for the free counts.  If defer,
+	the mutator is the caller and the sweeper can free the cell's
+	large payloads.
+*/
+static void old_cons(seg, i, defer)
+SEGMENT *seg;
+int i;
+BOOL defer;
+{
+   CONS c;
+
+   /* clear all information in the CONS node to help farret out dangling
+    * pointer problems.
+    */
+   c = cell_at(seg, i);
+   switch ( seg->cls ) {
+      case PAIR_CLS:
+	mcGet_Car(c) = mcGet_Cdr(c) = NULL;
+	break;
+
+      case ATOM_CLS:
+	memset( c, 0, sizeof(struct Atom) );
+	mcSetKind(c, FREE);
+	break;
+
+      default:
+	switch ( mcKind(c) ) {
+	   case VECTOR:
+		if ( seg->cls != VECT_CLS )
+			pay_release( mcGet_Vector(c), vect_bytes(mcVect_Size(c)), defer );
+		break;
 
-   return (free_cons != NULL);
+	   case BCODES:
+		pay_release( mcBC_Code(c), (long)mcBC_CSize(c), defer );
+		pay_release( mcBC_Const(c), vect_bytes(mcBC_CCSize(c)), defer );
+		break;
+
+	   case STRING:
+		/* a slice's characters are its owner's; a rope has none */
+		if ( mcStr_Owner(c) == NULL )
+			str_release( mcGet_Str(c), defer );
+		break;
+
+	   default:
+		break;
+	}
+
+	memset( c, 0, (size_t)seg->size );
+	mcSetKind(c, FREE);
+	break;
+   }
+
+   /* node nolonger in use */
+   seg->gen[i] = UNUSED;
 }
 
 /* ----------------------------------------------------------------------- */
-/*                         DEBUGGING ROUTINES                              */
+/*                           Payload Space				   */
 /* ----------------------------------------------------------------------- */
 
-/* count the number of nodes on the cons free list */
-static int cnt_free()
+/* pool_of(n) - Returns the pool for a small payload of n bytes. */
+static int pool_of(n)
+long n;
+{
+   int c;
+
+   for ( c = 0; (long)(POOL_MIN << c) < n; ++c )
+	;
+
+   return c;
+}
+
+/* pay_alloc(n) - Returns a payload of n bytes, or NULL if there's no
+	memory for it.  A small one is a block off its pool's free list;
+	when that runs out, the pool takes what the sweeper gave back, or
+	carves up another chunk.  A big one is a new large object.
+*/
+static void *pay_alloc(n)
+long n;
+{
+   POOL *pl;
+   LARGE *lg;
+   void *p;
+   char *chunk;
+   long b;
+
+   if ( n < 0 )
+	return NULL;
+
+   if ( is_large(n) ) {
+	if ( (lg = (LARGE *)malloc( sizeof(LARGE) + (size_t)n )) == NULL )
+		return NULL;
+
+	lg->bytes = n;
+	lg->mark = gc_marking;
+	lg->next = los.next;
+	lg->prev = &los;
+	los.next->prev = lg;
+	los.next = lg;
+	++los_cnt;
+	pay_add( n );
+	pay_young += n;
+	return (void *)(lg + 1);
+   }
+
+   pl = &pools[pool_of(n)];
+   if ( pl->free == NULL ) {
+#ifdef GC_THREADS
+	if ( __atomic_load_n( &pl->back, __ATOMIC_RELAXED ) != NULL ) {
+		pthread_mutex_lock( &sweep_lock );
+		pl->free = pl->back;
+		__atomic_store_n( &pl->back, NULL, __ATOMIC_RELAXED );
+		pthread_mutex_unlock( &sweep_lock );
+	}
+	else
+#endif
+	{
+		if ( (chunk = (char *)malloc( (size_t)POOL_CHUNK )) == NULL )
+			return NULL;
+
+		for ( b = POOL_CHUNK - pl->size; b >= 0; b -= pl->size ) {
+			*(void **)(chunk + b) = pl->free;
+			pl->free = (void *)(chunk + b);
+		}
+		++pl->chunks;
+	}
+   }
+
+   p = pl->free;
+   pl->free = *(void **)p;
+   pay_add( n );
+   pay_young += n;
+   return p;
+}
+
+/* pay_release(p, n, defer) - The payload p of n bytes is dead.  A block
+	goes back on its pool: the allocator's free list if the mutator is
+	the caller (defer), or the sweeper's blocks for this segment.  A
+	large object is let go by a minor GC only; the large object list
+	sweep let go of any a major GC left.
+*/
+static void pay_release(p, n, defer)
+void *p;
+long n;
+BOOL defer;
+{
+   POOL *pl;
+   LARGE *lg;
+   int c;
+
+   if ( p == NULL )
+	return;
+
+   if ( is_large(n) ) {
+	if ( !defer || !minor )
+		return;
+
+	lg = large_of(p);
+	lg->prev->next = lg->next;
+	lg->next->prev = lg->prev;
+	--los_cnt;
+	pay_add( -n );
+	pay_minor += n;
+	drop( (void *)lg, TRUE );
+	return;
+   }
+
+   c = pool_of(n);
+   pl = &pools[c];
+   pay_add( -n );
+
+#ifdef GC_THREADS
+   if ( !defer ) {
+	/* the sweeper: keep them for bg_give_back() */
+	if ( bg_blocks[c] == NULL )
+		bg_last[c] = p;
+	*(void **)p = bg_blocks[c];
+	bg_blocks[c] = p;
+	return;
+   }
+#endif
+
+   if ( minor )
+	pay_minor += n;
+   *(void **)p = pl->free;
+   pl->free = p;
+}
+
+/* str_release(s, defer) - The characters s of a STRING cell are dead.  A
+	small block goes back on its pool like any payload; a big one is
+	dropped here, whatever the GC, since it isn't a large object.
+*/
+static void str_release(s, defer)
+char *s;
+BOOL defer;
+{
+   long n;
+
+   if ( s == NULL )
+	return;
+
+   n = str_bytes(*str_block(s));
+   if ( !is_large(n) ) {
+	pay_release( (void *)str_block(s), n, defer );
+	return;
+   }
+
+   pay_add( -n );
+   if ( defer && minor )
+	pay_minor += n;
+   drop( (void *)str_block(s), defer );
+}
+
+/* mark_payload(a, m) - The VECTOR, BCODES or STRING cell a is marked by
+	marker m (NULL for the mutator) in a major GC.  Mark its large
+	payloads and count its payload bytes.
+*/
+static void mark_payload(a, m)
+CONS a;
+MARKER *m;
+{
+   long n;
+
+   if ( mcKind(a) == VECTOR ) {
+	n = mcVect_Size(a) > VECT_INLINE ? vect_bytes(mcVect_Size(a)) : 0L;
+	if ( is_large(n) && mcGet_Vector(a) != NULL )
+		large_of(mcGet_Vector(a))->mark = TRUE;
+   }
+   else if ( mcKind(a) == STRING )
+	n = mcGet_Str(a) != NULL && mcStr_Owner(a) == NULL ?
+		str_bytes(*str_block(mcGet_Str(a))) : 0L;
+   else {
+	n = (long)mcBC_CSize(a);
+	if ( is_large(n) && mcBC_Code(a) != NULL )
+		large_of(mcBC_Code(a))->mark = TRUE;
+	if ( is_large(vect_bytes(mcBC_CCSize(a))) && mcBC_Const(a) != NULL )
+		large_of(mcBC_Const(a))->mark = TRUE;
+	n += vect_bytes(mcBC_CCSize(a));
+   }
+
+   if ( m != NULL )
+	m->bytes += n;
+   else mark_bytes += n;
+}
+
+/* sweep_large() - A major GC is done marking.  Let go of the unmarked
+	large objects and unmark the rest.  Returns the bytes let go.
+*/
+static long sweep_large()
+{
+   LARGE *lg, *next;
+   long n;
+
+   n = 0;
+   for ( lg = los.next; lg != &los; lg = next ) {
+	next = lg->next;
+	if ( lg->mark ) {
+		lg->mark = FALSE;
+		continue;
+	}
+
+	lg->prev->next = next;
+	next->prev = lg->prev;
+	--los_cnt;
+	n += lg->bytes;
+	pay_add( -lg->bytes );
+	drop( (void *)lg, TRUE );
+   }
+
+   return n;
+}
+
+/* drop(p, defer) - Frees p, a cell's vector, byte-code or string.  If defer and
+	there's a sweeper, it's queued for the sweeper to free.
+*/
+static void drop(p, defer)
+void *p;
+BOOL defer;
+{
+#ifdef GC_THREADS
+   void **new;
+
+   if ( defer && bg_sweep ) {
+	pthread_mutex_lock( &sweep_lock );
+	if ( dead_q.cnt >= dead_q.max ) {
+		if ( (new = (void **)realloc( dead_q.p, (size_t)(2*dead_q.max) * sizeof(void *) )) == NULL ) {
+			/* no room in the queue: free it here */
+			pthread_mutex_unlock( &sweep_lock );
+			free( p );
+			return;
+		}
+		dead_q.p = new;
+		dead_q.max *= 2;
+	}
+	dead_q.p[dead_q.cnt++] = p;
+	pthread_mutex_unlock( &sweep_lock );
+	return;
+   }
+#endif
+
+   free( p );
+}
+
+/* claim(seg) - Returns TRUE if seg is unswept and the caller is the one
+	to sweep it.
+*/
+static BOOL claim(seg)
+SEGMENT *seg;
+{
+#ifdef GC_THREADS
+   int unswept;
+
+   unswept = FALSE;
+   return __atomic_compare_exchange_n( &seg->swept, &unswept, SWEEPING, FALSE,
+				       __ATOMIC_ACQUIRE, __ATOMIC_RELAXED );
+#else
+   if ( seg->swept )
+	return FALSE;
+
+   seg->swept = SWEEPING;
+   return TRUE;
+#endif
+}
+
+/* sweep_seg(seg, defer) - Makes the unmarked cells in seg FREE and clears
+	its marks.  Survivors are OLD.  Returns the # of cells recovered.
+	defer is passed on to old_cons().
+*/
+static long sweep_seg(seg, defer)
+SEGMENT *seg;
+BOOL defer;
 {
    int i;
-   CONS temp;
+   long rec;
+
+   rec = 0;
+   for ( i = 0 ; i < seg->ncells ; ++i ) {
+
+	/* skip nodes already FREE */
+	if ( gen_at(seg, i) == UNUSED )
+		continue;
+
+	if ( seg_marked(seg, i) ) {
+		if ( gen_at(seg, i) == YOUNG )
+			seg->gen[i] = OLD;
+	} else {
+		++rec;
+		old_cons(seg, i, defer);
+	}
+   }
+
+   /* setup for next GC */
+   memset( seg->marks, 0, sizeof(seg->marks) );
+
+   seg->nfree += rec;
+   set_swept( seg );
+   return rec;
+}
+
+/* sweep_all() - Sweeps every segment the last major GC left unswept.  The
+	sweeper may still be at it; wait for it.
+*/
+static void sweep_all()
+{
+   SEGMENT *cseg;	/* current segment */
+
+   for ( cseg = store ; cseg != NULL ; cseg = cseg->next )
+	if ( claim(cseg) )
+		(void)sweep_seg( cseg, TRUE );
+
+#ifdef GC_THREADS
+   if ( bg_sweep )
+	sweep_wait();
+#endif
+
+   lazy_seg = NULL;
+   sweep_pending = FALSE;
+}
+
+/* sweep_slice(budget) - Sweeps unswept segments until budget cells have
+	been swept.  A budget < 0 means no limit.  Returns TRUE if the
+	whole store is swept.
+*/
+static BOOL sweep_slice(budget)
+long budget;
+{
+   long work;		/* cells swept */
+
+   work = 0;
+   while ( lazy_seg != NULL && (budget < 0 || work < budget) ) {
+	if ( claim(lazy_seg) ) {
+		(void)sweep_seg( lazy_seg, TRUE );
+		++lazy_cnt;
+		work += lazy_seg->ncells;
+	}
+
+	lazy_seg = lazy_seg->next;
+   }
+
+   return lazy_seg == NULL;
+}
+
+/* count_marks(seg) - Returns the # of marked cells in seg. */
+static long count_marks(seg)
+SEGMENT *seg;
+{
+   unsigned char m;
+   int b;
+   long n;
+
+   n = 0;
+   for ( b = 0; b < sizeof(seg->marks); ++b )
+	for ( m = seg->marks[b]; m != 0; m &= m - 1 )
+		++n;
+
+   return n;
+}
+
+/* mrkfields(a, m) - Shades everything the non-null cell a points to, onto
+	marker m's deque or the gray stack if m is NULL.
+*/
+static void mrkfields(a, m)
+CONS a;
+MARKER *m;
+{
+   /* this switch statement isn't really needed -- it's for my own
+    * protection.  there are a lot of "atom" nodes.  if i forget to
+    * handle one, this marker will terminate.  without the switch, if
+    * i forget to handle one, the atom isn't marked and disappears right
+    * out from underneath me.
+    */
+   switch ( mcKind(a) ) {
+	case SYMBOL:
+	case INT:
+	case FLOAT:
+	case CHAR:
+	case CFUNC:
+	case CFORM:
+	case RESUME:
+	case TOBJ:
+	case FOBJ:
+	case EOFOBJ:
+		/* nothing to do for these data-types */
+		break;
+
+	case PORT:
+		/* a string port's characters */
+		shade( m, mcPort_Str(a) );
+		break;
+
+	case STRING:
+		/* a slice's owner or a rope's halves, or its own
+		 * characters to count
+		 */
+		shade( m, mcRope_Right(a) );
+		shade( m, mcStr_Owner(a) );
+		if ( !minor && !rescanning )
+			mark_payload(a, m);
+		break;
+
+	case PAIR:
+		/* shade the car last so it's marked first */
+		shade( m, mcGet_Cdr(a) );
+		shade( m, mcGet_Car(a) );
+		break;
+
+	case FORM:
+		/* have to mark the form's information */
+		shade( m, mcForm_Parms(a) );
+		shade( m, mcForm_Body(a) );
+		break;
+
+	case CLOSURE:
+		/* have to mark the closure's information */
+		shade( m, mcCl_Parms(a) );
+		shade( m, mcCl_Body(a) );
+		shade( m, mcCl_Env(a) );
+		shade( m, mcCl_Code(a) );
+		break;
+
+	case CONT:
+		/* have to mark the continuation's info */
+		shade( m, mcCont_Env(a) );
+		shade( m, mcCont_Val(a) );
+		shade( m, mcCont_Fnc(a) );
+		shade( m, mcCont_Exp(a) );
+		break;
+
+	case BCODES:
+	   {
+		/* byte-code: have to mark the constant table */
+		int l;
+
+		if ( !minor && !rescanning )
+			mark_payload(a, m);
+
+		for ( l = 0; l < mcBC_CCSize(a); ++l )
+			shade( m, *(mcBC_Const(a)+l) );
+
+	   }
+		break;
+
+	case VECTOR:
+	   {
+		int l;
+
+		if ( !minor && !rescanning )
+			mark_payload(a, m);
+
+		for ( l = 0; l < mcVect_Size(a); l++ )
+			/* vectors can have NULL's since we use vectors
+			 * to implement environments.
+			 */
+			if ( *mcVect_Ref(a, l) )
+				shade( m, *mcVect_Ref(a, l) );
+	   }
+
+		break;
+
+	case ENVMNT:
+		/* mark the nested bindings and the global bindings */
+		shade( m, mcGet_Nested(a) );
+		shade( m, mcGet_Global(a) );
+		break;
+
+	case EXEPOINT:
+		/* execution point: have to mark the byte-code. */
+		shade( m, mcExe_BC(a) );
+
+		/* have to mark the environment */
+		shade( m, mcExe_Env(a) );
+		break;
+
+	default:
+		/* woops, forgot to handle an atom data-type.  terminate. */
+		printf("\nForgot %d.\n", mcKind(a));
+		assert(0);
+   }
+}
+
+/* mark_pop() - Returns the next cell to mark, NULL if there are none.
+	Cells go from the gray stack thru the FIFO and are prefetched on
+	the way in.
+*/
+static CONS mark_pop()
+{
+   CONS a;
+
+   /* keep the FIFO full */
+   while ( fifo_cnt < PREFETCH_DIST && gray_cnt > 0 ) {
+	a = gray[--gray_cnt];
+	PREFETCH(a);
+	fifo[fifo_in] = a;
+	fifo_in = (fifo_in + 1) % PREFETCH_DIST;
+	++fifo_cnt;
+   }
+
+   if ( fifo_cnt == 0 )
+	return NULL;
+
+   a = fifo[fifo_out];
+   fifo_out = (fifo_out + 1) % PREFETCH_DIST;
+   --fifo_cnt;
+
+   return a;
+}
+
+/* mark_drain(budget) - Marks gray cells until budget cells have come off
+	the gray stack or there are no gray cells left.  A budget < 0 means
+	no limit.  Returns TRUE if the marking is done.
+*/
+static BOOL mark_drain(budget)
+long budget;
+{
+   CONS a;
+   long work;		/* cells off the gray stack */
+   double start;
+
+   start = now_us();
+
+   work = 0;
+   while ( TRUE ) {
+#ifdef GC_THREADS
+	/* all at once: the markers can have it */
+	if ( budget < 0 && !minor && gc_threads > 1 )
+		par_mark();
+#endif
+
+	while ( (budget < 0 || work < budget) && (a = mark_pop()) != NULL ) {
+		++work;
+
+		if ( marked(a) )
+			continue;
+
+		assert( mcKind(a) != FREE );		/* should NEVER happen! */
+
+		set_mark(a);
+		++mark_cells;
+
+		/* '() is an atom */
+		if ( !mcNull(a) )
+			mrkfields(a, (MARKER *)NULL);
+	}
+
+	/* out of budget? */
+	if ( gray_cnt > 0 || fifo_cnt > 0 )
+		break;
+
+	if ( !overflow )
+		break;
+
+	rescan();
+   }
+
+   if ( !minor )
+	mark_us += now_us() - start;
+
+   return gray_cnt == 0 && fifo_cnt == 0;
+}
+
+/* rescan() - The gray stack overflowed.  Shade the fields of every marked
+	cell being collected; the ones that overflowed have white fields.
+*/
+static void rescan()
+{
+   SEGMENT *cseg;	/* current segment */
+   int i;
+
+   GC_DEBUG("overflow, rescanning, ");
+
+   overflow = FALSE;
+   rescanning = TRUE;		/* see mrkfields() */
+
+   for ( cseg = (minor ? young_segs : store); cseg != NULL;
+	 cseg = (minor ? cseg->ynext : cseg->next) ) {
+	for ( i = 0 ; i < cseg->ncells ; ++i ) {
+		if ( cseg->gen[i] != UNUSED && seg_marked(cseg, i) )
+			mrkfields( cell_at(cseg, i), (MARKER *)NULL );
+	}
+   }
+
+   /* their payloads were counted when they were marked */
+   rescanning = FALSE;
+}
+
+#ifdef GC_THREADS
+/* ----------------------------------------------------------------------- */
+/*                         Parallel Marking				   */
+/* ----------------------------------------------------------------------- */
+
+/* start_markers() - Start the helper markers.  They wait for a major GC.
+	If a thread can't be had, make do with the ones there are.
+*/
+static void start_markers()
+{
+   pthread_t thread;
+   int t;
+
+   if ( (markers = (MARKER *)malloc( gc_threads * sizeof(MARKER) )) == NULL ) {
+	FATAL("MM ERROR in InitMem: Can't allocate markers.");
+   }
+
+   mark_phase = 0;
+   for ( t = 0; t < gc_threads; ++t ) {
+	if ( (markers[t].deque = (CONS *)malloc( DEQUE_SIZE * sizeof(CONS) )) == NULL ) {
+		FATAL("MM ERROR in InitMem: Can't allocate a marker's deque.");
+	}
+	markers[t].top = markers[t].bottom = 0;
+	markers[t].id = t;
+
+	/* marker 0 is the mutator */
+	if ( t > 0 && pthread_create( &thread, NULL, marker_main, &markers[t] ) != 0 )
+		break;
+   }
+
+   gc_threads = t;
+}
+
+/* marker_main(m) - A helper marker: drain with the rest of them every
+	time par_mark() starts a phase.
+*/
+static void *marker_main(arg)
+void *arg;
+{
+   MARKER *m;
+   long phase;
+
+   m = (MARKER *)arg;
+   phase = 0;
+   while ( TRUE ) {
+	pthread_mutex_lock( &mark_lock );
+	while ( mark_phase == phase )
+		pthread_cond_wait( &mark_go, &mark_lock );
+	phase = mark_phase;
+	pthread_mutex_unlock( &mark_lock );
+
+	m_drain( m );
+
+	pthread_mutex_lock( &mark_lock );
+	if ( --mark_running == 0 )
+		pthread_cond_signal( &mark_done );
+	pthread_mutex_unlock( &mark_lock );
+   }
+
+   return NULL;
+}
+
+/* par_mark() - Mark everything that's gray with all the markers.  The
+	gray stack and the global bindings are dealt out to their deques,
+	the helpers are started, and the mutator drains with them until
+	they are all out of work.  An overflow is left for mark_drain().
+*/
+static void par_mark()
+{
+   CONS a, g;
+   long n;
+   int t, l;
+
+   for ( t = 0; t < gc_threads; ++t ) {
+	markers[t].top = markers[t].bottom = 0;
+	markers[t].cells = markers[t].bytes = 0;
+   }
+
+   n = 0;
+   if ( glo_env != NULL && (g = mcGet_Global(glo_env)) != NULL && !mcImm(g) &&
+	mcKind(g) == VECTOR && !mark(g) ) {
+	set_mark(g);
+	++mark_cells;
+	mark_payload(g, (MARKER *)NULL);
+	for ( l = 0; l < mcVect_Size(g); ++l )
+		if ( *mcVect_Ref(g, l) )
+			m_shade( &markers[n++ % gc_threads], *mcVect_Ref(g, l) );
+   }
+
+   while ( (a = mark_pop()) != NULL )
+	m_shade( &markers[n++ % gc_threads], a );
+
+   if ( n == 0 )
+	return;
+
+   /* go */
+   mark_idle = 0;
+   pthread_mutex_lock( &mark_lock );
+   mark_running = gc_threads - 1;
+   ++mark_phase;
+   pthread_cond_broadcast( &mark_go );
+   pthread_mutex_unlock( &mark_lock );
+
+   m_drain( &markers[0] );
+
+   pthread_mutex_lock( &mark_lock );
+   while ( mark_running > 0 )
+	pthread_cond_wait( &mark_done, &mark_lock );
+   pthread_mutex_unlock( &mark_lock );
+
+   for ( t = 0; t < gc_threads; ++t ) {
+	mark_cells += markers[t].cells;
+	mark_bytes += markers[t].bytes;
+   }
+   mark_threads = gc_threads;
+}
+
+/* m_drain(m) - Marker m marks cells off its own deque, then steals, until
+	every marker is out of work.  A marker can only run out with its
+	own deque empty, and one that's out pushes nothing, so when they
+	are all out there is nothing gray left.
+*/
+static void m_drain(m)
+MARKER *m;
+{
+   CONS a;
+
+   while ( TRUE ) {
+	while ( (a = m_pop(m)) != NULL || (a = m_steal(m)) != NULL ) {
+		if ( !m_set_mark(a) )
+			continue;
+
+		assert( mcKind(a) != FREE );		/* should NEVER happen! */
+
+		++m->cells;
+
+		/* '() is an atom */
+		if ( !mcNull(a) )
+			mrkfields(a, m);
+	}
+
+	__atomic_add_fetch( &mark_idle, 1, __ATOMIC_SEQ_CST );
+	while ( !m_work() ) {
+		if ( __atomic_load_n( &mark_idle, __ATOMIC_SEQ_CST ) == gc_threads )
+			return;
+		sched_yield();
+	}
+	__atomic_sub_fetch( &mark_idle, 1, __ATOMIC_SEQ_CST );
+   }
+}
+
+/* m_shade(m, p) - Make the white cell p gray on marker m's deque.  If the
+	deque is full, p is marked instead and picked up by rescan().
+*/
+static void m_shade(m, p)
+MARKER *m;
+CONS p;
+{
+   if ( p == NULL || mcImm(p) || m_mark(p) )
+	return;
+
+   if ( !m_push(m, p) && m_set_mark(p) ) {
+	/* overflow: mark it now, scan its fields later */
+	++m->cells;
+	if ( has_payload(p) )
+		mark_payload(p, m);
+	__atomic_store_n( &overflow, TRUE, __ATOMIC_RELAXED );
+   }
+}
+
+/* m_push(m, p) - Push p on the bottom of m's own deque.  Returns FALSE if
+	the deque is full.
+*/
+static BOOL m_push(m, p)
+MARKER *m;
+CONS p;
+{
+   long b, t;
+
+   b = m->bottom;
+   t = __atomic_load_n( &m->top, __ATOMIC_ACQUIRE );
+   if ( b - t >= DEQUE_SIZE )
+	return FALSE;
+
+   PREFETCH(p);
+   __atomic_store_n( &m->deque[b & (DEQUE_SIZE-1)], p, __ATOMIC_RELAXED );
+   __atomic_store_n( &m->bottom, b + 1, __ATOMIC_RELEASE );
+   return TRUE;
+}
+
+/* m_pop(m) - Pop the bottom of m's own deque.  Returns NULL if it's empty
+	or a thief got the last cell first.
+*/
+static CONS m_pop(m)
+MARKER *m;
+{
+   long b, t;
+   CONS p;
+
+   b = m->bottom - 1;
+   __atomic_store_n( &m->bottom, b, __ATOMIC_RELAXED );
+   __atomic_thread_fence( __ATOMIC_SEQ_CST );
+   t = __atomic_load_n( &m->top, __ATOMIC_RELAXED );
+
+   if ( t > b ) {
+	/* empty */
+	__atomic_store_n( &m->bottom, b + 1, __ATOMIC_RELAXED );
+	return NULL;
+   }
+
+   p = __atomic_load_n( &m->deque[b & (DEQUE_SIZE-1)], __ATOMIC_RELAXED );
+   if ( t == b ) {
+	/* the last cell: race the thieves for it */
+	if ( !__atomic_compare_exchange_n( &m->top, &t, t + 1, FALSE,
+					   __ATOMIC_SEQ_CST, __ATOMIC_RELAXED ) )
+		p = NULL;
+	__atomic_store_n( &m->bottom, b + 1, __ATOMIC_RELAXED );
+   }
+
+   return p;
+}
+
+/* m_steal(m) - Take the top cell of another marker's deque, trying each
+	in turn from m's right.  Returns NULL if none was had.
+*/
+static CONS m_steal(m)
+MARKER *m;
+{
+   MARKER *v;		/* victim */
+   long b, t;
+   CONS p;
+   int i;
+
+   for ( i = 1; i < gc_threads; ++i ) {
+	v = &markers[(m->id + i) % gc_threads];
+
+	t = __atomic_load_n( &v->top, __ATOMIC_ACQUIRE );
+	__atomic_thread_fence( __ATOMIC_SEQ_CST );
+	b = __atomic_load_n( &v->bottom, __ATOMIC_ACQUIRE );
+	if ( t >= b )
+		continue;
+
+	p = __atomic_load_n( &v->deque[t & (DEQUE_SIZE-1)], __ATOMIC_RELAXED );
+	if ( __atomic_compare_exchange_n( &v->top, &t, t + 1, FALSE,
+					  __ATOMIC_SEQ_CST, __ATOMIC_RELAXED ) )
+		return p;
+   }
+
+   return NULL;
+}
+
+/* m_work() - Is there a cell on any marker's deque? */
+static BOOL m_work()
+{
+   int t;
+
+   for ( t = 0; t < gc_threads; ++t )
+	if ( __atomic_load_n( &markers[t].top, __ATOMIC_ACQUIRE ) <
+	     __atomic_load_n( &markers[t].bottom, __ATOMIC_ACQUIRE ) )
+		return TRUE;
+
+   return FALSE;
+}
+#endif
+
+#ifdef GC_THREADS
+/* ----------------------------------------------------------------------- */
+/*                         Background Sweeping				   */
+/* ----------------------------------------------------------------------- */
+
+/* start_sweeper() - Start the sweeper.  It waits for a major GC to be
+	over.  If there's no thread to be had, the mutator sweeps.
+*/
+static void start_sweeper()
+{
+   pthread_t thread;
+
+   dead_q.cnt = dead_own.cnt = 0;
+   dead_q.max = dead_own.max = INIT_DEAD;
+   if ( (dead_q.p = (void **)malloc( INIT_DEAD * sizeof(void *) )) == NULL ||
+	(dead_own.p = (void **)malloc( INIT_DEAD * sizeof(void *) )) == NULL ) {
+	FATAL("MM ERROR in InitMem: Can't allocate the sweeper's queue.");
+   }
+
+   sweep_run = sweep_busy = FALSE;
+   if ( pthread_create( &thread, NULL, sweeper_main, NULL ) != 0 )
+	bg_sweep = FALSE;
+}
+
+/* sweeper_main() - The sweeper: free the payloads the mutator queued,
+	and sweep the store when sweep_post() says so.
+*/
+static void *sweeper_main(arg)
+void *arg;
+{
+   DEAD q;
+   BOOL run;
+   long l;
+
+   while ( TRUE ) {
+	pthread_mutex_lock( &sweep_lock );
+	while ( !sweep_run && dead_q.cnt == 0 )
+		pthread_cond_wait( &sweep_go, &sweep_lock );
+	run = sweep_run;
+	sweep_run = FALSE;
+
+	/* take the queue, leave the mutator an empty one */
+	q = dead_q;
+	dead_q = dead_own;
+	dead_own = q;
+	pthread_mutex_unlock( &sweep_lock );
+
+	for ( l = 0; l < dead_own.cnt; ++l )
+		free( dead_own.p[l] );
+	dead_own.cnt = 0;
+
+	if ( run ) {
+		bg_sweep_store();
+
+		pthread_mutex_lock( &sweep_lock );
+		sweep_busy = FALSE;
+		pthread_cond_broadcast( &sweep_idle );
+		pthread_mutex_unlock( &sweep_lock );
+	}
+   }
+
+   return NULL;
+}
+
+/* bg_sweep_store() - Sweep every class from the front, a segment of each
+	in turn, the way the allocators will get to them.  Segments the
+	mutator claimed first are skipped.
+*/
+static void bg_sweep_store()
+{
+   SEGMENT *seg;
+   BOOL more;
+   int c;
+
+   do {
+	more = FALSE;
+	for ( c = 0; c < NUM_CLS; ++c ) {
+		if ( (seg = sweep_from[c]) == NULL )
+			continue;
+
+		more = TRUE;
+		if ( claim(seg) ) {
+			(void)sweep_seg( seg, FALSE );
+			bg_give_back();
+			__atomic_add_fetch( &bg_cnt, 1, __ATOMIC_RELAXED );
+		}
+		sweep_from[c] = seg->cnext;
+	}
+   } while ( more );
+}
+
+/* bg_give_back() - Give the blocks the sweeper freed back to their
+	pools, all at once.
+*/
+static void bg_give_back()
+{
+   int c;
+
+   for ( c = 0; c < POOL_CNT && bg_blocks[c] == NULL; ++c )
+	;
+   if ( c == POOL_CNT )
+	return;
+
+   pthread_mutex_lock( &sweep_lock );
+   for ( ; c < POOL_CNT; ++c ) {
+	if ( bg_blocks[c] == NULL )
+		continue;
+
+	*(void **)bg_last[c] = pools[c].back;
+	__atomic_store_n( &pools[c].back, bg_blocks[c], __ATOMIC_RELAXED );
+	bg_blocks[c] = NULL;
+   }
+   pthread_mutex_unlock( &sweep_lock );
+}
+
+/* sweep_post(run) - Wake the sweeper up for the payloads queued, and if
+	run, to sweep the store a major GC just left.
+*/
+static void sweep_post(run)
+BOOL run;
+{
+   int c;
+
+   pthread_mutex_lock( &sweep_lock );
+   if ( run ) {
+	for ( c = 0; c < NUM_CLS; ++c )
+		sweep_from[c] = classes[c].segs;
+	sweep_run = sweep_busy = TRUE;
+   }
+   if ( sweep_run || dead_q.cnt > 0 )
+	pthread_cond_signal( &sweep_go );
+   pthread_mutex_unlock( &sweep_lock );
+}
+
+/* sweep_wait() - Wait for the sweeper to be done with the store. */
+static void sweep_wait()
+{
+   pthread_mutex_lock( &sweep_lock );
+   while ( sweep_busy )
+	pthread_cond_wait( &sweep_idle, &sweep_lock );
+   pthread_mutex_unlock( &sweep_lock );
+}
+#endif
+
+/* stack_cell(w) - Returns the cell in use that w could be pointing into,
+	or NULL.  See the notes.
+*/
+static CONS stack_cell(w)
+PTR_INT w;
+{
+   SEGMENT *seg;
+   long off;
+   int i, g;
+
+   if ( (seg = heap_seg(w)) == NULL || w < (PTR_INT)seg->first )
+	return NULL;
+
+   off = (long)(w - (PTR_INT)seg->first);
+   i = (int)( seg->shift ? off >> seg->shift : off / (long)BIG_BYTES );
+   if ( i >= seg->ncells )
+	return NULL;
+
+   /* OLD cells aren't traced by a minor GC, and the sweeper may be
+    * freeing them.
+    */
+   g = gen_at(seg, i);
+   if ( g == UNUSED || (minor && g != YOUNG) )
+	return NULL;
+
+   return cell_at(seg, i);
+}
+
+/* shade_stack() - Shades every cell a word on the C stack, or in a
+	register, could be pointing into.  The registers are spilled
+	into this frame first.
+*/
+NO_ASAN static void shade_stack()
+{
+   jmp_buf regs;
+   PTR_INT *w, *lo, *hi;
+   CONS p;
+
+#ifdef __GNUC__
+   __builtin_unwind_init();
+#endif
+   (void)setjmp( regs );
+
+   lo = (PTR_INT *)&regs;
+   hi = (PTR_INT *)stack_base;
+   if ( lo > hi ) {
+	/* the stack grows up */
+	w = lo;
+	lo = hi;
+	hi = w + sizeof(regs) / (sizeof(PTR_INT));	/* in words, not jmp_bufs */
+   }
+   lo = (PTR_INT *)( ((PTR_INT)lo + sizeof(PTR_INT)-1) & ~(PTR_INT)(sizeof(PTR_INT)-1) );
+
+   stack_words = hi - lo + 1;
+   stack_cells = 0;
+   for ( w = lo; w <= hi; ++w ) {
+	if ( (p = stack_cell( *w )) != NULL ) {
+		Shade( p );
+		++stack_cells;
+	}
+   }
+}
+
+/* shade_roots() - Shades everything the stacks, the C stack, the symbol
+	table and the environment point to.  For a major GC this is the
+	snapshot.  For a minor GC the nested bindings and the remembered
+	set are roots too.  Shade() ignores the NULL's used in environments
+	for unbound symbols.
+*/
+static void shade_roots()
+{
+   CONS *i, g;
+   int r, n;
+
+   shade_stack();
+
+   for (i = Top_RegS; i > RegStack ; i--)
+	Shade( *i );
+
+   /* a minor GC only looks above the low-water marks */
+   for (i = Top_Expr; i > (minor ? Low_Expr : ExprStack) ; i--)
+	Shade( *i );
+
+   for (i = Top_Val; i > (minor ? Low_Val : ValStack) ; i--)
+	Shade( *i );
+
+   for (i = Top_Func; i > (minor ? Low_Func : FuncStack) ; i--)
+	Shade( *i );
+
+   /* the symbol table is weak: a minor GC keeps the symbols added
+    * since the last GC, a major GC the ones that are bound.
+    */
+   if ( minor ) {
+	for ( r = 0; r < SymNewCnt; ++r )
+		Shade( SymCell[SymNew[r]] );
+   }
+   else if ( glo_env != NULL && (g = mcGet_Global(glo_env)) != NULL && !mcImm(g) ) {
+	n = SymCount < mcVect_Size(g) ? SymCount : mcVect_Size(g);
+	for ( r = 0; r < n; ++r )
+		if ( *mcVect_Ref(g, r) != NULL )
+			Shade( SymCell[r] );
+   }
+
+   Shade( glo_env );
+
+   if ( minor ) {
+	/* the nested bindings are stored without a write barrier */
+	if ( glo_env )
+		Shade( mcGet_Nested(glo_env) );
+
+	/* OLD cells pointing at YOUNG cells */
+	for ( r = 0; r < rem_cnt; ++r )
+		mrkfields( remset[r], (MARKER *)NULL );
+   }
+}
+
+/* minor_gc() - Collect the YOUNG cells.  Reachable YOUNG cells are
+	promoted to OLD, unreachable ones are made FREE.  Only segments on
+	the young list are swept.
+*/
+static void minor_gc()
+{
+   SEGMENT *cseg;	/* current segment */
+   int i, r, c;
+   long prom, rec;	/* for stats: promoted nodes, recovered nodes */
+   long srec;		/* recovered in the current segment */
+
+   assert( !gc_marking );
+
+   GC_DEBUG("\nMinor GC: marking, ");
+
+   minor = TRUE;
+   pay_minor = 0;
+   shade_roots();
+   (void)mark_drain( -1L );
+
+   GC_DEBUG("collecting, ");
+
+   prom = rec = 0;
+   for ( cseg = young_segs; cseg != NULL; cseg = cseg->ynext ) {
+	srec = 0;
+	for ( i = 0 ; i < cseg->ncells ; ++i ) {
+
+	   /* OLD and FREE cells aren't touched by a minor GC */
+	   if ( cseg->gen[i] != YOUNG )
+		continue;
+
+	   if ( seg_marked(cseg, i) ) {
+		/* survivor: promote it */
+		++prom;
+		cseg->gen[i] = OLD;
+	   } else {
+		++srec;
+		old_cons(cseg, i, TRUE);
+	   }
+	}
+	cseg->nfree += srec;
+	classes[cseg->cls].free += srec;
+	rec += srec;
+
+	/* only YOUNG cells were marked */
+	memset( cseg->marks, 0, sizeof(cseg->marks) );
+	cseg->young = FALSE;
+   }
+   young_segs = NULL;
+
+   /* the YOUNG cells are all OLD now; empty the remembered set */
+   for ( r = 0; r < rem_cnt; ++r )
+	set_gen(remset[r], OLD);
+
+   if ( gc_debug )
+	printf("Minor GC %ld: Promoted: %ld  Recovered: %ld  Remembered: %d  Free: %ld  Payload freed: %ld\n",
+		++minor_cnt, prom, rec, rem_cnt, free_cnt + rec, pay_minor);
+   else ++minor_cnt;
+
+   rem_cnt = 0;
+   minor = FALSE;
+   Low_Expr = Top_Expr;
+   Low_Val = Top_Val;
+   Low_Func = Top_Func;
+   free_cnt += rec;
+   promoted += prom;
+   nursery_cnt = 0;
+   pay_young = 0;
+   SymNewCnt = 0;
+   for ( c = 0; c < NUM_CLS; ++c ) {
+	classes[c].allocs = classes[c].nursery;
+	classes[c].made += classes[c].nursery;
+	classes[c].nursery = 0;
+   }
+   reset_alloc();
+
+#ifdef GC_THREADS
+   /* the vectors and byte-code freed */
+   if ( bg_sweep )
+	sweep_post( FALSE );
+#endif
+}
+
+/* major_request() - A major GC is due.  Start it as soon as the last one
+	is swept, or do it all at once if gc_budget is 0.
+*/
+static void major_request()
+{
+   if ( gc_budget <= 0 )
+	major_gc();
+   else if ( sweep_slice( gc_budget ) )
+	major_start();
+   else sweep_pending = TRUE;
+}
+
+/* major_start() - Start a major GC: finish sweeping after the last one,
+	then shade the roots.  NewCons() takes it from here a slice at a
+	time.
+*/
+static void major_start()
+{
+   assert( !gc_marking && gray_cnt == 0 );
+
+   sweep_all();
+
+   GC_DEBUG("\nMajor GC: marking");
+
+   minor = FALSE;
+   gc_marking = TRUE;
+   slice_cnt = 0;
+   mark_cells = mark_bytes = 0;
+   mark_us = 0.0;
+   mark_threads = 1;
+   shade_roots();
+}
+
+/* major_slice(budget) - Mark budget gray cells.  A budget < 0 means no
+	limit.  When there are no gray cells left the marking is done and
+	the store is swept.  Returns TRUE if the major GC is over.
+*/
+static BOOL major_slice(budget)
+long budget;
+{
+   assert( gc_marking );
+
+   GC_DEBUG(".");
+
+   if ( !mark_drain(budget) )
+	return FALSE;
+
+   last_cells = mark_cells;
+   last_us = mark_us;
+   last_threads = mark_threads;
+
+   major_sweep();
+   return TRUE;
+}
+
+/* sweep_symbols() - Drops the symbols whose cells weren't marked from
+	the symbol table.  The cells are swept with the rest, so it has to
+	be done before the next allocation.
+*/
+static void sweep_symbols()
+{
+   int r;
+
+   for ( r = 0; r < SymCount; ++r )
+	if ( SymCell[r] != NULL && !mark(SymCell[r]) )
+		ssDrop( r );
+}
+
+/* major_sweep() - Finish a major GC.  Counts the live cells and sweeps
+	the young segments.  The rest of the store is swept lazily by
+	next_cell().  Everything that survives is OLD.
+*/
+static void major_sweep()
+{
+   SEGMENT *cseg;	/* current segment */
+   CLASS *cl;
+   int r;
+   long used, rec;	/* for stats: used nodes, recovered nodes */
+
+   GC_DEBUG(" collecting, ");
+
+   gc_marking = FALSE;
+   sweep_symbols();
+
+   /* every cell that isn't marked is garbage, swept or not */
+   used = 0;
+   for ( cl = classes; cl < classes + NUM_CLS; ++cl ) {
+	cl->live = 0;
+	for ( cseg = cl->segs ; cseg != NULL ; cseg = cseg->cnext) {
+		cl->live += count_marks( cseg );
+		cseg->swept = FALSE;
+	}
+	cl->free = cl->total - cl->live;
+	cl->made += cl->nursery;
+	cl->nursery = 0;
+	used += cl->live;
+   }
+
+   /* so is every payload of a cell that isn't marked.  the large ones
+    * go now, the rest as their cells are swept.
+    */
+   pay_major = pay_live - mark_bytes;
+   pay_old = mark_bytes;
+   (void)sweep_large();
+
+   /* the young segments can't wait: the next minor GC takes any YOUNG
+    * cell it finds for a new one.
+    */
+   for ( cseg = young_segs; cseg != NULL; cseg = cseg->ynext ) {
+	(void)sweep_seg( cseg, TRUE );
+	cseg->young = FALSE;
+   }
+   young_segs = NULL;
+
+   /* everything is OLD so there is nothing to remember */
+   for ( r = 0; r < rem_cnt; ++r )
+	if ( GenOf(remset[r]) != UNUSED )
+		GenOf(remset[r]) = OLD;
+   rem_cnt = 0;
+
+   rec = total_cnt - free_cnt - used;
+   free_cnt = total_cnt - used;
+
+   if ( gc_debug )
+	printf("Major GC %ld: Used: %ld  Recovered: %ld  Free: %ld  Payload freed: %ld\n",
+		++major_cnt, used, rec, free_cnt, pay_major);
+   else ++major_cnt;
+
+   live_major = used;
+   promoted = 0;
+   nursery_cnt = 0;
+   pay_young = 0;
+   SymNewCnt = 0;
+
+   /* leave room for the old generation to grow before the next major
+    * GC, and a nursery to spare so the next minor GC doesn't ask for
+    * another one straight away.  give back what's left empty if there's
+    * more than enough.
+    */
+   grow( 3, TRUE, heap_max );
+   shrink();
+
+   lazy_seg = store;
+   reset_alloc();
+
+#ifdef GC_THREADS
+   /* the sweeper takes it from here */
+   if ( bg_sweep )
+	sweep_post( TRUE );
+#endif
+}
+
+/* major_gc() - Collect the entire store, all at once.  Finishes the
+	incremental major GC if there is one in progress.
+*/
+static void major_gc()
+{
+   if ( !gc_marking )
+	major_start();
+
+   (void)major_slice( -1L );
+}
+
+/* collect() - The nursery is full or the store is out of FREE cells.  Run
+	a minor GC, then a major GC if the old generation has doubled or if
+	memory is still tight.  If even that doesn't leave room for a full
+	nursery, system memory is obtained (malloc).
+*/
+static void collect()
+{
+   /* we've gotta have mem inorder to GC */
+   if ( store == NULL ) {
+	GetMem();
+	return;
+   }
+
+   begin_pause();
+
+   if ( gc_marking ) {
+	/* out of memory before the incremental major GC finished */
+	major_gc();
+   }
+   else {
+	minor_gc();
+
+	/* below -H the heap grows instead */
+	if ( heap_segs * SEG_BYTES < heap_goal )
+		grow( 2, FALSE, heap_goal );
+
+	if ( short_of(1) )
+		/* memory is tight; can't wait for an incremental GC */
+		major_gc();
+	else if ( !sweep_pending && (short_of(2) ||
+		(heap_segs * SEG_BYTES >= heap_goal &&
+		 promoted > (live_major < NURSERY_CONS ? NURSERY_CONS : live_major)) ||
+		pay_bytes() > 2 * (pay_old < PAY_NURSERY ? PAY_NURSERY : pay_old)) ) {
+		/* getting tight, or the old generation has doubled */
+		major_request();
+	}
+   }
+
+   grow( 1, FALSE, heap_max );
+
+   end_pause();
+}
+
+/* ----------------------------------------------------------------------- */
+/*                         Pause Statistics				   */
+/* ----------------------------------------------------------------------- */
+
+/* now_us() - Returns the time in micro-seconds.  Wall clock time if
+	there are markers, since clock() adds up all their cpu time.
+*/
+static double now_us()
+{
+#ifdef GC_THREADS
+   struct timespec ts;
+
+   clock_gettime( CLOCK_MONOTONIC, &ts );
+   return (double)ts.tv_sec * 1000000.0 + (double)ts.tv_nsec / 1000.0;
+#else
+   return (double)clock() * 1000000.0 / CLOCKS_PER_SEC;
+#endif
+}
+
+/* begin_pause() - The mutator is stopped. */
+static void begin_pause()
+{
+   pause_start = now_us();
+}
+
+/* end_pause() - The mutator is about to run again; record the length of
+	the pause.
+*/
+static void end_pause()
+{
+   double us;
+   int b;
+
+   us = now_us() - pause_start;
 
-   if (free_cons == NULL) return 0;
-   for (i = 1, temp = free_cons ; next_free(temp) != NULL ; i++)
-	temp = next_free(temp);
+   for ( b = 0; b < PAUSE_BUCKETS-1 && us >= pause_lim[b]; ++b )
+	;
 
-   return i;
+   ++pause_cnt[b];
+   ++pause_tot;
+   pause_sum += us;
+   if ( us > pause_max )
+	pause_max = us;
 }
@@ -1,6 +1,60 @@
 /* Memory manager header file */
 
+/* segments -- see notes in memory.c.  a segment holds cells of one size
+	class.  its header has the mark bit and the generation of every
+	cell in it, so the cells themselves don't need room for them.
+*/
+#define SEG_BYTES	16384L	/* size of a segment; a power of 2 */
+#define MAX_CELLS	((int)(SEG_BYTES / sizeof(struct Pair)))
+
+/* size of a cell in the BIG_CLS class */
+#define BIG_BYTES	((sizeof(CONSNODE) + 7) & ~(unsigned)7)
+
+struct Seg {
+   struct Seg *next;		/* next segment in the store */
+   struct Seg *cnext;		/* next segment of the same class */
+   struct Seg *ynext;		/* next segment on the young list */
+   char *first;			/* the first cell */
+   int cls;			/* size class */
+   int size;			/* bytes per cell */
+   int shift;			/* log2(size); 0 for BIG_CLS */
+   int tag;			/* added to a cell's address to make a CONS */
+   int ncells;			/* # of cells in this segment */
+   int nfree;			/* # of FREE cells in this segment */
+   BOOL young;			/* on the young list? */
+   BOOL swept;			/* swept since the last major GC? */
+   unsigned char marks[(MAX_CELLS + 7) / 8];
+   unsigned char gen[MAX_CELLS];	/* YOUNG, OLD, REMEMBERED or UNUSED */
+} ;
+typedef struct Seg SEGMENT;
+
+/* the segment of cell p, the cell's # in it, and its generation */
+#define seg_of(p)	((SEGMENT *)((PTR_INT)(p) & ~(PTR_INT)(SEG_BYTES-1)))
+#define cell_no(s, p)	((int)( (s)->shift ? ((char *)(p) - (s)->first) >> (s)->shift \
+				: ((char *)(p) - (s)->first) / BIG_BYTES ))
+#define GenOf(p)	( seg_of(p)->gen[cell_no(seg_of(p), (p))] )
+
+/* write barrier -- must follow every store of v into a field of an
+	object o that may have survived a GC.  see notes in memory.c.
+*/
+#define WBarrier(o, v)	( GenOf(o) == OLD && (v) != NULL && !mcImm(v) && GenOf(v) == YOUNG ? Remember( (o) ) : (void)0 )
+
+/* snapshot barrier -- must precede every store that overwrites the
+	pointer p in a cell.  only does anything while an incremental
+	major GC is marking.  see notes in memory.c.
+*/
+#define SBarrier(p)	( gc_marking && (p) != NULL ? Shade( (p) ) : (void)0 )
+
+extern int gc_marking;
+
 /* proto-types */
-void InitMem( C_INT X C_CHAR C_PTR C_PTR );
+void InitMem( C_INT X C_CHAR C_PTR C_PTR X C_CHAR C_PTR );
 CONS NewCons( C_INT X C_INT X C_INT );
+char *NewStr( C_INT );
+int CellBytes( C_INT );
 void GetMem( C_VOID );
+void Remember( C_CONS );
+void Shade( C_CONS );
+void GcStats( C_VOID );
+void FullGc( C_VOID );
+long MemSize( C_CHAR C_PTR );
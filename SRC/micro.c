@@ -3,13 +3,72 @@
    Optimizations:
 	- mcCar, mcCdr can be implemented as macros.
 
+   Version 3 - Tagged pairs
+
+	- A pair is a bare car and cdr now (see notes in memory.c).  Its
+	CONS is its address plus PAIR_TAG, so the type of a pair is in the
+	CONS like an immediate's is.  Cells are 8 byte aligned, so the low
+	three bits of a CONS say pair, immediate or some other cell.
+	mcGet_Car() and mcGet_Cdr() take the tag off.
+
+	- mcCopyCons() copies a cell by its size class (CellBytes()); a
+	cell's generation isn't in the cell anymore.
+
+   Version 4 - Conservative roots
+
+	- ENTER, REG(), R() and the LEAVE macros are gone.  A CONS in a C
+	local is a plain CONS: a GC scans the C stack and the registers
+	for anything that could point into a segment (see the notes in
+	memory.c), so every local is ACTIVE without being declared so.
+
+	- The register stack is left for the system constants and for
+	cells only held where the GC can't see, like the constant table
+	of a code buffer (cpLambda()).  mcRegPush() checks it for
+	overflow.
+
+   Version 5 - Growable stacks
+
+	- The register, expression, value and function stacks were arrays
+	of 1500 entries, so recursion a few hundred deep or APPLY of a long
+	list ran out of stack.  Each is now as big as --stack-max (bytes,
+	STACK_MAX if not given), but only its first STACK_SEG entries are
+	there to start with.  With MMAP_ARENA (machine.h) the rest is only
+	reserved address space, and a push past the end of the segments
+	adds another (mcGrowStack()).  The stacks never move, so pointers
+	into them stay good -- continuations, evGatherVal() and the GC all
+	walk them with pointers.
+
+	- The push routines still only compare the top to a limit; it's the
+	end of the segments now instead of the end of the array.  When the
+	evaluator is back at the top-level (mcClearStacks()), the stacks
+	give back every segment but the first.  The pops keep the low-water
+	marks a minor GC needs so it doesn't shade a deep stack all over
+	again (see notes in memory.c).
+
+   Version 2 - Immediates
+
+	- Small integers, characters, #T, #F, '() and the EOF object aren't
+	cells anymore.  They're encoded in the bits of the CONS itself
+	(see micro.h).  Cells are at least 4 byte aligned, so a CONS with
+	either of its low two bits set can't be a pointer.  mcKind(),
+	mcGet_Int() and mcGet_Char() decode immediates; everything else
+	that looks inside a CONS must make sure it has a cell first.
+
+	- mcIntToCons() and mcCharToCons() don't allocate.  An integer too
+	big to be a fixnum (only possible if ints are as wide as pointers)
+	still gets an INT cell.  FLOATs are still cells.
+
+	- The MM never sees an immediate: Shade() and the write barrier
+	ignore them.  Immediates are equal if and only if they're eq, so
+	(eq? 5 5) => #T now.
+
    Version 1
 	- Lowest level C routines which manipulate the structures directly.
 
 	- ACTIVE - Node will be marked during GC and WON'T disappear.
 	  INACTIVE - Node is unknown to GC and will disappear next GC.
 
-	- Register variables are used to ACTIVATE nodes:
+	- Register variables are used to ACTIVATE nodes (until Version 4):
 
 	   ENTER  - marks the register stack-top.
 	   REG(x) - makes x an ACTIVATED cons node by pushing it on the
@@ -33,9 +92,20 @@
 
 #include "machine.h"
 
+#include STDLIB_H
 #include MEMORY_H
 #include STRING_H
 
+#ifdef MMAP_ARENA
+#	include <sys/mman.h>
+#	ifndef MAP_ANONYMOUS
+#		define MAP_ANONYMOUS	MAP_ANON
+#	endif
+#	ifndef MAP_NORESERVE
+#		define MAP_NORESERVE	0
+#	endif
+#endif
+
 #include "glo.h"
 #include "micro.h"
 #include "eval.h"
@@ -46,15 +116,20 @@
 #include "predefs.h"
 
 /* globals */
-CONS RegStack[MAX_REGSTACK];		/* register stack */
-CONS ExprStack[MAX_EXPRSTACK];		/* expression stack */
-CONS ValStack[MAX_VALSTACK];		/* value stack */
-CONS FuncStack[MAX_FUNCSTACK];		/* the function stack */
+CONS *RegStack;				/* register stack */
+CONS *ExprStack;			/* expression stack */
+CONS *ValStack;				/* value stack */
+CONS *FuncStack;			/* the function stack */
 CONS *Top_RegS;				/* top of the register stack */
 CONS *SavedRegs;			/* saved register stack */
 CONS *Top_Expr;				/* top exp on exp stack */
 CONS *Top_Val;				/* top val on value stack */
 CONS *Top_Func;				/* top func on function stack */
+CONS *Low_Expr, *Low_Val, *Low_Func;	/* lowest tops since the last minor GC */
+
+/* the last entry of each stack's segments so far */
+static CONS *Lim_RegS, *Lim_Expr, *Lim_Val, *Lim_Func;
+static long stack_max;			/* entries each stack can grow to */
 
 /* system constants */
 CONS NIL;				/* empty list */
@@ -69,32 +144,62 @@ CONS PUSHFUNC;				/* push func onto the func stack */
 CONS RESTORE;				/* restore the environment */
 CONS EXP_RESUME;			/* resume mcExpandOnce() */
 CONS EXP_TABLE;				/* symbol: *EXPANSION-TABLE* */
+CONS EXP_CACHE;				/* memoized macro expansions */
+CONS MAC_TABLE;				/* hashed *EXPANSION-TABLE* */
 
 /* local prototypes */
 static void mcNewStacks( C_VOID );
+static CONS *mcMakeStack( C_VOID );
+static CONS *mcGrowStack( CONS * X CONS * X C_CHAR C_PTR );
+static CONS *mcTrimStack( CONS * X CONS * );
 static CONS mcDefConst( C_CHAR C_PTR );
-
-/* InitMicro() - Initializes the microcode.
-	- initialize the stacks
+static CONS str_owner( C_CONS );
+static CONS rope_part( C_CONS );
+static CONS rope_node( C_CONS X C_CONS );
+static CONS rope_bal( C_CONS X C_CONS );
+static CONS rope_join( C_CONS X C_CONS );
+static char *rope_copy( C_CONS X C_CHAR C_PTR );
+
+/* InitMicro(argc, argv) - Initializes the microcode.
+	- initialize the stacks (--stack-max=<size> is how big they get)
 	- create needed system variables (NIL, T, CALL, MARK, etc ...)
 */
-void InitMicro()
+void InitMicro(argc, argv)
+int argc;
+char *argv[];
 {
+   int l;
+
    /* create NIL */
-   NIL = NewCons( NILNODE, 0, 0 );
+   NIL = mcMkImm( NILNODE, 0 );
+
+   stack_max = STACK_MAX;
+   for ( l = 1; l < argc; l++ )
+	if ( strncmp( argv[l], "--stack-max=", 12 ) == 0 )
+		stack_max = MemSize( &argv[l][12] );
+
+   /* in entries, and at least a segment */
+   stack_max /= sizeof(CONS);
+   if ( stack_max < STACK_SEG )
+	stack_max = STACK_SEG;
 
    /* create the stacks */
+   RegStack = mcMakeStack();
+   ExprStack = mcMakeStack();
+   ValStack = mcMakeStack();
+   FuncStack = mcMakeStack();
+   Lim_RegS = RegStack + STACK_SEG - 1;
+   Lim_Expr = ExprStack + STACK_SEG - 1;
+   Lim_Val = ValStack + STACK_SEG - 1;
+   Lim_Func = FuncStack + STACK_SEG - 1;
    mcNewStacks();
 
-   mcRegPush(NIL);		/* put on register stack so not GCed */
-
-   /* create other Scheme objects */
-   T = NewCons( TOBJ, 0, 0 );
-   mcRegPush( T );
-   F = NewCons( FOBJ, 0, 0 );
-   mcRegPush( F );
-   EOF_OBJ = NewCons( EOFOBJ, 0, 0 );
-   mcRegPush( EOF_OBJ );
+   /* create other Scheme objects -- immediates, so the GC never sees
+    * them.
+    */
+   T = mcMkImm( TOBJ, 0 );
+   F = mcMkImm( FOBJ, 0 );
+   EOF_OBJ = mcMkImm( EOFOBJ, 0 );
 
    /* create system variables */
    CALL = mcDefConst( "*CALL*" );
@@ -109,6 +214,11 @@ void InitMicro()
    EXP_RESUME = evMkResume( prmcExpand );
    mcRegPush( EXP_RESUME );
 
+   EXP_CACHE = mcMakeVector( EXP_SLOTS * EXP_WIDTH, NIL );
+   mcRegPush( EXP_CACHE );
+   MAC_TABLE = mcMakeVector( MAC_BUCKETS, NIL );
+   mcRegPush( MAC_TABLE );
+
    STDIN = NewCons( PORT, 0, 0 );
    mcCpy_Port(STDIN, stdin);
    mcCpy_PortType( STDIN, INPUT );
@@ -126,15 +236,21 @@ void InitMicro()
 }
 
 /* mcDefConst(n) - Define a system constant whose name is n.  Saves the
-	constant on the register stack AND returns it.
+	constant on the register stack AND returns it.  It's a cell of its
+	own, not the symbol n, so reading n can't make a *MARK*.
 */
 static CONS mcDefConst(n)
 char *n;
 {
-   CONS tmp;
+   CONS sym, tmp;
 
+   /* n is kept too, or the GC would drop it and give its # to
+    * another symbol.
+    */
+   sym = ssIntern(n);
+   mcRegPush(sym);
    tmp = NewCons( SYMBOL, 0, 0 );
-   mcCpy_Sym(tmp, n);
+   mcSym_No(tmp) = mcSym_No(sym);
    mcRegPush(tmp);
    return tmp;
 }
@@ -150,6 +266,9 @@ static void mcNewStacks()
    Top_Val  = ValStack;
    Top_Func = FuncStack;
    Top_RegS = RegStack;		/* totally clear the register stack */
+   Low_Expr = ExprStack;
+   Low_Val = ValStack;
+   Low_Func = FuncStack;
 }
 
 /* mcClearStacks() - Clears the expression and value stacks.  Restores the
@@ -163,39 +282,127 @@ void mcClearStacks()
    Top_Expr = ExprStack;
    Top_Val  = ValStack;
    Top_Func = FuncStack;
+   Low_Expr = ExprStack;
+   Low_Val = ValStack;
+   Low_Func = FuncStack;
+
+   /* back to a segment each.  the register stack can't be trimmed
+    * below the system vars.
+    */
+   if ( Top_RegS < RegStack + STACK_SEG - 1 )
+	Lim_RegS = mcTrimStack( RegStack, Lim_RegS );
+   Lim_Expr = mcTrimStack( ExprStack, Lim_Expr );
+   Lim_Val = mcTrimStack( ValStack, Lim_Val );
+   Lim_Func = mcTrimStack( FuncStack, Lim_Func );
+}
+
+/* mcMakeStack() - Returns a new stack of stack_max entries.  With
+	MMAP_ARENA all but its first segment is only reserved.
+*/
+static CONS *mcMakeStack()
+{
+   CONS *stk;
+
+#ifdef MMAP_ARENA
+   if ( (stk = (CONS *)mmap( NULL, (size_t)stack_max * sizeof(CONS), PROT_NONE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 )) == (CONS *)MAP_FAILED ||
+	mprotect( stk, STACK_SEG * sizeof(CONS), PROT_READ | PROT_WRITE ) != 0 ) {
+	FATAL("MICRO ERROR in InitMicro: Can't reserve the stacks; try a smaller --stack-max.");
+   }
+#else
+   if ( (stk = (CONS *)malloc( (size_t)stack_max * sizeof(CONS) )) == NULL ) {
+	FATAL("MICRO ERROR in InitMicro: Can't allocate the stacks; try a smaller --stack-max.");
+   }
+#endif
+
+   return stk;
+}
+
+/* mcGrowStack(stk, lim, msg) - A push onto stack stk found it full up to
+	lim.  Adds a segment and returns the new limit, or it's error msg
+	if the stack has all of --stack-max.
+*/
+static CONS *mcGrowStack(stk, lim, msg)
+CONS *stk, *lim;
+char *msg;
+{
+   long have, add;
+
+   have = lim + 1 - stk;
+   if ( have >= stack_max ) {
+	RT_ERROR(msg);
+   }
+
+   add = stack_max - have < STACK_SEG ? stack_max - have : STACK_SEG;
+
+#ifdef MMAP_ARENA
+   if ( mprotect( lim + 1, (size_t)add * sizeof(CONS), PROT_READ | PROT_WRITE ) != 0 ) {
+	RT_ERROR(msg);
+   }
+#endif
+
+   return lim + add;
+}
+
+/* mcTrimStack(stk, lim) - Gives back every segment of stack stk past its
+	first one, which ends at lim now.  Returns the new limit.
+*/
+static CONS *mcTrimStack(stk, lim)
+CONS *stk, *lim;
+{
+   CONS *keep;
+
+   keep = stk + STACK_SEG - 1;
+   if ( lim <= keep )
+	return lim;
+
+#ifdef MMAP_ARENA
+   /* the pages are gone, not just protected */
+   (void)madvise( keep + 1, (size_t)(lim - keep) * sizeof(CONS), MADV_DONTNEED );
+   (void)mprotect( keep + 1, (size_t)(lim - keep) * sizeof(CONS), PROT_NONE );
+#endif
+
+   return keep;
+}
+
+/* mcRegPush(c) - Hold onto c on the register stack. */
+void mcRegPush(c)
+CONS c;
+{
+   if ( Top_RegS >= Lim_RegS )
+	Lim_RegS = mcGrowStack( RegStack, Lim_RegS, "Register stack overflow." );
+
+   *++Top_RegS = c;
 }
 
 /* mcPushExpr(c) */
 void mcPushExpr(c)
 CONS c;
 {
-   if ( Top_Expr >= &ExprStack[MAX_EXPRSTACK-1] ) {
-	RT_ERROR("Expression stack overflow.");
-   }
+   if ( Top_Expr >= Lim_Expr )
+	Lim_Expr = mcGrowStack( ExprStack, Lim_Expr, "Expression stack overflow." );
 
-   R(++Top_Expr) = c;
+   *++Top_Expr = c;
 }
 
 /* mcPushVal(c) */
 void mcPushVal(c)
 CONS c;
 {
-   if ( Top_Val >= &ValStack[MAX_VALSTACK-1] ) {
-	RT_ERROR("Value stack overflow.");
-   }
+   if ( Top_Val >= Lim_Val )
+	Lim_Val = mcGrowStack( ValStack, Lim_Val, "Value stack overflow." );
 
-   R(++Top_Val) = c;
+   *++Top_Val = c;
 }
 
 /* mcPushFunc(c) */
 void mcPushFunc(c)
 CONS c;
 {
-   if ( Top_Func >= &FuncStack[MAX_FUNCSTACK-1] ) {
-	RT_ERROR("Function stack overflow.");
-   }
+   if ( Top_Func >= Lim_Func )
+	Lim_Func = mcGrowStack( FuncStack, Lim_Func, "Function stack overflow." );
 
-   R(++Top_Func) = c;
+   *++Top_Func = c;
 }
 
 /* mcPopExpr() - Returns and pops the top of the expression stack. */
@@ -207,8 +414,9 @@ CONS mcPopExpr()
 	RT_ERROR("Expression stack underflow.");
    }
 
-   temp = R(Top_Expr);
-   --Top_Expr;
+   temp = *Top_Expr;
+   if ( --Top_Expr < Low_Expr )
+	Low_Expr = Top_Expr;
    return temp;
 }
 
@@ -221,8 +429,9 @@ CONS mcPopVal()
 	RT_ERROR("Value stack underflow.");
    }
 
-   temp = R(Top_Val);
-   --Top_Val;
+   temp = *Top_Val;
+   if ( --Top_Val < Low_Val )
+	Low_Val = Top_Val;
    return temp;
 }
 
@@ -235,8 +444,9 @@ CONS mcPopFunc()
 	RT_ERROR("Function stack underflow.");
    }
 
-   temp = R(Top_Func);
-   --Top_Func;
+   temp = *Top_Func;
+   if ( --Top_Func < Low_Func )
+	Low_Func = Top_Func;
    return temp;
 }
 
@@ -244,54 +454,42 @@ CONS mcPopFunc()
 CONS mcGetExprS()
 {
    CONS *curr;
+   CONS cap;
 
-  {
-   ENTER;
-   REG(cap);
-
-   R(cap) = NIL;
+   cap = NIL;
 
    for ( curr = Top_Expr; curr > ExprStack; --curr )
-	R(cap) = mcCons( R(curr), R(cap) );
+	cap = mcCons( *curr, cap );
 
-   MCLEAVE R(cap);
-  }
+   return cap;
 }
 
 /* mcGetValS() - Captures the value stack. */
 CONS mcGetValS()
 {
    CONS *curr;
+   CONS cap;
 
-  {
-   ENTER;
-   REG(cap);
-
-   R(cap) = NIL;
+   cap = NIL;
 
    for ( curr = Top_Val; curr > ValStack; --curr )
-	R(cap) = mcCons( R(curr), R(cap) );
+	cap = mcCons( *curr, cap );
 
-   MCLEAVE R(cap);
-  }
+   return cap;
 }
 
 /* mcGetFuncS() - Captures the function stack. */
 CONS mcGetFuncS()
 {
    CONS *curr;
+   CONS cap;
 
-  {
-   ENTER;
-   REG(cap);
-
-   R(cap) = NIL;
+   cap = NIL;
 
    for ( curr = Top_Func; curr > FuncStack; --curr )
-	R(cap) = mcCons( R(curr), R(cap) );
+	cap = mcCons( *curr, cap );
 
-   MCLEAVE R(cap);
-  }
+   return cap;
 }
 
 /* mcRestExpr(c) - Restore expression stack c. */
@@ -300,12 +498,12 @@ CONS c;
 {
    CONS head;
 
-   Top_Expr = ExprStack;
+   Top_Expr = Low_Expr = ExprStack;
    while ( !mcNull(c) ) {
 	head = mcCar(c);
 	c = mcCdr(c);
 
-	R(++Top_Expr) = head;
+	mcPushExpr( head );
    }
 }
 
@@ -315,12 +513,12 @@ CONS c;
 {
    CONS head;
 
-   Top_Val = ValStack;
+   Top_Val = Low_Val = ValStack;
    while ( !mcNull(c) ) {
 	head = mcCar(c);
 	c = mcCdr(c);
 
-	R(++Top_Val) = head;
+	mcPushVal( head );
    }
 }
 
@@ -330,12 +528,12 @@ CONS c;
 {
    CONS head;
 
-   Top_Func = FuncStack;
+   Top_Func = Low_Func = FuncStack;
    while ( !mcNull(c) ) {
 	head = mcCar(c);
 	c = mcCdr(c);
 
-	R(++Top_Func) = head;
+	mcPushFunc( head );
    }
 }
 
@@ -346,82 +544,83 @@ CONS c;
 /* mcMkEnv() - Returns a new environment. */
 CONS mcMkEnv()
 {
-   ENTER;
-   REG(env);
+   CONS env;
 
-   R(env) = NewCons( ENVMNT, 0, 0 );
-   mcGet_Nested( R(env) ) = NIL;
-   mcGet_Global( R(env) ) = NewCons( VECTOR, MAX_SYMBOLS, 0 );
+   env = NewCons( ENVMNT, 0, 0 );
+   mcGet_Nested( env ) = NIL;
+   mcGet_Global( env ) = NewCons( VECTOR, INIT_SYMBOLS, 0 );
+   WBarrier( env, mcGet_Global(env) );
 
    /* fill vector with NULL's since this environment doesn't have
     * any bindings yet.
     */
-   mcVectorFill( mcGet_Global(R(env)), NULL );
+   mcVectorFill( mcGet_Global(env), NULL );
 
-   MCLEAVE R(env);
+   return env;
 }
 
 /* ----------------------------------------------------------------------- */
 /*                            Hash Functions				   */
 /* ----------------------------------------------------------------------- */
 
-/* mcHash(s, size) - Returns the hash value of the symbol s.  size is the
-	maximum size of the hash table.
+/* mcHash(s) - Returns the hash value of the symbol s: 32 bit FNV-1a.  Every
+	bit of every character reaches the low bits, so the caller can
+	mask off as many as its table needs.
 */
-int mcHash(s, size)
+unsigned long mcHash(s)
 char *s;
-int size;
 {
-   unsigned int i, h;
+   unsigned long h;
 
-   h = 0;
-   for ( i = 1; *s != EOS; i++, s++)
-	h = h + (i * (*s));
+   h = 2166136261UL;
+   for ( ; *s != EOS; s++ ) {
+	h ^= (unsigned char)*s;
+	h = (h * 16777619UL) & 0xffffffffUL;
+   }
 
-   return ((int)(h % size));
-}
-
-/* mcRehash(s, h) - Rehashes the symbol s.  h is the old hash value.
-	NOTE: s not used at this time, but the algorithm might change and
-	this makes it easier to upgrade.
-*/
-int mcRehash(s, h, size)
-char *s;
-int h, size;
-{
-   return ((h+1) % size);
+   return h;
 }
 
 /* ----------------------------------------------------------------------- */
 /*                       Primitive List Operations			   */
 /* ----------------------------------------------------------------------- */
 
-/* mcIntToCons(i) - Creates and returns a CONS node with the integer i
-	in it.
+/* mcIntToCons(i) - Returns the integer i as a CONS.  Only allocates if
+	i won't fit in a fixnum.
 */
 CONS mcIntToCons(i)
 int i;
 {
    CONS temp;
 
+   if ( mcFixable(i) )
+	return mcMkFix(i);
+
    temp = NewCons( INT, 0, 0 );
    mcCpy_Int(temp, i);
    return temp;
 }
 
-/* mcCharToCons(c) - Creates and returns a CONS node with the character c
-	in it.
-*/
+/* mcCharToCons(c) - Returns the character c as a CONS.  Never allocates. */
 CONS mcCharToCons(c)
 int c;
 {
-   CONS temp;
-
    if ( c == EOF )
 	return EOF_OBJ;
 
-   temp = NewCons( CHAR, 0, 0 );
-   mcCpy_Char(temp, (char)c);
+   return mcMkImm( CHAR, (unsigned char)c );
+}
+
+/* mcFloatToCons(f) - Creates and returns a CONS node with the float f
+	in it.
+*/
+CONS mcFloatToCons(f)
+double f;
+{
+   CONS temp;
+
+   temp = NewCons( FLOAT, 0, 0 );
+   mcCpy_Float(temp, (REAL_NUM)f);
    return temp;
 }
 
@@ -526,22 +725,16 @@ CONS l;
 CONS mcCons(head, tail)
 CONS head, tail;
 {
-   ENTER;
-   REG(h);
-   REG(t);
-   REG(res);
-
-   R(h) = head;
-   R(t) = tail;
+   CONS res;
 
    /* need a cons node */
-   R(res) = NewCons( PAIR, 0, 0 );
+   res = NewCons( PAIR, 0, 0 );
 
    /* build the cons node */
-   mcGet_Car( R(res) ) = R(h);
-   mcGet_Cdr( R(res) ) = R(t);
+   mcGet_Car( res ) = head;
+   mcGet_Cdr( res ) = tail;
 
-   MCLEAVE R(res);
+   return res;
 }
 
 /* mcSetCar(c, h) - Makes h be the car of c.  This is a list-altering
@@ -553,7 +746,9 @@ CONS c, h;
    if ( !mcPair(c) )
 	RT_ERROR("Bad arg to mcSetCar.");
 
+   SBarrier( mcGet_Car(c) );
    mcGet_Car(c) = h;
+   WBarrier(c, h);
    return c;
 }
 
@@ -566,7 +761,9 @@ CONS c, t;
    if ( !mcPair(c) )
 	RT_ERROR("Bad arg to mcSetCdr.");
 
+   SBarrier( mcGet_Cdr(c) );
    mcGet_Cdr(c) = t;
+   WBarrier(c, t);
    return c;
 }
 
@@ -574,26 +771,13 @@ CONS c, t;
 	(a) n1 and n2 are the same cons node
 	(b) n1 and n2 are the same symbol ( 'the eq 'the is true )
 
-	Eq() is undefined for numbers.
+	A symbol is only ever one cons node (see ssIntern()), so (b) is
+	(a).  Eq() is undefined for numbers.
 */
 CONS mcEq(n1, n2)
 CONS n1, n2;
 {
-   /* same object? */
-   if ( n1 == n2 )
-	return T;
-
-   /* same type?  symbol? */
-   if ( mcKind(n1) == mcKind(n2) && mcKind(n1) == SYMBOL ) {
-
-	/* rely's on fact that symbols are stored ONCE, see symbol.c */
-	if ( mcGet_Sym(n1) == mcGet_Sym(n2) )
-		return T;
-	else return F;
-   }
-
-   /* not eq */
-   return F;
+   return n1 == n2 ? T : F;
 }
 
 /* mcEqv(n1, n2) - n1 eqv n2 iff:
@@ -622,7 +806,7 @@ CONS n1, n2;
 
 	/* both the empty string? */
 	if ( mcKind(n1) == STRING )
-		if ( *(mcGet_Str(n1)) == *(mcGet_Str(n2)) && *(mcGet_Str(n1)) == EOS )
+		if ( mcStr_Len(n1) == 0 && mcStr_Len(n2) == 0 )
 			return T;
 
 	/* the same character? */
@@ -800,7 +984,7 @@ CONS s, l;
 	symbol = mcCar(head);
 
 	/* same symbol? */
-	if ( mcGet_Sym(symbol) == mcGet_Sym(s) )
+	if ( symbol == s )
 		return head;
 
 	/* next element */
@@ -938,38 +1122,32 @@ CONS mcVectorLst(v)
 CONS v;
 {
    int e;
+   CONS l;
 
-   {
-    ENTER;
-    REG(l);
-    R(l) = NIL;
-
-    for ( e = mcVect_Size(v)-1; e >= 0; --e )
-	R(l) = mcCons( *mcVect_Ref(v, e), R(l) );
+   l = NIL;
+   for ( e = mcVect_Size(v)-1; e >= 0; --e )
+	l = mcCons( *mcVect_Ref(v, e), l );
 
-    MCLEAVE R(l);
-   }
+   return l;
 }
 
 /* mcVectorCopy(v) - Makes a copy of the vector v. */
 CONS mcVectorCopy(v)
 CONS v;
 {
-   ENTER;
-   REG(old);
-   REG(new);
+   CONS new;
 
-   /* v can't disappear while R(old) is holding onto it */
-   R(old) = v;
-   R(new) = mcMakeVector( mcVect_Size(v), NIL );
+   new = mcMakeVector( mcVect_Size(v), NIL );
    {
 	int e;
 
-	for ( e = 0; e < mcVect_Size(v) ; ++e )
-	   *mcVect_Ref( R(new), e ) = mcTree_Copy( *mcVect_Ref(v, e) );
+	for ( e = 0; e < mcVect_Size(v) ; ++e ) {
+	   *mcVect_Ref( new, e ) = mcTree_Copy( *mcVect_Ref(v, e) );
+	   WBarrier( new, *mcVect_Ref(new, e) );
+	}
    }
 
-   MCLEAVE R(new);
+   return new;
 }
 
 /* mcVectorFill(v, o) - Fills vector v with object o. */
@@ -980,8 +1158,12 @@ CONS v, o;
 
    l = mcVect_Size(v);
 
-   for ( l = mcVect_Size(v)-1; l >= 0; --l )
+   for ( l = mcVect_Size(v)-1; l >= 0; --l ) {
+	SBarrier( *mcVect_Ref(v, l) );
 	*mcVect_Ref(v, l) = o;
+   }
+
+   WBarrier(v, o);
 }
 
 /* ----------------------------------------------------------------------- */
@@ -993,31 +1175,59 @@ CONS mcCopyCons(n)
 CONS n;
 {
    CONS temp, tmp;
+   unsigned char *code = NULL;	/* the copy's own byte-code and constant table */
+   CONS *cnst = NULL;
 
-   /* #NULL and #T are special CONS nodes in that only 1 copy ever exists */
-   if ( mcNull(n) || n == T || n == F || n == EOF_OBJ )
+   /* immediates (#NULL, #T, fixnums, etc) are their own copies, and
+    * so are symbols -- there's only one of each.
+    */
+   if ( mcImm(n) || mcSymbol(n) )
 	return n;
 
    if ( mcKind(n) == VECTOR ) {
 	temp = mcVectorCopy(n);
 	return temp;
    }
+   else if ( mcPair(n) ) {
+	/* a pair is just its car and cdr */
+	temp = NewCons( PAIR, 0, 0 );
+	mcGet_Car(temp) = mcGet_Car(n);
+	mcGet_Cdr(temp) = mcGet_Cdr(n);
+	return temp;
+   }
    else if ( mcKind(n) == BCODES )
 	temp = NewCons( BCODES, mcBC_CSize(n), mcBC_CCSize(n) );
    else
 	temp = NewCons( mcKind(n), 0, 0 );
 
-   tmp = (CONS) memcpy( (char *)temp, (char *)n, (int)sizeof(CONSNODE) );
+   /* the copy is a new node; its generation is in its segment, not in
+    * what gets copied.
+    */
+   if ( mcCode(n) ) {
+	code = mcBC_Code(temp);
+	cnst = mcBC_Const(temp);
+   }
+
+   tmp = (CONS) memcpy( (char *)temp, (char *)n, CellBytes( mcKind(n) ) );
 
    assert( temp == tmp );
 
    if ( mcCode(n) ) {
+	/* the memcpy() took n's; put the copy's back */
+	mcBC_Code(temp) = code;
+	mcBC_Const(temp) = cnst;
+
 	/* copy the byte-code */
 	memcpy( (char *)mcBC_Code(temp), (char *)mcBC_Code(n), (int)mcBC_CSize(n) );
 
 	/* copy the constant table */
 	memcpy( (char *)mcBC_Const(temp), (char *)mcBC_Const(n), (int)(mcBC_CCSize(n)*sizeof(CONS)) );
    }
+   else if ( mcKind(n) == STRING && mcStr_Owner(n) == NULL )
+	/* and its own characters, or both cells would free them.  a
+	 * slice's copy is a slice of the same owner.
+	 */
+	mcSet_Str( temp, ssSubstring( mcGet_Str(n), 0, (int)mcStr_Len(n) - 1 ) );
 
    return temp;
 }
@@ -1028,23 +1238,20 @@ CONS n;
 CONS mcTree_Copy(t)
 CONS t;
 {
-   ENTER;
-   REG(copying);
-   REG(temp);
-
-   if ( t == NIL ) {
-	MCLEAVE NIL;
-   }
+   CONS temp;
 
-   R(copying) = t;
+   if ( t == NIL )
+	return NIL;
 
-   R(temp) = mcCopyCons(t);
-   if ( mcPair( R(temp) ) ) {
-	mcGet_Car( R(temp) ) = mcTree_Copy( mcGet_Car(t) );
-	mcGet_Cdr( R(temp) ) = mcTree_Copy( mcGet_Cdr(t) );
+   temp = mcCopyCons(t);
+   if ( mcPair( temp ) ) {
+	mcGet_Car( temp ) = mcTree_Copy( mcGet_Car(t) );
+	WBarrier( temp, mcGet_Car(temp) );
+	mcGet_Cdr( temp ) = mcTree_Copy( mcGet_Cdr(t) );
+	WBarrier( temp, mcGet_Cdr(temp) );
    }
 
-   MCLEAVE R(temp);
+   return temp;
 }
 
 /* ----------------------------------------------------------------------- */
@@ -1053,37 +1260,352 @@ CONS t;
 
 CONS mcGenSym()
 {
-   static int num = 0;
-   char symbol[15];
-   CONS sym;
-
-   /* create a symbol that hasn't been seen before */
-   sprintf(symbol, "G%d", num);
-   ++num;
-   while ( ssIsSymbol(symbol) ) {
-	sprintf(symbol, "G%d", num);
-	++num;
-   }
+   static long num = 0;
 
-   sym = NewCons( SYMBOL, 0, 0 );
-   mcCpy_Sym(sym, symbol);
-   return sym;
+   /* uninterned, so no other symbol is the same one */
+   return ssGenSym( num++ );
 }
 
-/* mcSubStr(s, beg, end) - Returns an allocated string which is the portion
-	of string s from index beg to index end.
+/* mcSubStr(s, beg, end) - Returns the portion of string s from index beg
+	to index end.  Unless it's short, it's a slice: a cell pointing
+	into the characters of s, which aren't copied.  A rope is flattened
+	first.
+
+	A slice's characters belong to its owner, a string no Scheme code
+	has, so they never change under it.  The first time s is sliced
+	its characters are given to a new owner and s becomes a slice of
+	it too.  mcStrOwn() copies a slice's characters before they're
+	changed.
 */
 CONS mcSubStr(s, beg, end)
-char *s;
+CONS s;
 int beg, end;
 {
-   CONS str;
+   CONS str, own;
+   long len;
+
+   mcStr_Flat( s );
 
+   len = end - beg + 1;
+   if ( len > mcStr_Len(s) - beg )
+	len = mcStr_Len(s) - beg;
+   if ( len < 0 )
+	len = 0;
+
+   /* s's characters are only good as long as s is, so hang on to s
+    * (not a char *) across the allocation.
+    */
+   if ( len < SLICE_MIN ) {
+	str = NewCons( STRING, 0, 0 );
+	mcSet_Str( str, ssSubstring( mcGet_Str(s), beg, beg + (int)len - 1 ) );
+	return str;
+   }
+
+   own = str_owner( s );
    str = NewCons( STRING, 0, 0 );
-   mcCpy_Str( str, ssSubstring( s, beg, end ) );
+   mcGet_Str(str) = mcGet_Str(s) + beg;
+   mcStr_Len(str) = (int)len;
+   mcStr_Owner(str) = own;
    return str;
 }
 
+/* str_owner(s) - Returns the owner of the characters of s, which isn't a
+	rope.  If they haven't one they're given one.
+*/
+static CONS str_owner(s)
+CONS s;
+{
+   CONS own;
+
+   if ( mcStr_Owner(s) == NULL ) {
+	own = NewCons( STRING, 0, 0 );
+	own->data.str = s->data.str;
+	mcStr_Owner(s) = own;
+	WBarrier( s, own );
+   }
+
+   return mcStr_Owner(s);
+}
+
+/* mcStrOwn(s) - Gives the slice or rope s characters of its own, so they
+	can be changed.  Any other string has them already.
+*/
+void mcStrOwn(s)
+CONS s;
+{
+   char *new;
+
+   if ( mcRope(s) ) {
+	mcFlatten( s );
+	return;
+   }
+
+   if ( mcStr_Owner(s) == NULL )
+	return;
+
+   new = NewStr( mcStr_Len(s) );
+   memcpy( new, mcGet_Str(s), (size_t)mcStr_Len(s) );
+   SBarrier( mcStr_Owner(s) );
+   mcSet_Str( s, new );
+}
+
+/* mcCStr(s) - Returns the characters of string s EOS terminated, for C.
+	A rope, or a slice that stops short of its owner's end, is given
+	characters of its own first.
+*/
+char *mcCStr(s)
+CONS s;
+{
+   if ( mcRope(s) || mcGet_Str(s)[mcStr_Len(s)] != EOS )
+	mcStrOwn( s );
+   return mcGet_Str(s);
+}
+
+/* mcStrCmp(s1, s2) - Compares strings s1 and s2 like strcmp(). */
+int mcStrCmp(s1, s2)
+CONS s1, s2;
+{
+   long n;
+   int c;
+
+   mcStr_Flat( s1 );
+   mcStr_Flat( s2 );
+
+   n = mcStr_Len(s1) < mcStr_Len(s2) ? mcStr_Len(s1) : mcStr_Len(s2);
+   if ( (c = memcmp( mcGet_Str(s1), mcGet_Str(s2), (size_t)n )) != 0 )
+	return c;
+   return mcStr_Len(s1) < mcStr_Len(s2) ? -1 : mcStr_Len(s1) > mcStr_Len(s2);
+}
+
+/* mcStrIndex(s, c, beg) - Returns the index of the first character c in
+	string s at or after index beg, or -1 if there isn't one.
+*/
+int mcStrIndex(s, c, beg)
+CONS s;
+int c, beg;
+{
+   long i;
+
+   mcStr_Flat( s );
+
+   if ( beg < 0 || beg >= mcStr_Len(s) )
+	return -1;
+
+   i = ssMemChr( mcGet_Str(s) + beg, (long)(mcStr_Len(s) - beg), c );
+   return i < 0 ? -1 : beg + (int)i;
+}
+
+/* mcStrSearch(p, s, beg) - Returns the index of the first occurrence of
+	string p in string s at or after index beg, or -1 if there isn't
+	one.
+*/
+int mcStrSearch(p, s, beg)
+CONS p, s;
+int beg;
+{
+   long i;
+
+   mcStr_Flat( p );
+   mcStr_Flat( s );
+
+   if ( beg < 0 || beg > mcStr_Len(s) )
+	return -1;
+
+   i = ssMemMem( mcGet_Str(s) + beg, (long)(mcStr_Len(s) - beg),
+			mcGet_Str(p), (long)mcStr_Len(p) );
+   return i < 0 ? -1 : beg + (int)i;
+}
+
+/* mcStrPrefix(p, s) - Returns TRUE if string p is a prefix of string s. */
+BOOL mcStrPrefix(p, s)
+CONS p, s;
+{
+   if ( mcStr_Len(p) > mcStr_Len(s) )
+	return FALSE;
+
+   mcStr_Flat( p );
+   mcStr_Flat( s );
+   return memcmp( mcGet_Str(s), mcGet_Str(p), (size_t)mcStr_Len(p) ) == 0;
+}
+
+/* mcStrSuffix(p, s) - Returns TRUE if string p is a suffix of string s. */
+BOOL mcStrSuffix(p, s)
+CONS p, s;
+{
+   if ( mcStr_Len(p) > mcStr_Len(s) )
+	return FALSE;
+
+   mcStr_Flat( p );
+   mcStr_Flat( s );
+   return memcmp( mcGet_Str(s) + mcStr_Len(s) - mcStr_Len(p), mcGet_Str(p),
+			(size_t)mcStr_Len(p) ) == 0;
+}
+
+/* mcStrSplit(s, c) - Returns the list of the pieces of string s between
+	the characters c, empty ones included.  Long pieces are slices of
+	s (see mcSubStr()).
+*/
+CONS mcStrSplit(s, c)
+CONS s;
+int c;
+{
+   CONS head, tail, elem;
+   int beg, end;
+
+   head = tail = NIL;
+   beg = 0;
+   do {
+	if ( (end = mcStrIndex( s, c, beg )) < 0 )
+		end = mcStr_Len(s);
+
+	elem = mcCons( mcSubStr( s, beg, end - 1 ), NIL );
+	if ( head == NIL )
+		head = elem;
+	else mcSetCdr( tail, elem );
+	tail = elem;
+
+	beg = end + 1;
+   } while ( end < mcStr_Len(s) );
+
+   return head;
+}
+
+/* ----------------------------------------------------------------------- */
+/*                                Ropes					   */
+/* ----------------------------------------------------------------------- */
+
+/* A string made by mcStrApp() that's ROPE_MIN characters or more is a
+	rope: a cell with no characters, just a left and a right half.  The
+	halves are strings no Scheme code has, so they never change, and
+	appending to a rope copies a path down it, not its characters.  The
+	pieces at the bottom -- strings with characters -- are merged up
+	to ROPE_LEAF characters, so building a string a few characters at
+	a time doesn't make a piece per append.
+
+	A rope is kept balanced like an AVL tree: the depths of a rope's
+	halves differ by one at most, so it's no deeper than 1.44 log2 of
+	its pieces.
+
+	A rope is flattened -- given characters of its own, its halves let
+	go -- the first time its characters are needed (mcStr_Flat()).
+	The length doesn't need them, and mcEmit() writes a rope a piece at
+	a time.
+*/
+
+/* rope_part(s) - Returns a string with the characters of s for a rope to
+	hold: s's owner if s has all its characters, else a copy of the
+	cell.
+*/
+static CONS rope_part(s)
+CONS s;
+{
+   CONS own, p;
+
+   if ( !mcRope(s) ) {
+	own = str_owner( s );
+	if ( mcGet_Str(s) == mcGet_Str(own) && mcStr_Len(s) == mcStr_Len(own) )
+		return own;
+   }
+
+   p = NewCons( STRING, 0, 0 );
+   p->data.str = s->data.str;
+   return p;
+}
+
+/* rope_node(l, r) - Returns the rope whose halves are l and r. */
+static CONS rope_node(l, r)
+CONS l, r;
+{
+   CONS n;
+
+   n = NewCons( STRING, 0, 0 );
+   mcStr_Len(n) = mcStr_Len(l) + mcStr_Len(r);
+   mcRope_Depth(n) = 1 + (mcRope_Depth(l) > mcRope_Depth(r) ? mcRope_Depth(l) : mcRope_Depth(r));
+   mcRope_Left(n) = l;
+   mcRope_Right(n) = r;
+   return n;
+}
+
+/* rope_bal(l, r) - Returns l and r appended, balanced.  Their depths may
+	differ by two; it takes one rotation, or two, to fix that.
+*/
+static CONS rope_bal(l, r)
+CONS l, r;
+{
+   CONS m;
+
+   if ( mcRope_Depth(l) > mcRope_Depth(r) + 1 ) {
+	m = mcRope_Right(l);
+	if ( mcRope_Depth(mcRope_Left(l)) >= mcRope_Depth(m) )
+		return rope_node( mcRope_Left(l), rope_node( m, r ) );
+	return rope_node( rope_node( mcRope_Left(l), mcRope_Left(m) ),
+			  rope_node( mcRope_Right(m), r ) );
+   }
+
+   if ( mcRope_Depth(r) > mcRope_Depth(l) + 1 ) {
+	m = mcRope_Left(r);
+	if ( mcRope_Depth(mcRope_Right(r)) >= mcRope_Depth(m) )
+		return rope_node( rope_node( l, m ), mcRope_Right(r) );
+	return rope_node( rope_node( l, mcRope_Left(m) ),
+			  rope_node( mcRope_Right(m), mcRope_Right(r) ) );
+   }
+
+   return rope_node( l, r );
+}
+
+/* rope_join(l, r) - Returns the rope parts l and r appended.  The taller
+	one is descended until they're of a depth; a short piece goes all
+	the way down the right, to be merged with the last piece.
+*/
+static CONS rope_join(l, r)
+CONS l, r;
+{
+   CONS str;
+
+   if ( mcRope_Depth(l) > mcRope_Depth(r) + 1 ||
+	(mcRope(l) && !mcRope(r) && mcStr_Len(r) < ROPE_LEAF) )
+	return rope_bal( mcRope_Left(l), rope_join( mcRope_Right(l), r ) );
+
+   if ( mcRope_Depth(r) > mcRope_Depth(l) + 1 )
+	return rope_bal( rope_join( l, mcRope_Left(r) ), mcRope_Right(r) );
+
+   if ( !mcRope(l) && !mcRope(r) && mcStr_Len(l) + mcStr_Len(r) <= ROPE_LEAF ) {
+	str = NewCons( STRING, 0, 0 );
+	mcSet_Str( str, ssAppend( mcGet_Str(l), mcStr_Len(l), mcGet_Str(r), mcStr_Len(r) ) );
+	return str;
+   }
+
+   return rope_node( l, r );
+}
+
+/* rope_copy(s, to) - Copies the characters of s to to.  Returns the end of
+	them.
+*/
+static char *rope_copy(s, to)
+CONS s;
+char *to;
+{
+   if ( !mcRope(s) ) {
+	memcpy( to, mcGet_Str(s), (size_t)mcStr_Len(s) );
+	return to + mcStr_Len(s);
+   }
+
+   return rope_copy( mcRope_Right(s), rope_copy( mcRope_Left(s), to ) );
+}
+
+/* mcFlatten(s) - Gives the rope s characters of its own. */
+void mcFlatten(s)
+CONS s;
+{
+   char *new;
+
+   new = NewStr( mcStr_Len(s) );
+   (void)rope_copy( s, new );
+   SBarrier( mcRope_Left(s) );
+   SBarrier( mcRope_Right(s) );
+   mcSet_Str( s, new );
+}
+
 /* mcSymStr(s) - Given a CONS node with a symbol in it, returns a CONS
 	node with a newly allocated string in it that is a copy of the
 	symbol.
@@ -1094,7 +1616,7 @@ CONS s;
    CONS str;
 
    str = NewCons( STRING, 0, 0 );
-   mcCpy_Str( str, ssAddString( mcGet_Sym(s) ) );
+   mcCpy_Str( str, mcGet_Sym(s) );
    return str;
 }
 
@@ -1104,23 +1626,27 @@ CONS s;
 CONS mcStrSym(s)
 CONS s;
 {
-   CONS sym;
-
-   sym = NewCons( SYMBOL, 0, 0 );
-   mcCpy_Sym( sym, mcGet_Str(s) );
-   return sym;
+   return ssIntern( mcCStr(s) );
 }
 
 /* mcStrApp(s1, s2) - Returns a CONS node with a string which is formed
-	from appending s1 and s2.
+	from appending s1 and s2.  Unless it's short it's a rope, and
+	neither is copied.
 */
 CONS mcStrApp(s1, s2)
-char *s1, *s2;
+CONS s1, s2;
 {
    CONS app;
 
+   if ( mcStr_Len(s1) + mcStr_Len(s2) >= ROPE_MIN &&
+	mcStr_Len(s1) > 0 && mcStr_Len(s2) > 0 )
+	return rope_join( rope_part(s1), rope_part(s2) );
+
+   mcStr_Flat( s1 );
+   mcStr_Flat( s2 );
    app = NewCons( STRING, 0, 0 );
-   mcCpy_Str(app, ssAppend(s1, s2));
+   mcSet_Str( app, ssAppend( mcGet_Str(s1), mcStr_Len(s1),
+				mcGet_Str(s2), mcStr_Len(s2) ) );
    return app;
 }
 
@@ -1128,52 +1654,42 @@ char *s1, *s2;
 CONS mcLstStr(l)
 CONS l;
 {
-   CONS ch, str;
-
-   str = NewCons( STRING, 0, 0 );
-   mcGet_Str(str) = STRING_SPACE;
+   CONS ch, str, p;
+   char *s;
+   int len;
 
-   for ( ; !mcNull(l) && Sleft > 0; ++STRING_SPACE, --Sleft ) {
-	if ( !mcChar( (ch = mcCar(l)) ) )
+   /* check the characters and count them first */
+   for ( len = 0, p = l; !mcNull(p); p = mcCdr(p), ++len )
+	if ( !mcChar( (ch = mcCar(p)) ) )
 		RT_LERROR("LIST->STRING: Atom must be a character: ", ch );
 
-	*STRING_SPACE = mcGet_Char(ch);
-	l = mcCdr(l);
-   }
-   *STRING_SPACE++ = EOS; Sleft --;
+   str = NewCons( STRING, 0, 0 );
+   mcSet_Str( str, NewStr( len ) );
+
+   for ( s = mcGet_Str(str); !mcNull(l); l = mcCdr(l) )
+	*s++ = mcGet_Char( mcCar(l) );
 
    return str;
 }
 
 /* mcStrLst(s) - Returns the list of characters which make up string s. */
 CONS mcStrLst(s)
-char *s;
+CONS s;
 {
-   char *start;
+   long i;
+   CONS lst;
 
-   {
-   ENTER;
-   REG(lst);
-   REG(ch);
-
-   R(lst) = NIL;
-
-   /* find the end of the string */
-   for ( start = s; *start != EOS; ++start )
-	;
+   lst = NIL;
 
-   /* working backwards, copy the characters into a cons node and
-    * mcCons() this node into the list of characters.
+   /* working backwards, mcCons() the characters into the list of
+    * characters.  s is looked at each time around, so it's held on
+    * to while its characters are.
     */
-   for ( --start; start >= s; --start ) {
-	R(ch) = NewCons( CHAR, 0, 0 );
-	mcCpy_Char( R(ch), *start);
+   mcStr_Flat( s );
+   for ( i = mcStr_Len(s) - 1; i >= 0; --i )
+	lst = mcCons( mcCharToCons( (unsigned char)mcGet_Str(s)[i] ), lst );
 
-	R(lst) = mcCons( R(ch), R(lst) );
-   }
-
-   MCLEAVE( R(lst) );
-   }
+   return( lst );
 }
 
 #ifdef NoMemcpy
@@ -1,25 +1,28 @@
 /* microcode.h */
 
-#define MAX_REGSTACK		1500
-#define MAX_EXPRSTACK		1500
-#define MAX_VALSTACK		1500
-#define MAX_FUNCSTACK		1500
+/* the stacks grow STACK_SEG entries at a time up to --stack-max bytes
+	each, STACK_MAX if it isn't given (see notes in micro.c).
+*/
+#define STACK_SEG		4096
+#define STACK_MAX		(32L * 1024L * 1024L)
 
 /* globals */
-extern CONS RegStack[];
-extern CONS ExprStack[];		/* the expression stack */
-extern CONS ValStack[];			/* the value stack */
-extern CONS FuncStack[];		/* the function stack */
+extern CONS *RegStack;
+extern CONS *ExprStack;			/* the expression stack */
+extern CONS *ValStack;			/* the value stack */
+extern CONS *FuncStack;			/* the function stack */
 extern CONS *Top_RegS;			/* top of reg stack */
 extern CONS *Top_Expr;			/* top expr on expr stack */
 extern CONS *Top_Val;			/* top val on val stack */
 extern CONS *Top_Func;			/* top func on func stack */
+extern CONS *Low_Expr, *Low_Val, *Low_Func;	/* lowest tops since the last minor GC */
 
 /* prototypes */
-void InitMicro( C_VOID );
+void InitMicro( C_INT X C_CHAR C_PTR C_PTR );
 
 /* stack operations */
 void mcClearStacks( C_VOID );
+void mcRegPush( C_CONS );
 void mcPushExpr( C_CONS );
 void mcPushVal( C_CONS );
 void mcPushFunc( C_CONS );
@@ -39,8 +42,7 @@ int mcDumpEnv( C_FILE C_PTR );
 int mcRestEnv( C_FILE C_PTR );
 
 /* hashing functions */
-int mcHash( C_CHAR C_PTR X C_INT );
-int mcRehash( C_CHAR C_PTR X C_INT X C_INT );
+unsigned long mcHash( C_CHAR C_PTR );
 
 /* control functions */
 CONS mcProcedure( C_CONS );
@@ -48,6 +50,7 @@ CONS mcProcedure( C_CONS );
 /* primitive list operations */
 CONS mcIntToCons( C_INT );
 CONS mcCharToCons( C_INT );
+CONS mcFloatToCons( C_REAL );
 CONS mcCadr( C_CONS );
 CONS mcCaadr( C_CONS );
 CONS mcCaddr( C_CONS );
@@ -92,8 +95,14 @@ void mcVectorFill( C_CONS X C_CONS );
 /* microcode i/o ops */
 CONS mcOpen( C_CHAR C_PTR X C_CHAR C_PTR );
 void mcClose( C_CONS );
-CONS mcRead( C_FILE C_PTR );
-void mcEmit( C_CONS X C_FILE C_PTR X C_INT );
+CONS mcOpenInStr( C_CONS );
+CONS mcOpenOutStr( C_VOID );
+CONS mcOutStr( C_CONS );
+int mcGetChar( C_CONS );
+void mcUngetChar( C_CONS X C_INT );
+void mcPutStr( C_CONS X C_CHAR C_PTR X C_INT );
+CONS mcRead( C_CONS );
+void mcEmit( C_CONS X C_CONS X C_INT );
 int mcLoad( C_CHAR C_PTR );
 int mcResLoad( C_CONS );
 
@@ -118,34 +127,82 @@ CONS mcMin( C_VOID );
 
 CONS mcGenSym( C_VOID );
 
+/* substrings shorter than this are copied, not sliced */
+#define SLICE_MIN	32
+
+/* appends shorter than this are copied, not made ropes.  a rope's
+	pieces are merged up to ROPE_LEAF characters.
+*/
+#define ROPE_MIN	256
+#define ROPE_LEAF	256
+
+/* a string output port's first buffer; it doubles as it fills */
+#define PORT_BUF	64
+
 /* string prototypes */
-CONS mcSubStr( C_CHAR C_PTR X C_INT X C_INT );
+CONS mcSubStr( C_CONS X C_INT X C_INT );
+void mcStrOwn( C_CONS );
+void mcFlatten( C_CONS );
+char *mcCStr( C_CONS );
+int mcStrCmp( C_CONS X C_CONS );
+int mcStrIndex( C_CONS X C_INT X C_INT );
+int mcStrSearch( C_CONS X C_CONS X C_INT );
+BOOL mcStrPrefix( C_CONS X C_CONS );
+BOOL mcStrSuffix( C_CONS X C_CONS );
+CONS mcStrSplit( C_CONS X C_INT );
 CONS mcSymStr( C_CONS );
 CONS mcStrSym( C_CONS );
-CONS mcStrApp( C_CHAR C_PTR X C_CHAR C_PTR );
-CONS mcStrLst( C_CHAR C_PTR );
+CONS mcStrApp( C_CONS X C_CONS );
+CONS mcStrLst( C_CONS );
 CONS mcLstStr( C_CONS );
 
 /* Stack macros */
-#define mcRegPush(x)	( R(++Top_RegS) = (x))
 #define mcHaveExprs()	( Top_Expr > ExprStack )
 #define mcHaveVals()	( Top_Val > ValStack )
-#define mcExprStackTop()	( Top_Expr > ExprStack ? R(Top_Expr) : NIL )
-#define mcValStackTop()		( Top_Val > ValStack ? R(Top_Val) : NIL )
-
-/* MM macros */
-#define ENTER		CONS *Old_Top = Top_RegS
-#define REG(x)		CONS *x = (mcRegPush( NIL ), Top_RegS)
-#define R(x)		(*(x))
-#define MCLEAVE		Top_RegS = Old_Top; return
-#define OPVOIDLEAVE	Top_RegS = Old_Top; return
-#define OPLEAVE(x)	Top_RegS = Old_Top; mcPushVal( (x) ); return
+#define mcExprStackTop()	( Top_Expr > ExprStack ? *Top_Expr : NIL )
+#define mcValStackTop()		( Top_Val > ValStack ? *Top_Val : NIL )
+
+/* must precede a store into the value stack at p below its top, or a
+	minor GC won't look there (see notes in memory.c).
+*/
+#define mcTouchVal(p)	( (p) <= Low_Val ? (void)(Low_Val = (p) - 1) : (void)0 )
+
+/* immediates -- see notes in micro.c.  a CONS with either of its low two
+	bits set isn't a pointer.  bit 0 set: a fixnum, the rest of the
+	bits are the integer.  low bits 10: bits 2-7 are the cell type
+	and the bits above those are the data (a character).
+*/
+#define mcImm(p)	( ((PTR_INT)(p) & 3) != 0 )
+#define mcFix(p)	( ((PTR_INT)(p) & 1) != 0 )
+#define mcImmKind(p)	( mcFix(p) ? INT : (int)(((PTR_INT)(p) >> 2) & 0x3f) )
+#define mcImmData(p)	( (PTR_INT)(p) >> 8 )
+#define mcMkImm(k, d)	( (CONS)(((PTR_INT)(d) << 8) | ((PTR_INT)(k) << 2) | 2) )
+#define mcMkFix(i)	( (CONS)(((PTR_INT)(long)(i) << 1) | 1) )
+#define mcFixVal(p)	( (int)((long)(PTR_INT)(p) >> 1) )
+
+/* can the integer i be a fixnum? */
+#define FIX_MAX		( (long)(~(PTR_INT)0 >> 2) )
+#define mcFixable(i)	( (long)(i) <= FIX_MAX && (long)(i) >= -FIX_MAX - 1 )
+
+/* pairs -- see notes in memory.c.  a pair is a bare car and cdr with
+	no cell type; its CONS is its address plus PAIR_TAG.
+*/
+#define PAIR_TAG	4
+#define mcPairOf(p)	((struct Pair *)((char *)(p) - PAIR_TAG))
+#define mcPair(p)	( ((PTR_INT)(p) & 7) == PAIR_TAG )
 
 /* macros to manipulate a CONS node */
-#define mcKind(p)	((p) -> cell_type)
+#define mcKind(p)	( ((PTR_INT)(p) & 7) == 0 ? (p) -> cell_type : mcPair(p) ? PAIR : mcImmKind(p) )
+#define mcSetKind(p, k)	((p) -> cell_type = (k))	/* cells only, not pairs */
+
+/* is p a cell of type k?  is p an immediate of type k (not INT)?  cheaper
+	than mcKind() when the type can only be one or the other.
+*/
+#define mcIsCell(p, k)	( ((PTR_INT)(p) & 7) == 0 && (p) -> cell_type == (k) )
+#define mcIsImm(p, k)	( ((PTR_INT)(p) & 0xff) == (((PTR_INT)(k) << 2) | 2) )
 
-#define mcGet_Car(p)	((p) -> data.cons_node.car)	/* the car's cons node */
-#define mcGet_Cdr(p)	((p) -> data.cons_node.cdr)	/* the cdr's cons node */
+#define mcGet_Car(p)	(mcPairOf(p) -> car)	/* the car's cons node */
+#define mcGet_Cdr(p)	(mcPairOf(p) -> cdr)	/* the cdr's cons node */
 
 /* macros for handling funcs */
 #define mcPrim_Name(n)	((n) -> data.func.name)
@@ -159,6 +216,7 @@ CONS mcLstStr( C_CONS );
 #define mcBC_Const(n)	( (n)->data.bcode.const_table )
 #define mcBC_CSize(n)	( (n)->data.bcode.lcode )
 #define mcBC_CCSize(n)	( (n)->data.bcode.lconst )
+#define mcBC_Gen(n)	( (n)->data.bcode.gen )
 
 /* macros for execution points */
 #define mcExe_BC(n)	( (n)->data.exepnt.bcode )
@@ -169,6 +227,7 @@ CONS mcLstStr( C_CONS );
 #define mcCl_Env(n)	( (n)->data.closure.env )
 #define mcCl_Parms(n)	( (n)->data.closure.parms )
 #define mcCl_Body(n)	( (n)->data.closure.body )
+#define mcCl_Code(n)	( (n)->data.closure.code )
 
 /* macros for user-defined special forms */
 #define mcForm_Parms(n)	( (n)->data.closure.parms )
@@ -183,55 +242,91 @@ CONS mcLstStr( C_CONS );
 #define mcVect_Size(n)	( (n)->data.vector.size )
 #define mcVect_Ref(n,r)	( ((n)->data.vector.elems+(r)) )
 
+/* macros for frames -- a nested env is a chain of frames.  a frame is a
+	VECTOR: the frame it's nested in, the parameter list it binds,
+	and the values of the parameters in order.
+*/
+#define FRAME_HEAD	2
+#define mcFrame_Up(f)		( *mcVect_Ref((f), 0) )
+#define mcFrame_Parms(f)	( *mcVect_Ref((f), 1) )
+#define mcFrame_Ref(f,i)	( mcVect_Ref((f), (i) + FRAME_HEAD) )
+
+/* macros for the expansion cache -- a VECTOR of EXP_SLOTS entries: the
+	source form, its car and cdr when it was expanded, and the
+	expansion.  A form can be in either entry of a pair.
+*/
+#define EXP_SLOTS	1024
+#define EXP_WIDTH	4
+#define mcExp_Ref(c,i,f)	( mcVect_Ref((c), (i) * EXP_WIDTH + (f)) )
+
+/* macros for the macro table -- a VECTOR of MAC_BUCKETS a-lists of the
+	( MACRO-NAME . EXPANDER-FUNCTION ) pairs of *EXPANSION-TABLE*,
+	hashed by symbol #.
+*/
+#define MAC_BUCKETS	64
+#define mcMac_Bucket(t,s)	( mcVect_Ref((t), mcSym_No(s) & (MAC_BUCKETS-1)) )
+
 /* macros for environments */
 #define mcGet_Global(e)	( (e)->data.env.global )
 #define mcGet_Nested(e)	( (e)->data.env.nested )
 
 /* macros for other Scheme data-types */
-#define mcCpy_Sym(p, s)	( ((p) -> data.int_data) = ssAddSymbol(s) )  /* put symbol in node */
-#define mcCpy_Str(p, s) ( ((p) -> data.string) = ssAddString(s) )  /* put string in node */
-#define mcCpy_Char(p, c)  ( ((p) -> data.character) = c )	  /* put character in node */
-#define mcCpy_Int(p, i)   ((p) -> data.int_data = i)	/* put INT in atom node */
+#define mcCpy_Str(p, s) mcSet_Str( p, ssAddString(s) )	/* put string in node */
+#define mcSet_Str(p, s) ( mcGet_Str(p) = (s), mcStr_Len(p) = *((long *)mcGet_Str(p) - 1), \
+			  mcStr_Owner(p) = mcRope_Right(p) = NULL, \
+			  mcRope_Depth(p) = 0 )		/* give node a NewStr() */
+#define mcCpy_Int(p, i)   ((p) -> data.int_data = i)	/* put INT in a cell */
 #define mcCpy_Float(p, f) ((p) -> data.float_data = f)	/* put FLOAT in atom node */
 #define mcCpy_Port(c, p)  ((c) -> data.port.fp = p)	/* put FILE handle in atom node */
 #define mcCpy_PortType(c, t)  ((c) -> data.port.type = t )	  /* put port type in node */
 
-#define mcGet_Sym(p)	( SymTable[(p)->data.int_data] )	/* returns the symbol */
-#define mcGet_Str(p)	((p) -> data.string)		/* returns the string */
-#define mcGet_Char(p)	((p) -> data.character)		/* returns the char */
-#define mcGet_Int(p)	((p) -> data.int_data)		/* returns the integer */
+#define mcGet_Sym(p)	( SymTable[mcSym_No(p)] )	/* returns the symbol */
+#define mcSym_No(p)	((p) -> data.int_data)		/* the symbol's # */
+#define mcSym_Macro(p)	( SymMacro[mcSym_No(p)] )	/* may it be a macro? */
+#define mcGet_Str(p)	((p) -> data.str.chars)		/* returns the string */
+#define mcStr_Len(p)	((p) -> data.str.len)		/* returns its length */
+#define mcStr_Owner(p)	((p) -> data.str.owner)		/* NULL if it's not a slice */
+#define mcRope(p)	( mcGet_Str(p) == NULL )	/* is the string a rope? */
+#define mcRope_Left(p)	((p) -> data.str.owner)		/* a rope's halves */
+#define mcRope_Right(p)	((p) -> data.str.right)
+#define mcRope_Depth(p)	((p) -> data.str.depth)
+#define mcStr_Flat(p)	( mcRope(p) ? mcFlatten(p) : (void)0 )	/* give a rope its characters */
+#define mcGet_Char(p)	( (char)mcImmData(p) )		/* returns the char */
+#define mcGet_Int(p)	( mcFix(p) ? mcFixVal(p) : (p) -> data.int_data )	/* returns the integer */
 #define mcGet_Float(p)	((p) -> data.float_data)	/* returns float */
 #define mcGet_Port(p)	((p) -> data.port.fp)		/* returns the FILE * */
 #define mcGet_PortType(p)  ((p) -> data.port.type)	/* returns the port's type */
+#define mcStrPort(p)	( mcGet_Port(p) == NULL )	/* a string port? */
+#define mcPort_Str(p)	((p) -> data.port.str)		/* a string port's chars */
+#define mcPort_Pos(p)	((p) -> data.port.pos)		/* ... and where it is in them */
 #define mcGet_Vector(p)	((p)-> data.vector.elems )	/* returns the base of the array */
 
 /* predicate macros used by the system */
-#define mcCode(n)	( mcKind((n)) == BCODES )
-#define mcClosure(n)	( mcKind((n)) == CLOSURE )
-#define mcUserForm(n)	( mcKind((n)) == FORM )
-#define mcExe(n)	( mcKind((n)) == EXEPOINT )
-#define mcFunc(n)	( mcKind((n)) == CFUNC )
-#define mcForm(n)	( mcKind((n)) == CFORM )
-#define mcFunc(n)	( mcKind((n)) == CFUNC )
-#define mcCont(n)	( mcKind((n)) == CONT )
-#define mcVector(n)	( mcKind((n)) == VECTOR )
-#define mcEnvironment(n)	( mcKind((n)) == ENVMNT )
-#define mcResume(n)	( mcKind((n)) == RESUME )
+#define mcCode(n)	( mcIsCell((n), BCODES) )
+#define mcClosure(n)	( mcIsCell((n), CLOSURE) )
+#define mcUserForm(n)	( mcIsCell((n), FORM) )
+#define mcExe(n)	( mcIsCell((n), EXEPOINT) )
+#define mcFunc(n)	( mcIsCell((n), CFUNC) )
+#define mcForm(n)	( mcIsCell((n), CFORM) )
+#define mcFunc(n)	( mcIsCell((n), CFUNC) )
+#define mcCont(n)	( mcIsCell((n), CONT) )
+#define mcVector(n)	( mcIsCell((n), VECTOR) )
+#define mcEnvironment(n)	( mcIsCell((n), ENVMNT) )
+#define mcResume(n)	( mcIsCell((n), RESUME) )
 
 /* predicate macros used by users */
 #define mcNull(l)	( (l) == NIL )
-#define mcPair(p)	( mcKind((p)) == PAIR )
 #define mcAtom(p)	( !mcPair(p) )
-#define mcSymbol(p)	( mcKind((p)) == SYMBOL )
-#define mcString(p)	( mcKind((p)) == STRING )
-#define mcChar(p)	( mcKind((p)) == CHAR )
-#define mcNumber(p)	( mcKind((p)) == INT || mcKind((p)) == FLOAT )
-#define mcInteger(p)	( mcKind((p)) == INT )
-#define mcFloat(p)	( mcKind((p)) == FLOAT )
-#define mcPort(p)	( mcKind((p)) == PORT )
-#define mcInPort(p)	( mcKind((p)) == PORT && mcGet_PortType((p)) == INPUT )
-#define mcOutPort(p)	( mcKind((p)) == PORT && mcGet_PortType((p)) == OUTPUT )
-#define mcClosedPort(p) ( mcKind((p)) == PORT && mcGet_PortType((p)) == CLOSED )
+#define mcSymbol(p)	( mcIsCell((p), SYMBOL) )
+#define mcString(p)	( mcIsCell((p), STRING) )
+#define mcChar(p)	( mcIsImm((p), CHAR) )
+#define mcNumber(p)	( mcInteger((p)) || mcFloat((p)) )
+#define mcInteger(p)	( mcFix((p)) || mcIsCell((p), INT) )
+#define mcFloat(p)	( mcIsCell((p), FLOAT) )
+#define mcPort(p)	( mcIsCell((p), PORT) )
+#define mcInPort(p)	( mcPort((p)) && mcGet_PortType((p)) == INPUT )
+#define mcOutPort(p)	( mcPort((p)) && mcGet_PortType((p)) == OUTPUT )
+#define mcClosedPort(p) ( mcPort((p)) && mcGet_PortType((p)) == CLOSED )
 
 #define mcZero(p)	( (mcInteger((p)) && mcGet_Int((p)) == 0) ||\
 			  (mcFloat((p)) && mcGet_Float((p)) == 0.0) )
@@ -242,11 +337,11 @@ CONS mcLstStr( C_CONS );
 #define mcCharLE(p1, p2) ( mcKind(p1) == mcKind(p2) && mcKind(p1) == CHAR && mcGet_Char(p1) <= mcGet_Char(p2) )
 #define mcCharGE(p1, p2) ( mcKind(p1) == mcKind(p2) && mcKind(p1) == CHAR && mcGet_Char(p1) >= mcGet_Char(p2) )
 
-#define mcStrE(p1, p2) ( mcKind(p1) == mcKind(p2) && mcKind(p1) == STRING && strcmp( mcGet_Str(p1), mcGet_Str(p2) ) == 0 )
-#define mcStrL(p1, p2) ( mcKind(p1) == mcKind(p2) && mcKind(p1) == STRING && strcmp( mcGet_Str(p1), mcGet_Str(p2) ) < 0 )
-#define mcStrG(p1, p2) ( mcKind(p1) == mcKind(p2) && mcKind(p1) == STRING && strcmp( mcGet_Str(p1), mcGet_Str(p2) ) > 0 )
-#define mcStrLE(p1, p2) ( mcKind(p1) == mcKind(p2) && mcKind(p1) == STRING && strcmp( mcGet_Str(p1), mcGet_Str(p2) ) <= 0 )
-#define mcStrGE(p1, p2) ( mcKind(p1) == mcKind(p2) && mcKind(p1) == STRING && strcmp( mcGet_Str(p1), mcGet_Str(p2) ) >= 0 )
+#define mcStrE(p1, p2) ( mcKind(p1) == mcKind(p2) && mcKind(p1) == STRING && mcStr_Len(p1) == mcStr_Len(p2) && mcStrCmp( p1, p2 ) == 0 )
+#define mcStrL(p1, p2) ( mcKind(p1) == mcKind(p2) && mcKind(p1) == STRING && mcStrCmp( p1, p2 ) < 0 )
+#define mcStrG(p1, p2) ( mcKind(p1) == mcKind(p2) && mcKind(p1) == STRING && mcStrCmp( p1, p2 ) > 0 )
+#define mcStrLE(p1, p2) ( mcKind(p1) == mcKind(p2) && mcKind(p1) == STRING && mcStrCmp( p1, p2 ) <= 0 )
+#define mcStrGE(p1, p2) ( mcKind(p1) == mcKind(p2) && mcKind(p1) == STRING && mcStrCmp( p1, p2 ) >= 0 )
 
 /* Higher level list macros */
 #define mcCar(p)	( mcPair((p)) ? mcGet_Car((p)) : NIL )
@@ -6,7 +6,8 @@
 	* Args are dangerous since nothing is holding onto them.  Therefore,
 	each op should pop it's args into registers.  However, there is
 	overhead associated with registers so not every op does this.  When
-	in doubt, use registers.
+	in doubt, use registers.  (Since the GC scans the C stack, an arg
+	popped into any C local is held onto.)
 
 	* Operations take their arguments off of the value stack,
 	and return their values on the value stack.
@@ -47,6 +48,21 @@ void opMakeClosure()
    mcPushVal(close);
 }
 
+/* opMakeAnalyzed() - Create an interpreted closure from its parameters,
+	body and the body analyzed.
+*/
+void opMakeAnalyzed()
+{
+   CONS close;
+
+   close = NewCons( CLOSURE, 0, 0 );
+   mcCl_Env(close) = mcGet_Nested(glo_env);
+   mcCl_Code(close) = mcPopVal();
+   mcCl_Body(close) = mcPopVal();
+   mcCl_Parms(close) = mcPopVal();
+   mcPushVal(close);
+}
+
 /* ----------------------------------------------------------------------- */
 /*                       Interpreter Directives				   */
 /* ----------------------------------------------------------------------- */
@@ -60,6 +76,9 @@ void opEnv()
 /* opExit() - Quit scheme. */
 void opExit()
 {
+   if ( gc_debug )
+	GcStats();
+
    exit(0);
 }
 
@@ -97,6 +116,52 @@ void opGcDebug()
    mcPushVal( T );
 }
 
+/* (GC-BUDGET [n]) - Sets the # of cells an incremental GC scans per
+	slice to n.  0 turns incremental GC off.  Returns the budget.
+*/
+void opGcBudget()
+{
+   CONS n;
+
+   if ( (n = mcPopVal()) != MARK ) {
+	/* pop MARK */
+	(void)mcPopVal();
+
+	if ( !mcInteger(n) || mcGet_Int(n) < 0 )
+		RT_LERROR("GC-BUDGET: Arg must be a non-negative integer: ", n);
+
+	gc_budget = mcGet_Int(n);
+   }
+
+   mcPushVal( mcIntToCons( (int)gc_budget ) );
+}
+
+/* (GC) - Collects the entire store now. */
+void opGc()
+{
+   FullGc();
+   mcPushVal( NIL );
+}
+
+/* (GC-STATS) - Prints the GC pause distribution. */
+void opGcStats()
+{
+   GcStats();
+   mcPushVal( NIL );
+}
+
+/* (EXPAND-STATS) - Returns the # of macro calls whose expansion was
+	remembered and the # that had to be expanded: (hits misses).
+*/
+void opExpStats()
+{
+   CONS stats;
+
+   stats = mcCons( mcIntToCons( (int)ev_exp_misses ), NIL );
+   stats = mcCons( mcIntToCons( (int)ev_exp_hits ), stats );
+   mcPushVal( stats );
+}
+
 /* (EVDEBUG) - Turns evaluation debugging on/off.  Returns the new state. */
 void opEvDebug()
 {
@@ -136,6 +201,11 @@ void opEval()
 
 	/* save the current environment */
 	evSaveEnv();
+
+	/* the nested bindings of glo_env are stored without a write
+	 * barrier; now that it's no longer glo_env, it needs one.
+	 */
+	WBarrier( glo_env, mcGet_Nested(glo_env) );
 	glo_env = env;
    }
 
@@ -158,41 +228,39 @@ void opApply()
 /* (CALL/CC func) */
 void opCallCC()
 {
-   ENTER;
-   REG(cont);
-   REG(func);
+   CONS cont, func;
 
-   R(func) = mcPopVal();
+   func = mcPopVal();
 
    /* build the continuation */
-   R(cont) = NewCons( CONT, 0, 0 );
-   mcCont_Env( R(cont) ) = mcGet_Nested(glo_env);
-   mcCont_Val( R(cont) ) = mcGetValS();
-   mcCont_Exp( R(cont) ) = mcGetExprS();
-   mcCont_Fnc( R(cont) ) = mcGetFuncS();
+   cont = NewCons( CONT, 0, 0 );
+   mcCont_Env( cont ) = mcGet_Nested(glo_env);
+   mcCont_Val( cont ) = mcGetValS();
+   WBarrier( cont, mcCont_Val(cont) );
+   mcCont_Exp( cont ) = mcGetExprS();
+   WBarrier( cont, mcCont_Exp(cont) );
+   mcCont_Fnc( cont ) = mcGetFuncS();
+   WBarrier( cont, mcCont_Fnc(cont) );
 
    /* evCallFunc takes the list of arguments so put the continuation
     * into a list with only 1 element.
     */
-   R(cont) = mcCons( R(cont), NIL );
+   cont = mcCons( cont, NIL );
 
    /* setup to invoke the function */
-   evCallFunc( R(func), R(cont) );
+   evCallFunc( func, cont );
 
-   OPVOIDLEAVE;
 }
 
 /* (COMPILE exp) */
 void opCompile()
 {
-   ENTER;
-   REG(exp);
-   REG(code);
+   CONS exp, code;
 
-   R(exp) = mcPopVal();
-   R(code) = mcCompile( R(exp) );
+   exp = mcPopVal();
+   code = mcCompile( exp );
 
-   OPLEAVE( R(code) );
+   mcPushVal( code );
 }
 
 #ifdef OLD_CODE
@@ -202,40 +270,35 @@ void opCompile()
 void opMap(args)
 CONS args;
 {
-   ENTER;
-   REG(parms);
+   CONS parms;
 
-   R(parms) = mcCdr(args);
-   R(parms) = mcRev( R(parms) );
+   parms = mcCdr(args);
+   parms = mcRev( parms );
 
-   opDoMap( mcCar(args), R(parms), NIL );
+   opDoMap( mcCar(args), parms, NIL );
 
-   OPVOIDLEAVE;
 }
 
 void opResMap(args)
 CONS args;
 {
-   ENTER;
-   REG(proc);
-   REG(parms);
-   REG(result);
+   CONS proc, parms, result;
 
-   R(proc) = mcCaddr(args);
-   R(result) = mcCadddr(args);
-   R(parms) = mcCddddr(args);
+   proc = mcCaddr(args);
+   result = mcCadddr(args);
+   parms = mcCddddr(args);
 
    /* add result of last evaluation */
-   R(result) = mcCons( mcPopVal(), R(result) );
+   result = mcCons( mcPopVal(), result );
 
    /* done evaluating? */
-   if ( mcNull( mcCar(R(parms)) ) ) {
-	R(result) = mcRev( R(result) );
-	OPLEAVE( R(result) );
+   if ( mcNull( mcCar(parms) ) ) {
+	result = mcRev( result );
+	mcPushVal( result );
+	return;
    }
 
-   opDoMap( R(proc), R(parms), R(result) );
-   OPVOIDLEAVE;
+   opDoMap( proc, parms, result );
 }
 #endif
 
@@ -274,17 +337,14 @@ void opCdr()
 /* (CONS obj1 obj2) */
 void opCons()
 {
-   ENTER;
-   REG(head);
-   REG(tail);
-   REG(lyst);
+   CONS head, tail, lyst;
 
-   R(head) = mcPopVal();
-   R(tail) = mcPopVal();
+   head = mcPopVal();
+   tail = mcPopVal();
 
-   R(lyst) = mcCons( R(head), R(tail) );
+   lyst = mcCons( head, tail );
 
-   OPLEAVE( R(lyst) );
+   mcPushVal( lyst );
 }
 
 /* (SET-CAR! obj1 obj2) */
@@ -415,24 +475,19 @@ void opList()
 /* (REVERSE list) */
 void opRev()
 {
-   ENTER;
-   REG(arg);
+   CONS arg;
 
-   R(arg) = mcPopVal();
-   R(arg) = mcTree_Copy( R(arg) );
-   R(arg) = mcRev( R(arg) );
+   arg = mcPopVal();
+   arg = mcTree_Copy( arg );
+   arg = mcRev( arg );
 
-   OPLEAVE( R(arg) );
+   mcPushVal( arg );
 }
 
 /* (APPEND list1 list2 list3 ...) */
 void opAppend()
 {
-   ENTER;
-   REG(res);
-   REG(sarg);
-   REG(arg);
-   REG(rptr);
+   CONS res, arg, rptr;
 
    /* this is kind of ugly, but given list1, list2, ...,listn, i want
     * append to be O( |list1|+|list2|+|...| ).  the fact that '() acts
@@ -442,44 +497,47 @@ void opAppend()
     */
 
    /* get first arg, skip leading '()s */
-   R(sarg) = R(arg) = mcPopVal();
-   while ( mcNull( R(arg) ) )
-	R(sarg) = R(arg) = mcPopVal();
+   arg = mcPopVal();
+   while ( mcNull( arg ) )
+	arg = mcPopVal();
 
    /* (append '() '()) => () */
-   if ( R(arg) == MARK ) {
-	OPLEAVE( NIL );
+   if ( arg == MARK ) {
+	mcPushVal( NIL );
+	return;
    }
 
    /* initialize result to be (cons (car arg) '()) */
-   if ( !mcNull(R(arg)) && !mcPair( R(arg) ) ) {
-	RT_LERROR("APPEND: Requires lists: ", R(arg) );
+   if ( !mcNull(arg) && !mcPair( arg ) ) {
+	RT_LERROR("APPEND: Requires lists: ", arg );
    }
-   R(res) = mcCons( mcCar(R(arg)), NIL );
-   R(rptr) = R(res);
+   res = mcCons( mcCar(arg), NIL );
+   rptr = res;
 
    /* we've copied the car of arg, copy the rest of it */
-   R(arg) = mcCdr( R(arg) );
+   arg = mcCdr( arg );
    goto complete;
 
    while ( TRUE ) {
 	/* pop first arg */
-	R(sarg) = R(arg) = mcPopVal();
+	arg = mcPopVal();
 
 	/* that good old '() throws things off a little */
-	if ( R(arg) == MARK ) {
-		OPLEAVE( R(res) );
+	if ( arg == MARK ) {
+		mcPushVal( res );
+		return;
 	}
 
-	if ( !mcNull(R(arg)) && !mcPair(R(arg)) ) {
-		RT_LERROR("APPEND: Requires lists: ", R(arg));
+	if ( !mcNull(arg) && !mcPair(arg) ) {
+		RT_LERROR("APPEND: Requires lists: ", arg);
 	}
 
 	/* last arg just gets SET-CDR! */
 	if ( mcValStackTop() == MARK ) {
-		mcSetCdr( R(rptr), R(arg) );
+		mcSetCdr( rptr, arg );
 		mcPopVal();
-		OPLEAVE( R(res) );
+		mcPushVal( res );
+		return;
 	}
 
 complete:
@@ -487,9 +545,9 @@ complete:
      {
 	CONS curr;
 
-	for ( curr = R(arg); !mcNull(curr); curr = mcCdr(curr) ) {
-		mcSetCdr( R(rptr), mcCons( mcCar(curr), NIL ) );
-		R(rptr) = mcCdr( R(rptr) );
+	for ( curr = arg; !mcNull(curr); curr = mcCdr(curr) ) {
+		mcSetCdr( rptr, mcCons( mcCar(curr), NIL ) );
+		rptr = mcCdr( rptr );
 	}
      }
    }
@@ -498,12 +556,11 @@ complete:
 /* (TREE-COPY list) */
 void opTree_Copy()
 {
-   ENTER;
-   REG(result);
+   CONS result;
 
-   R(result) = mcPopVal();
-   R(result) = mcTree_Copy( R(result) );
-   OPLEAVE( R(result) );
+   result = mcPopVal();
+   result = mcTree_Copy( result );
+   mcPushVal( result );
 }
 
 /* (LENGTH list) */
@@ -563,7 +620,7 @@ void opStrLen()
    if ( !mcString(str) )
 	RT_ERROR("STRING-LENGTH: Arg must be a string.");
 
-   len = strlen( mcGet_Str(str) );
+   len = mcStr_Len(str);
    mcPushVal( mcIntToCons(len) );
 }
 
@@ -582,8 +639,9 @@ void opStrRef()
    if ( !mcInteger(ref) )
 	RT_LERROR("STRING-REF: Second arg must be an integer: ", ref);
 
+   mcStr_Flat( str );
    s = mcGet_Str(str);
-   if ( (index = mcGet_Int(ref)) > strlen(s)-1 )
+   if ( (index = mcGet_Int(ref)) < 0 || index > mcStr_Len(str)-1 )
 	RT_LERROR("STRING-REF: REF is greater than string length: ", ref);
 
    mcPushVal( mcCharToCons( (int)*(s+index) ) );
@@ -607,14 +665,144 @@ void opSubStr()
    if ( !mcInteger(stop) )
 	RT_LERROR("SUBSTRING: Third arg must be an integer: ", stop);
 
-   len = strlen( mcGet_Str(str) ) - 1;
+   len = mcStr_Len(str) - 1;
    if ( (beg = mcGet_Int(start)) > len )
 	RT_ERROR("SUBSTRING: START > string length.");
 
    if ( (end = mcGet_Int(stop)) > len )
 	RT_ERROR("SUBSTRING: STOP > string length.");
 
-   mcPushVal( mcSubStr( mcGet_Str(str), beg, end ) );
+   mcPushVal( mcSubStr( str, beg, end ) );
+}
+
+/* (STRING-SET! string k char) - a slice is given its own characters
+	first, so the string it came from doesn't change.
+*/
+void opStrSet()
+{
+   CONS str, ref, ch;
+
+   str = mcPopVal();
+   ref = mcPopVal();
+   ch = mcPopVal();
+
+   if ( !mcString(str) )
+	RT_LERROR("STRING-SET!: First arg must be a string: ", str);
+
+   if ( !mcInteger(ref) || mcGet_Int(ref) < 0 || mcGet_Int(ref) >= mcStr_Len(str) )
+	RT_LERROR("STRING-SET!: Illegal reference: ", ref);
+
+   if ( !mcChar(ch) )
+	RT_LERROR("STRING-SET!: Third arg must be a character: ", ch);
+
+   mcStrOwn( str );
+   mcGet_Str(str)[mcGet_Int(ref)] = mcGet_Char(ch);
+   mcPushVal( str );
+}
+
+/* (STRING-FILL! string char) */
+void opStrFill()
+{
+   CONS str, ch;
+
+   str = mcPopVal();
+   ch = mcPopVal();
+
+   if ( !mcString(str) )
+	RT_LERROR("STRING-FILL!: First arg must be a string: ", str);
+
+   if ( !mcChar(ch) )
+	RT_LERROR("STRING-FILL!: Second arg must be a character: ", ch);
+
+   mcStrOwn( str );
+   memset( mcGet_Str(str), mcGet_Char(ch), (size_t)mcStr_Len(str) );
+   mcPushVal( str );
+}
+
+/* (STRING-INDEX string char) - the index of the first char in string, or
+	#F.
+*/
+void opStrIndex()
+{
+   CONS str, ch;
+   int i;
+
+   str = mcPopVal();
+   ch = mcPopVal();
+
+   if ( !mcString(str) )
+	RT_LERROR("STRING-INDEX: First arg must be a string: ", str);
+
+   if ( !mcChar(ch) )
+	RT_LERROR("STRING-INDEX: Second arg must be a character: ", ch);
+
+   i = mcStrIndex( str, mcGet_Char(ch), 0 );
+   mcPushVal( i < 0 ? F : mcIntToCons(i) );
+}
+
+/* (STRING-SEARCH-FORWARD pattern string start) - the index of the first
+	pattern in string at or after start, or #F.
+*/
+void opStrSearch()
+{
+   CONS pat, str, start;
+   int i;
+
+   pat = mcPopVal();
+   str = mcPopVal();
+   start = mcPopVal();
+
+   if ( !mcString(pat) )
+	RT_LERROR("STRING-SEARCH-FORWARD: First arg must be a string: ", pat);
+
+   if ( !mcString(str) )
+	RT_LERROR("STRING-SEARCH-FORWARD: Second arg must be a string: ", str);
+
+   if ( !mcInteger(start) || mcGet_Int(start) < 0 || mcGet_Int(start) > mcStr_Len(str) )
+	RT_LERROR("STRING-SEARCH-FORWARD: Illegal start: ", start);
+
+   i = mcStrSearch( pat, str, mcGet_Int(start) );
+   mcPushVal( i < 0 ? F : mcIntToCons(i) );
+}
+
+/* (STRING-CONTAINS string pattern) - the index of the first pattern in
+	string, or #F.
+*/
+void opStrContains()
+{
+   CONS str, pat;
+   int i;
+
+   str = mcPopVal();
+   pat = mcPopVal();
+
+   if ( !mcString(str) )
+	RT_LERROR("STRING-CONTAINS: First arg must be a string: ", str);
+
+   if ( !mcString(pat) )
+	RT_LERROR("STRING-CONTAINS: Second arg must be a string: ", pat);
+
+   i = mcStrSearch( pat, str, 0 );
+   mcPushVal( i < 0 ? F : mcIntToCons(i) );
+}
+
+/* (STRING-SPLIT string char) - the list of the pieces of string between
+	the chars.
+*/
+void opStrSplit()
+{
+   CONS str, ch;
+
+   str = mcPopVal();
+   ch = mcPopVal();
+
+   if ( !mcString(str) )
+	RT_LERROR("STRING-SPLIT: First arg must be a string: ", str);
+
+   if ( !mcChar(ch) )
+	RT_LERROR("STRING-SPLIT: Second arg must be a character: ", ch);
+
+   mcPushVal( mcStrSplit( str, mcGet_Char(ch) ) );
 }
 
 /* (STRING-APPEND str1 str2) */
@@ -630,7 +818,7 @@ void opStrApp()
    if ( !mcString(str2) )
 	RT_LERROR("STRING-APPEND: Args must be strings: ", str2);
 
-   mcPushVal( mcStrApp( mcGet_Str(str1), mcGet_Str(str2) ) );
+   mcPushVal( mcStrApp( str1, str2 ) );
 }
 
 /* (STRING->LIST string) */
@@ -642,21 +830,20 @@ void opStrLst()
    if ( !mcString(str) )
 	RT_LERROR("STRING->LIST: Arg must be a string: ", str);
 
-   mcPushVal( mcStrLst( mcGet_Str(str) ) );
+   mcPushVal( mcStrLst( str ) );
 }
 
 /* (LIST->STRING chars) */
 void opLstStr()
 {
-   ENTER;
-   REG(lst);
+   CONS lst;
 
-   R(lst) = mcPopVal();
-   if ( !mcPair( R(lst) ) )
-	RT_LERROR("LIST->STRING: Arg must be a list: ", R(lst) );
+   lst = mcPopVal();
+   if ( !mcPair( lst ) )
+	RT_LERROR("LIST->STRING: Arg must be a list: ", lst );
 
-   R(lst) = mcLstStr( R(lst) );
-   OPLEAVE( R(lst) );
+   lst = mcLstStr( lst );
+   mcPushVal( lst );
 }
 
 /* (SYMBOL->STRING symbol) */
@@ -708,20 +895,17 @@ void opArgVector()
 /* (MAKE-VECTOR n obj) */
 void opMakeVector()
 {
-   ENTER;
-   REG(n);
-   REG(obj);
-   REG(v);
+   CONS n, obj, v;
 
-   R(n) = mcPopVal();
-   R(obj) = mcPopVal();
+   n = mcPopVal();
+   obj = mcPopVal();
 
-   if ( !mcNumber(R(n)) || mcGet_Int(R(n)) < 0 )
-	RT_LERROR("MAKE-VECTOR: Requires a non-negative number:", R(n));
+   if ( !mcNumber(n) || mcGet_Int(n) < 0 )
+	RT_LERROR("MAKE-VECTOR: Requires a non-negative number:", n);
 
-   R(v) = mcMakeVector( mcGet_Int(R(n)), R(obj) );
+   v = mcMakeVector( mcGet_Int(n), obj );
 
-   OPLEAVE( R(v) );
+   mcPushVal( v );
 }
 
 /* (VECTOR-LENGTH v) */
@@ -773,7 +957,9 @@ void opVectSet()
 	RT_LERROR("VECTOR-SET!: Illegal reference: ", n);
 
    i = mcGet_Int(n);
+   SBarrier( *mcVect_Ref(v, i) );
    *mcVect_Ref(v, i) = obj;
+   WBarrier(v, obj);
 
    mcPushVal( v );
 }
@@ -781,18 +967,16 @@ void opVectSet()
 /* (VECTOR-COPY v) */
 void opVectCopy()
 {
-   ENTER;
-   REG(old);
-   REG(new);
+   CONS old, new;
 
-   R(old) = mcPopVal();
+   old = mcPopVal();
 
-   if ( !mcVector( R(old) ) )
-	RT_LERROR("VECTOR-COPY: Arg must be a vector: ", R(old) );
+   if ( !mcVector( old ) )
+	RT_LERROR("VECTOR-COPY: Arg must be a vector: ", old );
 
-   R(new) = mcVectorCopy( R(old) );
+   new = mcVectorCopy( old );
 
-   OPLEAVE( R(new) );
+   mcPushVal( new );
 }
 
 /* (VECTOR-FILL! v obj) */
@@ -813,25 +997,23 @@ void opVectFill()
 /* (VECTOR->LIST v) */
 void opVectLst()
 {
-   ENTER;
-   REG(v);
+   CONS v;
 
-   R(v) = mcPopVal();
-   R(v) = mcVectorLst( R(v) );
+   v = mcPopVal();
+   v = mcVectorLst( v );
 
-   OPLEAVE( R(v) );
+   mcPushVal( v );
 }
 
 /* (LIST->VECTOR l) */
 void opLstVect()
 {
-   ENTER;
-   REG(l);
+   CONS l;
 
-   R(l) = mcPopVal();
-   R(l) = mcLstVector( R(l) );
+   l = mcPopVal();
+   l = mcLstVector( l );
 
-   OPLEAVE( R(l) );
+   mcPushVal( l );
 }
 
 /* ----------------------------------------------------------------------- */
@@ -853,26 +1035,25 @@ void opCurrOut()
 /* (READ port) */
 void opRead()
 {
-   ENTER;
-   REG(obj);
-   REG(port);
+   CONS obj, port;
 
-   if ( (R(port) = mcPopVal()) == MARK ) {
-	R(obj) = mcRead(currin);
-	OPLEAVE( R(obj) );
+   if ( (port = mcPopVal()) == MARK ) {
+	obj = mcRead(STDIN);
+	mcPushVal( obj );
+	return;
    }
 
    /* pop MARK */
    mcPopVal();
 
-   if ( !mcPort(R(port)) )
-	RT_LERROR("READ: Arg must be a port.", R(port));
+   if ( !mcPort(port) )
+	RT_LERROR("READ: Arg must be a port.", port);
 
-   if ( mcGet_PortType( R(port) ) != INPUT )
+   if ( mcGet_PortType( port ) != INPUT )
 	RT_ERROR("READ: Port must be an input port.");
 
-   R(obj) = mcRead( mcGet_Port(R(port)) );
-   OPLEAVE( R(obj) );
+   obj = mcRead( port );
+   mcPushVal( obj );
 }
 
 /* (WRITE obj port) */
@@ -895,8 +1076,8 @@ void opWrite()
 	if ( mcGet_PortType(port) != OUTPUT )
 		RT_ERROR("WRITE: Port must be an output port.");
 
-	mcWrite( obj, mcGet_Port(port) );
-   } else mcWrite( obj, currout );
+	mcWrite( obj, port );
+   } else mcWrite( obj, STDOUT );
 
    mcPushVal( obj );
    return;
@@ -908,7 +1089,7 @@ void opNewLine()
    CONS port;
 
    if ( (port = mcPopVal()) == MARK )
-	fprintf(currout, "\n");
+	mcPutStr( STDOUT, "\n", 1 );
    else {
 	/* pop MARK */
 	mcPopVal();
@@ -916,7 +1097,10 @@ void opNewLine()
 	if ( !mcPort(port) )
 		RT_LERROR("NEWLINE: Arg must be a port: ", port);
 
-	fprintf( mcGet_Port(port), "\n" );
+	if ( mcGet_PortType(port) != OUTPUT )
+		RT_ERROR("NEWLINE: Port must be an output port.");
+
+	mcPutStr( port, "\n", 1 );
    }
 
    mcPushVal( NIL );
@@ -929,7 +1113,7 @@ void opReadChar()
    CONS port;
 
    if ( (port = mcPopVal()) == MARK )
-	ch = fgetc(currin);
+	ch = mcGetChar(STDIN);
    else {
 	/* pop MARK */
 	mcPopVal();
@@ -940,7 +1124,7 @@ void opReadChar()
 	if ( mcGet_PortType(port) != INPUT )
 		RT_ERROR("READ-CHAR: Port must be an input port.");
 
-	ch = getc( mcGet_Port(port) );
+	ch = mcGetChar( port );
    }
 
    mcPushVal( mcCharToCons(ch) );
@@ -950,6 +1134,7 @@ void opReadChar()
 void opWriteChar()
 {
    CONS ch, port;
+   char c;
 
    /* pop character */
    ch = mcPopVal();
@@ -966,11 +1151,10 @@ void opWriteChar()
 
 	if ( mcGet_PortType( port ) != OUTPUT )
 		RT_ERROR("WRITE-CHAR: Port must be an output port.");
+   } else port = STDOUT;
 
-	fprintf( mcGet_Port(port), "%c", mcGet_Char(ch) );
-   } else {
-	fprintf( currout, "%c", mcGet_Char(ch) );
-   }
+   c = mcGet_Char(ch);
+   mcPutStr( port, &c, 1 );
 
    mcPushVal( ch );
 }
@@ -992,8 +1176,8 @@ void opDisplay()
 	if ( mcGet_PortType(port) != OUTPUT )
 		RT_ERROR("DISPLAY: Port must be an ouput port.");
 
-	mcDisplay(obj, mcGet_Port(port));
-   } else mcDisplay(obj, currout);
+	mcDisplay(obj, port);
+   } else mcDisplay(obj, STDOUT);
 
    mcPushVal( obj );
 }
@@ -1003,25 +1187,24 @@ void opOpenInFile()
 {
    FILE *ifp;
    {
-   ENTER;
-   REG(name);
-   REG(port);
+   CONS name, port;
 
-   R(name) = mcPopVal();
+   name = mcPopVal();
 
-   if ( !mcString( R(name) ) )
-	RT_LERROR("OPEN-INPUT-FILE: First arg must be a string: ", R(name));
+   if ( !mcString( name ) )
+	RT_LERROR("OPEN-INPUT-FILE: First arg must be a string: ", name);
 
    /* open the file */
-   if ( (ifp = fopen( mcGet_Str(R(name)), "r")) == NULL )
-	RT_LERROR("OPEN-INPUT-FILE: Can't open: ", R(name) );
+   if ( (ifp = fopen( mcCStr(name), "r")) == NULL )
+	RT_LERROR("OPEN-INPUT-FILE: Can't open: ", name );
 
    /* create a port */
-   R(port) = NewCons( PORT, 0, 0 );
-   mcCpy_Port( R(port), ifp );
-   mcCpy_PortType( R(port), INPUT );
+   port = NewCons( PORT, 0, 0 );
+   mcCpy_Port( port, ifp );
+   mcCpy_PortType( port, INPUT );
 
-   OPLEAVE( R(port) );
+   mcPushVal( port );
+   return;
    }
 }
 
@@ -1030,28 +1213,59 @@ void opOpenOutFile()
 {
    FILE *ifp;
    {
-   ENTER;
-   REG(name);
-   REG(port);
+   CONS name, port;
 
-   R(name) = mcPopVal();
+   name = mcPopVal();
 
-   if ( !mcString( R(name) ) )
-	RT_LERROR("OPEN-OUTPUT-FILE: First arg must be a string:", R(name));
+   if ( !mcString( name ) )
+	RT_LERROR("OPEN-OUTPUT-FILE: First arg must be a string:", name);
 
    /* open the file */
-   if ( (ifp = fopen( mcGet_Str(R(name)), "w")) == NULL )
-	RT_LERROR("OPEN-OUTPUT-FILE: Can't open: ", R(name) );
+   if ( (ifp = fopen( mcCStr(name), "w")) == NULL )
+	RT_LERROR("OPEN-OUTPUT-FILE: Can't open: ", name );
 
    /* create a port */
-   R(port) = NewCons( PORT, 0, 0 );
-   mcCpy_Port( R(port), ifp );
-   mcCpy_PortType( R(port), OUTPUT );
+   port = NewCons( PORT, 0, 0 );
+   mcCpy_Port( port, ifp );
+   mcCpy_PortType( port, OUTPUT );
 
-   OPLEAVE( R(port) );
+   mcPushVal( port );
+   return;
    }
 }
 
+/* (OPEN-INPUT-STRING string) */
+void opOpenInStr()
+{
+   CONS str;
+
+   str = mcPopVal();
+
+   if ( !mcString( str ) )
+	RT_LERROR("OPEN-INPUT-STRING: Arg must be a string: ", str);
+
+   mcPushVal( mcOpenInStr( str ) );
+}
+
+/* (OPEN-OUTPUT-STRING) */
+void opOpenOutStr()
+{
+   mcPushVal( mcOpenOutStr() );
+}
+
+/* (GET-OUTPUT-STRING port) */
+void opGetOutStr()
+{
+   CONS port;
+
+   port = mcPopVal();
+
+   if ( !mcPort(port) || !mcStrPort(port) || mcGet_PortType(port) == INPUT )
+	RT_LERROR("GET-OUTPUT-STRING: Arg must be a string output port: ", port);
+
+   mcPushVal( mcOutStr( port ) );
+}
+
 /* (CLOSE port) */
 void opClose()
 {
@@ -1062,8 +1276,7 @@ void opClose()
    if ( !mcPort(port) )
 	RT_LERROR("CLOSE: Arg must be a port: ", port);
 
-   fclose( mcGet_Port(port) );
-   mcCpy_PortType( port, CLOSED );
+   mcClose( port );
 
    /* gee, what should be returned? */
    mcPushVal( NIL );
@@ -1072,8 +1285,7 @@ void opClose()
 /* (LOAD string) */
 void opLoad()
 {
-   ENTER;
-   REG(name);
+   CONS name;
 
    /* this operation is a little tricky since it's got to recursively
     * invoke eval on each expression in the file, but we can't invoke
@@ -1082,16 +1294,15 @@ void opLoad()
     * return here, THEN have the microcode recur using RESUMEs.  ``it's
     * all in the timing.''
     */
-   R(name) = mcPopVal();
-   mcPushVal( R(name) );
+   name = mcPopVal();
+   mcPushVal( name );
 
-   if ( !mcString(R(name)) )
-	RT_LERROR("LOAD: Arg must be a string: ", R(name));
+   if ( !mcString(name) )
+	RT_LERROR("LOAD: Arg must be a string: ", name);
 
-   if ( !mcLoad( mcGet_Str( R(name)) ) )
-	RT_LERROR("LOAD: File not found: ", R(name));
+   if ( !mcLoad( mcCStr(name) ) )
+	RT_LERROR("LOAD: File not found: ", name);
 
-   OPVOIDLEAVE;
 }
 
 /* ----------------------------------------------------------------------- */
@@ -1154,8 +1365,8 @@ void opError()
 
    /* display args */
    while ( (curr = mcPopVal()) != MARK ) {
-	mcDisplay(curr, currout);
-	fprintf(currout, " ");
+	mcDisplay(curr, STDOUT);
+	mcPutStr( STDOUT, " ", 1 );
    }
 
    ERROR;
@@ -1168,47 +1379,47 @@ void opError()
 /* (DUMP-ENVIRONMENT filename) */
 void opDumpEnv()
 {
-   ENTER;
-   REG(name);
+   CONS name;
    FILE *fp;
 
-   R(name) = mcPopVal();
-   if ( !mcString(R(name)) ) {
-	RT_LERROR("DUMP-ENVIRONMENT: Arg must be a string: ", R(name));
+   name = mcPopVal();
+   if ( !mcString(name) ) {
+	RT_LERROR("DUMP-ENVIRONMENT: Arg must be a string: ", name);
    }
 
-   if ( (fp = fopen( mcGet_Str(R(name)), FILE_WRITE_BIN )) == NULL ) {
-	RT_LERROR("DUMP-ENVIRONMENT: Filename not found: ", R(name) );
+   if ( (fp = fopen( mcCStr(name), FILE_WRITE_BIN )) == NULL ) {
+	RT_LERROR("DUMP-ENVIRONMENT: Filename not found: ", name );
    }
 
    if ( mcDumpEnv(fp) == FALSE ) {
-	OPLEAVE( F );
+	mcPushVal( F );
+	return;
    }
 
-   OPLEAVE( R(name) );
+   mcPushVal( name );
 }
 
 /* (RESTORE-ENVIRONMENT filename) */
 void opRestEnv()
 {
-   ENTER;
-   REG(name);
+   CONS name;
    FILE *fp;
 
-   R(name) = mcPopVal();
-   if ( !mcString(R(name)) ) {
-	RT_LERROR("RESTORE-ENVIRONMENT: Arg must be a string: ", R(name));
+   name = mcPopVal();
+   if ( !mcString(name) ) {
+	RT_LERROR("RESTORE-ENVIRONMENT: Arg must be a string: ", name);
    }
 
-   if ( (fp = fopen( mcGet_Str(R(name)), FILE_READ_BIN )) == NULL ) {
-	RT_LERROR("RESTORE-ENVIRONMENT: Filename not found: ", R(name) );
+   if ( (fp = fopen( mcCStr(name), FILE_READ_BIN )) == NULL ) {
+	RT_LERROR("RESTORE-ENVIRONMENT: Filename not found: ", name );
    }
 
    if ( mcRestEnv(fp) == FALSE ) {
-	OPLEAVE( F );
+	mcPushVal( F );
+	return;
    }
 
-   OPLEAVE( R(name) );
+   mcPushVal( name );
 }
 
 /* ----------------------------------------------------------------------- */
@@ -1224,7 +1435,7 @@ void opChdir()
    if ( !mcString(l) )
 	RT_LERROR("CHDIR: Requires a string: ", l);
 
-   if ( chdir( mcGet_Str(l) ) )
+   if ( chdir( mcCStr(l) ) )
 	mcPushVal( F );
    else mcPushVal( l );
 }
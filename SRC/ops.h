@@ -6,8 +6,13 @@ void opEnv( C_VOID );
 void opTorture( C_VOID );
 void opGcDebug( C_VOID );
 void opEvDebug( C_VOID );
+void opGcBudget( C_VOID );
+void opGcStats( C_VOID );
+void opExpStats( C_VOID );
+void opGc( C_VOID );
 void opExit( C_VOID );
 void opMakeClosure( C_VOID );
+void opMakeAnalyzed( C_VOID );
 
 /* primitive list operations */
 void opCar( C_VOID );
@@ -71,6 +76,12 @@ void opGenSym( C_VOID );
 void opStrLen( C_VOID );
 void opStrRef( C_VOID );
 void opSubStr( C_VOID );
+void opStrSet( C_VOID );
+void opStrFill( C_VOID );
+void opStrIndex( C_VOID );
+void opStrSearch( C_VOID );
+void opStrContains( C_VOID );
+void opStrSplit( C_VOID );
 void opStrLst( C_VOID );
 void opLstStr( C_VOID );
 void opSymStr( C_VOID );
@@ -89,6 +100,9 @@ void opCurrOut( C_VOID );
 void opLoad( C_VOID );
 void opOpenInFile( C_VOID );
 void opOpenOutFile( C_VOID );
+void opOpenInStr( C_VOID );
+void opOpenOutStr( C_VOID );
+void opGetOutStr( C_VOID );
 void opClose( C_VOID );
 
 void opError( C_VOID );
@@ -10,8 +10,8 @@
 	- INTERP_CODES *MUST* be == the # of byte-code interpreter ops.
 */
 
-#define NUM_FUNCS	138
-#define INTERP_CODES	10
+#define NUM_FUNCS	150
+#define INTERP_CODES	19
 
 /* byte-code interpreter ops */
 #define prNoOp		0
@@ -26,6 +26,13 @@
 #define prPushMark	9
 #define prCall		10
 #define prPushFunc	11
+#define prPushLocal	12
+#define prPushGlobal	13
+#define prSetGlobal	14
+#define prSetLocal	15
+#define prMakeAnalyzed	16
+#define prPushGlo	17
+#define prSetGlo	18
 
 /* special forms */
 #define prDefine	20
@@ -41,7 +48,9 @@
 #define prMacro		30
 #define prmcExpand	31
 
-/* note missing 32, 33, 34 */
+#define prGcBudget	32
+#define prGcStats	33
+#define prGc		34
 
 /* interpreter directives */
 #define prEnv		35
@@ -171,3 +180,19 @@
 
 #define prDumpEnv	136
 #define prRestEnv	137
+
+#define prStrSet	138
+#define prStrFill	139
+
+#define prOpenInStr	140
+#define prOpenOutStr	141
+#define prGetOutStr	142
+
+#define prStrIndex	143
+#define prStrSearch	144
+#define prStrContains	145
+#define prStrSplit	146
+#define prStrPrefix	147
+#define prStrSuffix	148
+
+#define prExpStats	149
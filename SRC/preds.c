@@ -453,6 +453,40 @@ void opStrGE()
    mcPushVal( ( mcStrGE(str1, str2) ? T : F ) );
 }
 
+/* (STRING-PREFIX? prefix string) */
+void opStrPrefix()
+{
+   CONS str1, str2;
+
+   str1 = mcPopVal();
+   str2 = mcPopVal();
+
+   if ( !mcString(str1) )
+	RT_LERROR("STRING-PREFIX?: Args must be strings: ", str1);
+
+   if ( !mcString(str2) )
+	RT_LERROR("STRING-PREFIX?: Args must be strings: ", str2);
+
+   mcPushVal( ( mcStrPrefix(str1, str2) ? T : F ) );
+}
+
+/* (STRING-SUFFIX? suffix string) */
+void opStrSuffix()
+{
+   CONS str1, str2;
+
+   str1 = mcPopVal();
+   str2 = mcPopVal();
+
+   if ( !mcString(str1) )
+	RT_LERROR("STRING-SUFFIX?: Args must be strings: ", str1);
+
+   if ( !mcString(str2) )
+	RT_LERROR("STRING-SUFFIX?: Args must be strings: ", str2);
+
+   mcPushVal( ( mcStrSuffix(str1, str2) ? T : F ) );
+}
+
 /* ----------------------------------------------------------------------- */
 /*                            Port Predicates				   */
 /* ----------------------------------------------------------------------- */
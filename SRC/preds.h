@@ -42,6 +42,8 @@ void opStrL( C_VOID );
 void opStrG( C_VOID );
 void opStrLE( C_VOID );
 void opStrGE( C_VOID );
+void opStrPrefix( C_VOID );
+void opStrSuffix( C_VOID );
 
 /* port ops */
 void opEofObj( C_VOID );
@@ -1,5 +1,15 @@
 /* scanner.c -- the lexical scanner for Scheme
 
+   Version 3 Reads from a port.
+
+	* GetToken() takes a port, not a FILE, so a string port can be
+	scanned as well as a file.  get_char() and unget_char() are
+	mcGetChar() and mcUngetChar() (mc_io.c), which know both kinds.
+
+	* A token longer than token[] used to run off its end.  With
+	string ports reading back what was written a long one is easy
+	to get, so token[] is malloc'ed now and doubles when it fills.
+
    Version 2 (jk0) Operates on characters.
 
 	* MAX_TOKEN is HUGE to account for really long strings.  By far
@@ -44,40 +54,54 @@
 
 #include "glo.h"
 #include "debug.h"
+#include "micro.h"
+#include "error.h"
 #include "scanner.h"
 
-#define MAX_TOKEN	500
+#define MAX_TOKEN	500	/* token[]'s first size */
 
 /* the global variables */
-char token[MAX_TOKEN];		/* the current token's string */
+char *token;			/* the current token's string */
+static int token_size;		/* bytes in token[] */
 int inum;			/* token: integer value */
 REAL_NUM fnum;			/* token: float value */
 int token_type;			/* the current token's type */
 static prev_token;		/* previous token */
 
 /* private prototypes */
-static int get_char( C_FILE C_PTR );
-static void unget_char( C_FILE C_PTR X C_INT );
-static void flush_line( C_FILE C_PTR );
+static int get_char( C_CONS );
+static void unget_char( C_CONS X C_INT );
+static void flush_line( C_CONS );
 static char convert_char( C_CHAR C_PTR );
+static char *grow_token( C_CHAR C_PTR X C_INT );
 
 /* private macros */
-#define islegal(a)	( ((a)) != EOS && !isspace((a)) && ((a)) != '(' && ((a)) != ')' && ((a)) != '[' && ((a)) != ']' )
+#define islegal(a)	( ((a)) != EOS && ((a)) != EOF && !isspace((a)) && ((a)) != '(' && ((a)) != ')' && ((a)) != '[' && ((a)) != ']' )
 #define TOUPPER(c)	( islower((c)) ? toupper((c)) : (c) )
 
+/* PUT_TOK(c) - add c to token[] at tptr, leaving room for the EOS */
+#define PUT_TOK(c)	( tptr - token < token_size - 1 ? (void)(*tptr++ = (char)(c)) \
+					: (void)(tptr = grow_token(tptr, (c))) )
+
 /* InitScanner() - resets all of the scanner's variables. */
 void InitScanner()
 {
+   if ( token == NULL ) {
+	token_size = MAX_TOKEN;
+	if ( (token = (char *)malloc( (size_t)token_size )) == NULL )
+		FATAL("InitScanner: No memory for the token buffer.");
+   }
+
    token[0] = EOS;
    token_type = NO_TOKEN;
    prev_token = NO_TOKEN;
 }
 
-/* GetToken() - returns the token type of the next token in the line.  it
-	has a side-effect of putting the token in the variable token.
+/* GetToken(f) - returns the token type of the next token read from port
+	f.  it has a side-effect of putting the token in the variable token.
 */
 int GetToken(f)
-FILE *f;
+CONS f;
 {
    int ch;		/* current char */
    char *tptr;		/* placement in token[] */
@@ -159,7 +183,7 @@ new_line:
 		 */
 		ch = get_char(f);
 		while ( islegal(ch) ) {
-			*tptr++ = (char)ch;
+			PUT_TOK(ch);
 			ch = get_char(f);
 		}
 		*tptr = EOS;
@@ -179,7 +203,7 @@ new_line:
 	}
 	else if ( isdigit(ch) ) {
 		while ( isdigit(ch) ) {
-			*tptr++ = (char)ch;
+			PUT_TOK(ch);
 			ch = get_char(f);
 		}
 		*tptr = EOS;
@@ -202,7 +226,7 @@ new_line:
 		if ( ch == '\\' )
 			ch = get_char(f);
 
-		*tptr++ = (char)ch;
+		PUT_TOK(ch);
 
 		ch = get_char(f);
 	}
@@ -252,7 +276,7 @@ new_line:
 	ch = get_char(f);
 	while ( isdigit(ch) || ch == '.' ) {
 		if (ch == '.') integer = FALSE;
-		*tptr++ = (char)ch;
+		PUT_TOK(ch);
 		ch = get_char(f);
 	}
 
@@ -275,8 +299,7 @@ new_line:
 read_symbol:
    /* alpha-numeric atom now */
    while ( islegal(ch) && ch != CDELIM ) {
-	*tptr = TOUPPER(ch);
-	++tptr;
+	PUT_TOK( TOUPPER(ch) );
 	ch = get_char(f);
    }
 
@@ -295,24 +318,24 @@ void PutBack()
 /*                      Low level Scanner routines			   */
 /* ----------------------------------------------------------------------- */
 
-/* get_char(f) - Get the next character from f. */
+/* get_char(f) - Get the next character from port f. */
 static int get_char(f)
-FILE *f;
+CONS f;
 {
-   return fgetc(f);
+   return mcGetChar(f);
 }
 
 /* unget_char(f, c) */
 static void unget_char(f, c)
-FILE *f;
+CONS f;
 int c;
 {
-   ungetc(c, f);
+   mcUngetChar(f, c);
 }
 
 /* flush_line(f) - Read and throw away everything until the next newline. */
 static void flush_line(f)
-FILE *f;
+CONS f;
 {
    int ch;
 
@@ -320,6 +343,25 @@ FILE *f;
 	;
 }
 
+/* grow_token(tptr, c) - token[] is full up to tptr.  Doubles it, adds c,
+	and returns where the next character goes.
+*/
+static char *grow_token(tptr, c)
+char *tptr;
+int c;
+{
+   long off;
+
+   off = tptr - token;
+   token_size *= 2;
+   if ( (token = (char *)realloc( token, (size_t)token_size )) == NULL )
+	FATAL("GetToken: No memory for a token that long.");
+
+   tptr = token + off;
+   *tptr++ = (char)c;
+   return tptr;
+}
+
 /* convert_char(s) - S is a string denoting a character.  Converts and returns
 	that character.  i.e. "space" returns space, "newline" returns '\n'.
 	S is null terminated.
@@ -27,12 +27,12 @@
 #define UNKNOWN_ELEMS	-1	/* unknown # of vector elements */
 
 /* variables */
-extern char token[];			/* the current token's string */
+extern char *token;			/* the current token's string */
 extern int token_type;			/* the current token type */
 extern int inum;			/* token: integer value */
 extern REAL_NUM fnum;			/* token: float value */
 
 /* proto-types */
 void InitScanner( C_VOID );
-int GetToken( C_FILE C_PTR );
+int GetToken( C_CONS );
 void PutBack( C_VOID );
@@ -79,8 +79,8 @@ char *argv[];
    /* initialize the different pieces */
    InitScanner();
    InitSymstr();
-   InitMem(argc, argv);
-   InitMicro();
+   InitMem(argc, argv, (char *)&lyst);	/* the GC scans the C stack up to lyst */
+   InitMicro(argc, argv);
    InitEval(argc, argv);
    InitComp(argc, argv);
    InitGlos();		/* initialize after lower levels */
@@ -106,7 +106,7 @@ char *argv[];
    for ( ; ; ) {
 	/* read */
 	fprintf( currout, "[=> ");
-	lyst = mcRead( currin );
+	lyst = mcRead( STDIN );
 
 	/* eval */
 	mcPushExpr(lyst);
@@ -115,7 +115,7 @@ char *argv[];
 	/* print */
 	fprintf( currout, "\n" );
 	lyst = mcPopVal();
-	mcWrite( lyst, currout );
+	mcWrite( lyst, STDOUT );
 	fprintf( currout, "\n");
    }
 }
@@ -142,8 +142,18 @@ void usage()
    printf("\t-c\t\tCompiler debug ON - Dump compiler statistics.\n");
    printf("\t-e\t\tEval debug ON - Dump evaluation statistics.\n");
    printf("\t-g\t\tGC debug ON - Dump garbage-collection stats.\n");
+   printf("\t-i\t\tInterpret closures - Don't pre-analyze their bodies.\n");
+   printf("\t-G<n>\t\tMark with n threads in a major GC.\n");
+   printf("\t-H<size>\tHeap size to grow to before collecting old cells.\n");
+   printf("\t-p<n>\t\tGC pause budget - Cells scanned per GC slice.\n");
    printf("\t-t\t\tTorture test ON - GC before every allocation.\n");
    printf("\t-s\t\tSilent Mode - Skip startup header.\n");
+   printf("\t--heap-min=<size>\tNever shrink the heap below size.\n");
+   printf("\t--heap-max=<size>\tNever grow the heap past size.\n");
+   printf("\t--stack-max=<size>\tNever grow a stack past size.\n");
+   printf("\t--thp\t\tUse transparent huge pages for the heap.\n");
+   printf("\t--fg-sweep\tSweep on the mutator, not in the background.\n");
+   printf("\t\t\tSizes are bytes, or K, M or G with a suffix.\n");
    printf("\n");
 }
 
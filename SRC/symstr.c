@@ -1,5 +1,74 @@
 /* Symstr.c - The Symbol Table & String Routines
 
+   Version 7
+
+	- SymMacro[] has a flag for each symbol # that's set if the symbol
+	may be bound in *EXPANSION-TABLE* (mcSym_Macro(), micro.h).  The
+	interpreter tests it before looking for an expander, so calling
+	CAR or + doesn't search the macro table.
+
+   Version 6
+
+	- ssMemChr() and ssMemMem() find a character or a string in a run
+	of characters, for STRING-INDEX, STRING-SEARCH-FORWARD and the
+	rest (micro.c).  With SSE2 or AVX2 (machine.h) they compare 16 or
+	32 characters at once.  ssMemMem() looks for the pattern's first
+	and last characters together and only compares the whole pattern
+	where both match, so a pattern whose first character is common
+	doesn't cost a memcmp() per occurrence of it.
+
+   Version 5
+
+	- The symbol table is weak.  A symbol stays in it as long as its
+	cell is reachable or it's bound in the global environment; a major
+	GC drops the rest (ssDrop()), and their #'s are used again.  The
+	symbols added since the last GC are in SymNew[], which a minor GC
+	takes as roots -- with #'s reused, "added since" is no longer a
+	range of #'s.
+
+	- Gensyms aren't interned.  mcGenSym() used to look for a "G<n>"
+	nobody had read yet, interning every one it tried, and they were
+	never reclaimed.  Now it's a count and a cell: ssGenSym() gives the
+	cell a # and a name but no hash slot, so no other symbol is eq? to
+	it, and it goes when the cell does.
+
+   Version 4
+
+	- A symbol is one cell.  The reader used to make a new SYMBOL cell
+	for every symbol it read, though all that matters about it is its
+	#.  Now SymCell[] holds a cell for each symbol #, made when the
+	symbol is added, and ssIntern() returns it: reading a symbol
+	that's been seen before allocates nothing, and symbols are eq?
+	iff they're the same CONS.
+
+   Version 3
+
+	- The symbol table had room for MAX_SYMBOLS (1000) symbols, hashed
+	with a weak positional sum and probed a slot at a time all the way
+	round the table when it was full.  Now it grows.  A symbol's # is
+	the order it was added in -- SymTable[] is the names by # and
+	doubles when it fills -- and a separate open addressed table of
+	slots finds the # from the name.  A slot holds the symbol's full
+	FNV-1a hash (mcHash()) as well as its #, so a probe only calls
+	strcmp() when the hashes match, and the slots can be doubled at
+	half full without hashing the names again.  Symbol #'s never
+	change, so the cells that hold them don't either.
+
+	- The global bindings are a vector indexed by symbol #.  It starts
+	at INIT_SYMBOLS slots and evDefGlobal() grows it when a symbol
+	past its end is bound.
+
+   Version 2
+
+	- Strings are no longer copied into a string space that's never
+	reclaimed.  ssAddString(), ssSubstring() and ssAppend() return
+	room from the string heap (NewStr() in memory.c), freed by the GC
+	when the STRING cell it's given to dies.  There is no limit but
+	the memory.
+
+	- A symbol's name is malloc'ed on its own, freed when the symbol
+	is dropped from the table.
+
    Version 1
 
 	- The symbol table is a closed hash table.
@@ -7,19 +76,12 @@
 	   - Neither symbols or strings are removed from the symbol table
 	     during GC.  Therefore, it is possible to fill the table with
 	     garbage.
-	   - Symbols are actually stored in the string space.
+	   - Symbols are actually stored in the string space.  (Ver 1 only)
 
 	- Distinction between "symbol" and "string".  "symbol" is a Scheme
 	identifier; you bind values to symbols.  "string" is a Scheme string;
 	it is an array of characters.
 
-   BUGS:
-
-	- String space is allocated and never deallocated.  Strings which are
-	GCed are lost (since strings aren't hashed into a table of pointers)
-	and their memory is not reclaimed.  Probably should be fixed, but
-	requires more sophisticated string management (one with	reference
-	counts).
 */
 
 #include "machine.h"
@@ -27,13 +89,20 @@
 #include STDLIB_H
 #include STRING_H
 
+#ifdef SIMD_AVX2
+#	include <immintrin.h>
+#else
+#ifdef SIMD_SSE2
+#	include <emmintrin.h>
+#endif
+#endif
+
 #include "glo.h"
 #include "error.h"
 #include "micro.h"
+#include "memory.h"
 #include "symstr.h"
 
-#define STRING_SIZE	5000	/* bytes */
-
 /* globals */
 #ifdef DEBUG_SYM
 	int sym_debug = TRUE;
@@ -41,116 +110,313 @@
 	int sym_debug = FALSE;
 #endif
 
-char *SymTable[MAX_SYMBOLS];	/* symbol table */
-char *STRING_SPACE;		/* string storage space */
-int Sleft;			/* # bytes left in string storage space */
+char **SymTable;		/* symbol names, by symbol # */
+CONS *SymCell;			/* the symbol's cell, by symbol # */
+char *SymMacro;			/* may it be a macro?  by symbol # */
+int SymCount;			/* symbol #'s used so far */
+int *SymNew;			/* symbols added since the last GC */
+int SymNewCnt;			/* # of them */
+
+/* a slot of the hash table; sym is -1 if it's empty */
+struct Slot {
+   unsigned long hash;		/* mcHash() of the name */
+   int sym;			/* the symbol's # */
+} ;
+typedef struct Slot SLOT;
+
+static int sym_max;		/* room in SymTable */
+static SLOT *slots;		/* the hash table */
+static unsigned long slot_max;	/* # of slots; a power of 2 */
+static int sym_live;		/* # of symbols in the table */
+static int *free_no;		/* dropped symbol #'s, to use again */
+static int free_cnt;		/* # of them */
+static int free_max;		/* room in free_no */
+static int new_max;		/* room in SymNew */
+
+/* private prototypes */
+static SLOT *find_slot( C_CHAR C_PTR X unsigned long );
+static BOOL grow_slots( C_VOID );
+static int add_symbol( C_CHAR C_PTR X C_CONS );
+static void drop_slot( C_INT );
 
 /* InitSymstr() - Initialize the symbol table and string routines. */
 void InitSymstr()
 {
-   int i;
-
-   /* allocate string space */
-   STRING_SPACE = (char *) calloc( 1, sizeof(char)*STRING_SIZE );
-   Sleft = STRING_SIZE-1;
+   unsigned long i;
+
+   sym_max = new_max = free_max = INIT_SYMBOLS;
+   slot_max = 2 * INIT_SYMBOLS;
+   if ( (SymTable = (char **)malloc( sym_max * sizeof(char *) )) == NULL ||
+	(SymCell = (CONS *)malloc( sym_max * sizeof(CONS) )) == NULL ||
+	(SymMacro = (char *)malloc( sym_max * sizeof(char) )) == NULL ||
+	(SymNew = (int *)malloc( new_max * sizeof(int) )) == NULL ||
+	(free_no = (int *)malloc( free_max * sizeof(int) )) == NULL ||
+	(slots = (SLOT *)malloc( slot_max * sizeof(SLOT) )) == NULL ) {
+	FATAL("Can't allocate the symbol table.");
+   }
 
    /* reset symbol table */
-   for ( i = 0; i < MAX_SYMBOLS; i++)
-	SymTable[i] = NULL;
+   SymCount = SymNewCnt = sym_live = free_cnt = 0;
+   for ( i = 0; i < slot_max; i++)
+	slots[i].sym = -1;
 }
 
-/* ssAddSymbol(s) - Adds the symbol s to the symbol table.  Returns the
-	symbol table entry index.  Jumps to top-level on error.
+/* find_slot(s, h) - Returns the slot of symbol s, whose hash is h, or the
+	empty slot it goes in.  The table is never more than half full,
+	so there always is one.
 */
-int ssAddSymbol(s)
+static SLOT *find_slot(s, h)
 char *s;
+unsigned long h;
 {
-   int entry, retry, scomp;
+   unsigned long i;
+   SLOT *sl;
 
-   retry = entry = mcHash(s, MAX_SYMBOLS);
+   for ( i = h & (slot_max-1); ; i = (i+1) & (slot_max-1) ) {
+	sl = slots + i;
+	if ( sl->sym < 0 )
+		return sl;
 
-   /* find the appropriate bucket for this symbol */
-   while ( (SymTable[retry] != NULL) &&
-	   ((scomp = strcmp(SymTable[retry], s)) != 0) ) {
-
-	retry = mcRehash( s, retry, MAX_SYMBOLS );
-
-	/* we don't want to get into an infinite loop though */
-	/* this line depends entirely on the rehash function! */
-	if ( retry == entry ) break;
+	/* only look at the name if the hash matches */
+	if ( sl->hash == h && strcmp( SymTable[sl->sym], s ) == 0 )
+		return sl;
    }
+}
 
-   /* add the symbol if it's not already in the table */
-   if ( SymTable[retry] == NULL ) {
+/* grow_slots() - Doubles the hash table.  The hashes are in the slots, so
+	the names aren't looked at.  Returns FALSE if there's no memory.
+*/
+static BOOL grow_slots()
+{
+   SLOT *old;
+   unsigned long i, j, old_max;
+
+   old = slots;
+   old_max = slot_max;
+   if ( (slots = (SLOT *)malloc( 2 * old_max * sizeof(SLOT) )) == NULL ) {
+	slots = old;
+	return FALSE;
+   }
 
-	SYM_DEBUG("Adding a new symbol.");
+   slot_max = 2 * old_max;
+   for ( i = 0; i < slot_max; ++i )
+	slots[i].sym = -1;
 
-	/* add the symbol to the table */
-	SymTable[retry] = ssAddString(s);
+   for ( i = 0; i < old_max; ++i ) {
+	if ( old[i].sym < 0 )
+		continue;
 
-	return retry;
+	for ( j = old[i].hash & (slot_max-1); slots[j].sym >= 0; j = (j+1) & (slot_max-1) )
+		;
+	slots[j] = old[i];
    }
 
-   /* maybe the symbol is already in the table? */
-   if ( scomp == 0 ) {
+   free( old );
+   return TRUE;
+}
+
+/* ssIntern(s) - Returns the symbol s, the one cell there is for it.  It's
+	added to the symbol table if it isn't there.  Jumps to top-level
+	on error.
+
+	The table is weak, so while a major GC is marking a symbol found
+	in it is shaded: the snapshot may not have reached its cell, and
+	it mustn't be dropped now that it's in use.
+*/
+CONS ssIntern(s)
+char *s;
+{
+   unsigned long h;
+   char *name;
+   CONS sym;
+   SLOT *sl;
+
+   h = mcHash(s);
+   sl = find_slot( s, h );
+   if ( sl->sym >= 0 ) {
 
 	SYM_DEBUG("Linking to old symbol.");
 
-	return retry;
+	sym = SymCell[sl->sym];
+	SBarrier( sym );
+	return sym;
    }
 
-   /* couldn't find a slot for the symbol */
-   RT_ERROR("Symbol table full!");
+   SYM_DEBUG("Adding a new symbol.");
 
-   /*NOTREACHED!*/
-   /* please the compiler */
-   return -1;
+   /* the name is copied before the cell is made: s may be a string's
+    * characters, and the GC could take the string.  it's freed by
+    * ssDrop(), so it isn't in the string heap.
+    */
+   if ( (name = (char *)malloc( strlen(s) + 1 )) == NULL )
+	RT_ERROR("Out of memory; can't add symbol.");
+   strcpy( name, s );
+
+   sym = NewCons( SYMBOL, 0, 0 );
+   mcSym_No(sym) = add_symbol( name, sym );
+
+   /* the slots are kept no more than half full */
+   if ( 2 * (unsigned long)(sym_live + 1) > slot_max && !grow_slots() )
+	RT_ERROR("Symbol table full!");
+
+   sl = find_slot( name, h );
+   sl->hash = h;
+   sl->sym = mcSym_No(sym);
+
+   return sym;
 }
 
-/* ssIsSymbol(s) - Returns TRUE if s is a symbol that is in the symbol
-	table.
+/* ssGenSym(n) - Returns a new uninterned symbol named G<n>.  Reading
+	G<n> doesn't find it, so it's eq? to nothing but itself.  Jumps
+	to top-level on error.
 */
-int ssIsSymbol(s)
-char *s;
+CONS ssGenSym(n)
+long n;
 {
-   int entry, retry, scomp;
+   char *name;
+   CONS sym;
 
-   retry = entry = mcHash(s, MAX_SYMBOLS );
+   if ( (name = (char *)malloc( 24 )) == NULL )
+	RT_ERROR("Out of memory; can't add symbol.");
+   sprintf( name, "G%ld", n );
 
-   /* find the appropriate bucket for this symbol */
-   while ( (SymTable[retry] != NULL) &&
-	   ((scomp = strcmp(SymTable[retry], s)) != 0) ) {
+   sym = NewCons( SYMBOL, 0, 0 );
+   mcSym_No(sym) = add_symbol( name, sym );
+   return sym;
+}
 
-	retry = mcRehash( s, retry, MAX_SYMBOLS );
+/* add_symbol(name, sym) - Gives the symbol name, whose cell is sym, a #
+	-- one that was dropped if there is one -- and returns it.  It's
+	on SymNew until the next GC.  Jumps to top-level on error.
+*/
+static int add_symbol(name, sym)
+char *name;
+CONS sym;
+{
+   char **new;
+   CONS *cells;
+   char *macs;
+   int *nos, n;
+
+   if ( SymNewCnt >= new_max ) {
+	if ( (nos = (int *)realloc( SymNew, 2 * new_max * sizeof(int) )) == NULL )
+		RT_ERROR("Symbol table full!");
+	SymNew = nos;
+	new_max *= 2;
+   }
 
-	/* we don't want to get into an infinite loop though */
-	/* this line depends entirely on the rehash function! */
-	if ( retry == entry ) break;
+   if ( free_cnt > 0 )
+	n = free_no[--free_cnt];
+   else {
+	if ( SymCount >= sym_max ) {
+		if ( (new = (char **)realloc( SymTable, 2 * sym_max * sizeof(char *) )) == NULL )
+			RT_ERROR("Symbol table full!");
+		SymTable = new;
+		if ( (cells = (CONS *)realloc( SymCell, 2 * sym_max * sizeof(CONS) )) == NULL )
+			RT_ERROR("Symbol table full!");
+		SymCell = cells;
+		if ( (macs = (char *)realloc( SymMacro, 2 * sym_max * sizeof(char) )) == NULL )
+			RT_ERROR("Symbol table full!");
+		SymMacro = macs;
+		sym_max *= 2;
+	}
+	n = SymCount++;
    }
 
-   if ( scomp == 0 )
-	return TRUE;
+   SymTable[n] = name;
+   SymCell[n] = sym;
+   SymMacro[n] = FALSE;
+   SymNew[SymNewCnt++] = n;
+   ++sym_live;
 
-   return FALSE;
+   return n;
 }
 
-/* ssAddString(s) - Adds string S to the string storage buffer.  Returns a
-	pointer to the newly "allocated" string.
+/* ssDrop(n) - Drops symbol # n from the symbol table.  The GC calls it
+	when the symbol's cell is garbage and it isn't bound.  The # goes
+	on the free list.
 */
-char *ssAddString(s)
+void ssDrop(n)
+int n;
+{
+   int *nos;
+
+   drop_slot( n );
+   free( SymTable[n] );
+   SymTable[n] = NULL;
+   SymCell[n] = NULL;
+   SymMacro[n] = FALSE;
+   --sym_live;
+
+   /* this is the GC, so no RT_ERROR: without room the # isn't used
+    * again, that's all.
+    */
+   if ( free_cnt >= free_max ) {
+	if ( (nos = (int *)realloc( free_no, 2 * free_max * sizeof(int) )) == NULL )
+		return;
+	free_no = nos;
+	free_max *= 2;
+   }
+   free_no[free_cnt++] = n;
+}
+
+/* drop_slot(n) - Takes symbol # n's slot out of the hash table, if it
+	has one (gensyms don't).  The slots after it in its run are moved
+	back to fill the hole, so a probe never stops short of one.
+*/
+static void drop_slot(n)
+int n;
+{
+   unsigned long i, j, home;
+
+   for ( i = mcHash( SymTable[n] ) & (slot_max-1); slots[i].sym != n; i = (i+1) & (slot_max-1) )
+	if ( slots[i].sym < 0 )
+		return;
+
+   for ( j = (i+1) & (slot_max-1); slots[j].sym >= 0; j = (j+1) & (slot_max-1) ) {
+	/* slot j can move to i unless its home is cyclically in (i, j] */
+	home = slots[j].hash & (slot_max-1);
+	if ( i <= j ? (i < home && home <= j) : (i < home || home <= j) )
+		continue;
+	slots[i] = slots[j];
+	i = j;
+   }
+   slots[i].sym = -1;
+}
+
+/* ssClearMacros() - No symbol may be a macro any more. */
+void ssClearMacros()
+{
+   memset( SymMacro, FALSE, (size_t)SymCount );
+}
+
+/* ssSymCount() - Returns the # of symbols in the symbol table. */
+int ssSymCount()
+{
+   return sym_live;
+}
+
+/* ssIsSymbol(s) - Returns TRUE if s is a symbol that is in the symbol
+	table.
+*/
+int ssIsSymbol(s)
 char *s;
 {
-   char *start;
+   return find_slot( s, mcHash(s) )->sym >= 0;
+}
 
-   if ( Sleft <= 0 )
-	RT_ERROR("Out of string space!");
+/* ssAddString(s) - Returns a copy of string s in the string heap. */
+char *ssAddString(s)
+char *s;
+{
+   int len;
+   char *new;
 
-   /* copy the string into the string space */
-   for ( start = STRING_SPACE; *s != EOS && Sleft > 2; ++s, ++STRING_SPACE, --Sleft )
-	*STRING_SPACE = *s;
-   *STRING_SPACE++ = EOS; --Sleft;	/* string is EOS terminated */
+   len = strlen(s);
+   new = NewStr( len );
+   memcpy( new, s, (size_t)len );
 
-   return start;
+   return new;
 }
 
 /* ssSubstring(s, beg, end) - Copies the substring defined by the indexes of
@@ -160,34 +426,153 @@ char *ssSubstring(s, beg, end)
 char *s;
 int beg, end;
 {
-   char *start, *stop;
+   int len;
+   char *new;
 
-   stop = s+end+1;
-   s += beg;
-   start = STRING_SPACE;
+   /* it stops short at the end of s */
+   for ( len = 0; beg+len <= end && s[beg+len] != EOS; ++len )
+	;
 
-   for ( ; s != stop && Sleft > 2 && *s != EOS; ++s, ++STRING_SPACE, --Sleft )
-	*STRING_SPACE = *s;
-   *STRING_SPACE++ = EOS; --Sleft;
+   new = NewStr( len );
+   memcpy( new, s+beg, (size_t)len );
 
-   return start;
+   return new;
 }
 
-/* ssAppend(s1, s2) - Returns a newly allocated string made from appending
-	s2 to s1.
+/* ssAppend(s1, len1, s2, len2) - Returns a newly allocated string made
+	from appending the len2 characters of s2 to the len1 of s1.  They
+	needn't be EOS terminated.
 */
-char *ssAppend(s1, s2)
+char *ssAppend(s1, len1, s2, len2)
 char *s1, *s2;
+int len1, len2;
 {
-   char *start;
+   char *new;
 
-   start = STRING_SPACE;
-   for ( ; *s1 != EOS && Sleft > 2 ; ++s1, ++STRING_SPACE, --Sleft )
-	*STRING_SPACE = *s1;
+   new = NewStr( len1 + len2 );
+   memcpy( new, s1, (size_t)len1 );
+   memcpy( new+len1, s2, (size_t)len2 );
 
-   for ( ; *s2 != EOS && Sleft > 2 ; ++s2, ++STRING_SPACE, --Sleft )
-	*STRING_SPACE = *s2;
-   *STRING_SPACE++ = EOS; --Sleft;
+   return new;
+}
 
-   return start;
+/* ssMemChr(s, n, c) - Returns the index of the first c in the n characters
+	at s, or -1 if there isn't one.
+*/
+long ssMemChr(s, n, c)
+char *s;
+long n;
+int c;
+{
+   long i;
+
+   i = 0;
+
+#ifdef SIMD_AVX2
+   {
+   __m256i cv;
+   unsigned m;
+
+   cv = _mm256_set1_epi8( (char)c );
+   for ( ; i + 32 <= n; i += 32 ) {
+	m = (unsigned)_mm256_movemask_epi8( _mm256_cmpeq_epi8( cv,
+			_mm256_loadu_si256( (__m256i *)(s+i) ) ) );
+	if ( m != 0 )
+		return i + __builtin_ctz(m);
+   }
+   }
+#endif
+
+#ifdef SIMD_SSE2
+   {
+   __m128i cv;
+   unsigned m;
+
+   cv = _mm_set1_epi8( (char)c );
+   for ( ; i + 16 <= n; i += 16 ) {
+	m = (unsigned)_mm_movemask_epi8( _mm_cmpeq_epi8( cv,
+			_mm_loadu_si128( (__m128i *)(s+i) ) ) );
+	if ( m != 0 )
+		return i + __builtin_ctz(m);
+   }
+   }
+#endif
+
+   for ( ; i < n; ++i )
+	if ( s[i] == (char)c )
+		return i;
+
+   return -1;
+}
+
+/* ssMemMem(s, n, p, pn) - Returns the index of the first occurrence of
+	the pn characters at p in the n characters at s, or -1 if there
+	isn't one.  Neither needs to be EOS terminated.
+*/
+long ssMemMem(s, n, p, pn)
+char *s, *p;
+long n, pn;
+{
+   long i, last;
+
+   if ( pn == 0 )
+	return 0;
+   if ( pn == 1 )
+	return ssMemChr( s, n, *p );
+   if ( pn > n )
+	return -1;
+
+   /* a match can start anywhere up to last */
+   last = n - pn;
+   i = 0;
+
+#ifdef SIMD_AVX2
+   {
+   __m256i fv, lv, eq;
+   unsigned m;
+   int b;
+
+   fv = _mm256_set1_epi8( p[0] );
+   lv = _mm256_set1_epi8( p[pn-1] );
+   for ( ; i + 32 <= last + 1; i += 32 ) {
+	eq = _mm256_and_si256(
+		_mm256_cmpeq_epi8( fv, _mm256_loadu_si256( (__m256i *)(s+i) ) ),
+		_mm256_cmpeq_epi8( lv, _mm256_loadu_si256( (__m256i *)(s+i+pn-1) ) ) );
+	for ( m = (unsigned)_mm256_movemask_epi8(eq); m != 0; m &= m - 1 ) {
+		b = __builtin_ctz(m);
+		if ( memcmp( s+i+b+1, p+1, (size_t)(pn-2) ) == 0 )
+			return i + b;
+	}
+   }
+   }
+#endif
+
+#ifdef SIMD_SSE2
+   {
+   __m128i fv, lv, eq;
+   unsigned m;
+   int b;
+
+   fv = _mm_set1_epi8( p[0] );
+   lv = _mm_set1_epi8( p[pn-1] );
+   for ( ; i + 16 <= last + 1; i += 16 ) {
+	eq = _mm_and_si128(
+		_mm_cmpeq_epi8( fv, _mm_loadu_si128( (__m128i *)(s+i) ) ),
+		_mm_cmpeq_epi8( lv, _mm_loadu_si128( (__m128i *)(s+i+pn-1) ) ) );
+	for ( m = (unsigned)_mm_movemask_epi8(eq); m != 0; m &= m - 1 ) {
+		b = __builtin_ctz(m);
+		if ( memcmp( s+i+b+1, p+1, (size_t)(pn-2) ) == 0 )
+			return i + b;
+	}
+   }
+   }
+#endif
+
+   /* the rest a character at a time */
+   for ( ; i <= last; ++i )
+	if ( s[i] == p[0] && s[i+pn-1] == p[pn-1] &&
+	     memcmp( s+i+1, p+1, (size_t)(pn-2) ) == 0 )
+		return i;
+
+   return -1;
 }
@@ -1,15 +1,24 @@
 /* symstr.h */
 
-#define MAX_SYMBOLS	1000	/* # of different symbols */
+#define INIT_SYMBOLS	1024	/* symbols the table starts with room for */
 
-extern char *SymTable[];
-extern char *STRING_SPACE;
-extern int Sleft;
+extern char **SymTable;
+extern CONS *SymCell;
+extern char *SymMacro;
+extern int SymCount;
+extern int *SymNew;
+extern int SymNewCnt;
 
 /* prototypes */
 void InitSymstr( C_VOID );
-int ssAddSymbol( C_CHAR C_PTR );
+CONS ssIntern( C_CHAR C_PTR );
+CONS ssGenSym( C_LONG );
+void ssDrop( C_INT );
+void ssClearMacros( C_VOID );
+int ssSymCount( C_VOID );
 int ssIsSymbol( C_CHAR C_PTR );
 char *ssAddString( C_CHAR C_PTR );
 char *ssSubstring( C_CHAR C_PTR X C_INT X C_INT );
-char *ssAppend( C_CHAR C_PTR X C_CHAR C_PTR );
+char *ssAppend( C_CHAR C_PTR X C_INT X C_CHAR C_PTR X C_INT );
+long ssMemChr( C_CHAR C_PTR X C_LONG X C_INT );
+long ssMemMem( C_CHAR C_PTR X C_LONG X C_CHAR C_PTR X C_LONG );
@@ -0,0 +1,20 @@
+;; markbench.s -- Mark throughput on a million element list and a
+;; million pair tree.  Run from SRC:  scheme -s < ../SSRC/markbench.s
+;; (GC-STATS) reports the throughput of the last (GC) in cells/second.
+
+(define (mklist n l) (if (= n 0) l (mklist (- n 1) (cons n l))))
+(define (mktree d) (if (= d 0) '() (cons (mktree (- d 1)) (mktree (- d 1)))))
+
+;; list: 1,000,000 pairs + 1,000,000 integers
+(define big (mklist 1000000 '()))
+(gc)
+(gc-stats)
+(set! big '())
+
+;; tree: 2^20 - 1 pairs
+(set! big (mktree 20))
+(gc)
+(gc-stats)
+(set! big '())
+
+(exit)
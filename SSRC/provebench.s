@@ -0,0 +1,30 @@
+;;; provebench -- a benchmark for closure calls and variable lookup.
+;;;
+;;;     Proves (member 9 (@ 1 ... 9)) 300 times with the theorem prover
+;;; in prove6.s.  The prover hands its success and failure continuations
+;;; down as closures nested several deep, so most of the time goes to
+;;; calling them and looking up variables bound frames out.
+;;; Run it from SRC:  scheme < ../SSRC/provebench.s
+;;;
+(define (cadr l) (car (cdr l)))
+(define (caddr l) (car (cdr (cdr l))))
+(define (cddr l) (cdr (cdr l)))
+(define (cdddr l) (cdr (cdr (cdr l))))
+(define (caadr l) (car (car (cdr l))))
+(define (cdadr l) (cdr (car (cdr l))))
+(define (map1 f l) (if (null? l) '() (cons (f (car l)) (map1 f (cdr l)))))
+
+(load "../SSRC/macfunc.s")
+(load "../SSRC/macdef.s")
+(load "../SSRC/extend.s")
+(load "../SSRC/unify2.s")
+(load "../SSRC/prove6.s")
+(load "../SSRC/prims.s")
+
+(define (prove-times n)
+   (if (= n 0) 'done
+       (begin (prove '(member 9 (@ 1 2 3 4 5 6 7 8 9)) memberdb)
+              (prove-times (- n 1)))))
+
+(prove-times 300)
+(exit)
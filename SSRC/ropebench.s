@@ -0,0 +1,28 @@
+;;; ropebench -- a string-append benchmark for ropes.
+;;;
+;;;     Builds a 100 MB report out of 47 character lines, a STRING-APPEND
+;;; a line, then writes it to ropebench.out and prints its length.
+;;; STRING-APPEND used to copy both strings every time, so this copied
+;;; about 100 TB and never finished; now a long string is a rope,
+;;; appending to it copies a path down the rope, and DISPLAY writes it a
+;;; piece at a time.  Delete ropebench.out afterwards.
+;;; Run it from SRC:  scheme < ../SSRC/ropebench.s
+;;;
+(define nl (list->string (list #\newline)))
+(define line1 (string-append "item 0042: widgets shipped ....... 17 units ok" nl))
+(define line2 (string-append "item 0043: sprockets back-ordered  3 units --" nl))
+
+(define (report n acc)
+   (if (= n 0) acc
+       (report2 (- n 1) (string-append acc line1))))
+
+(define (report2 n acc)
+   (if (= n 0) acc
+       (report (- n 1) (string-append acc line2))))
+
+(define rpt (report 2184533 ""))
+(define out (open-output-file "ropebench.out"))
+(begin (display rpt out) (close-file out))
+(string-length rpt)
+(gc-stats)
+(exit)
@@ -0,0 +1,43 @@
+;;; srchbench -- a benchmark for the string search primitives.
+;;;
+;;;     Looks for a character and a string at the end of a 100K string
+;;; with STRING-INDEX and STRING-CONTAINS, 2000 times each, then with
+;;; the Scheme loops over STRING-REF they replace, twice each.  To time
+;;; them apart, comment out one of the two (search ...) lines at the
+;;; bottom.
+;;; Run it from SRC:  scheme < ../SSRC/srchbench.s
+;;;
+(define (grow n s) (if (= n 0) s (grow (- n 1) (string-append s "the quick brown fox jumps over a lazy dog "))))
+(define hay (string-append (grow 2380 "") "needle!"))
+
+;; the Scheme loops
+(define (scm-index s c)
+   (index-loop s c 0 (string-length s)))
+
+(define (index-loop s c i n)
+   (if (= i n) #f
+       (if (char=? (string-ref s i) c) i
+           (index-loop s c (+ i 1) n))))
+
+(define (scm-contains s p)
+   (contains-loop s p 0 (- (string-length s) (string-length p))))
+
+(define (contains-loop s p i last)
+   (if (> i last) #f
+       (if (match? s p i 0) i
+           (contains-loop s p (+ i 1) last))))
+
+(define (match? s p i j)
+   (if (= j (string-length p)) #t
+       (if (char=? (string-ref s (+ i j)) (string-ref p j))
+           (match? s p i (+ j 1))
+           #f)))
+
+(define (search n index contains)
+   (if (= n 0) (list (index hay #\!) (contains hay "needle!"))
+       (begin (index hay #\!) (contains hay "needle!")
+              (search (- n 1) index contains))))
+
+(search 2000 string-index string-contains)
+(search 2 scm-index scm-contains)
+(exit)
@@ -0,0 +1,21 @@
+;;; strbench -- a string benchmark for the string heap.
+;;;
+;;;     Makes 10,000,000 strings, two a time around: a string-append,
+;;; then a substring or a list->string of it.  None of them are kept
+;;; but the last.  Strings used to be copied into a fixed string space
+;;; that was never given back, so this ran out of it in a hundred or
+;;; so; now a dead string's room goes to the next ones, and the process
+;;; stays small.
+;;; Run it from SRC:  scheme < ../SSRC/strbench.s
+;;;
+(define (str-loop n s)
+   (if (= n 0) s
+       (str-loop2 (- n 1) (substring (string-append s "abcdefghijklmnopqrstuvwxyz") 26 50))))
+
+(define (str-loop2 n s)
+   (if (= n 0) s
+       (str-loop (- n 1) (list->string (string->list (string-append s "abcdefghijklmnopqrstuvwxyz"))))))
+
+(string-length (str-loop 5000000 "abcdefghijklmnopqrstuvwxyz"))
+(gc-stats)
+(exit)
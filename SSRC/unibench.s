@@ -0,0 +1,36 @@
+;;; unibench -- a list-heavy benchmark for the memory manager.
+;;;
+;;;     Unifies (f (? x 1) ... (? x n)) with (f (c 1) ... (c n)) over and
+;;; over.  The bindings are an a-list that grows to n pairs and lookup
+;;; walks it for every variable, so nearly all the time goes to chasing
+;;; cdrs.  Every a-list is kept, so the heap grows well past the cache.
+;;; Run it from SRC:  scheme < ../SSRC/unibench.s
+;;;
+(define (cadr l) (car (cdr l)))
+(define (caddr l) (car (cdr (cdr l))))
+(define (cddr l) (cdr (cdr l)))
+(define (cdddr l) (cdr (cdr (cdr l))))
+(define (caadr l) (car (car (cdr l))))
+(define (cdadr l) (cdr (car (cdr l))))
+(define (map1 f l) (if (null? l) '() (cons (f (car l)) (map1 f (cdr l)))))
+
+(load "../SSRC/macfunc.s")
+(load "../SSRC/macdef.s")
+(load "../SSRC/unify2.s")
+
+(define (make-terms tag i n)
+   (if (> i n) '()
+       (cons (if (eq? tag '?) (list '? 'x i) (list tag i))
+             (make-terms tag (+ i 1) n))))
+
+(define (unify-loop r a b res)
+   (if (= r 0) (length res)
+       (unify-loop (- r 1) a b (cons (Unify a b '()) res))))
+
+(define (unibench reps n)
+   (unify-loop reps (cons 'f (make-terms '? 1 n))
+                    (cons 'f (make-terms 'c 1 n)) '()))
+
+(unibench 400 250)
+(gc-stats)
+(exit)
@@ -8,4 +8,9 @@
 ((lambda (x y . z) (list x y z)) 1 2 3 4)
 ((lambda (x y . z) (list x y z)) 2 3)
 ((lambda x x) 7 13)
+;; more globals than the symbol table and global vector start with
+(define (defs n s) (if (= n 0) 'ok (begin (eval (list 'define (string->symbol s) n)) (defs (- n 1) (string-append s "x")))))
+(defs 1500 "v")
+(eval (string->symbol "vxxx"))
+(eval (string->symbol (list->string '(#\v #\x #\x #\x #\x #\x #\x #\x #\x #\x #\x #\x #\x #\x #\x #\x #\x #\x #\x #\x #\x))))
 (exit)
@@ -13,4 +13,87 @@
 
 ((compose add1 *) 5 4)
 
+(define (twice f x) (f (f x)))
+(twice car '((1 2) 3))
+(twice cdr '(1 2 3))
+(define (sum3 f) (f 1 2 3))
+(sum3 +)
+(sum3 list)
+(define (shadow car) (car 5))
+(shadow (lambda (x) (* x x)))
+(define (count-down n) (if (= n 0) 'done (begin n (count-down (- n 1)))))
+(count-down 5000)
+(define (two-arm x) (if x 'yes))
+(two-arm #f)
+(define g 10)
+(define cnt (eval (*compile* '(lambda (n) (set! g (+ g n)) (set! n (* n 2)) (list g n)))))
+(cnt 5)
+g
+(define (peek g) (eval (*compile* 'g)))
+(peek 'local)
+(define (peek2 g) (eval (*compile* '((lambda (x) (set! g x) g) 'changed))))
+(peek2 'local)
+g
+
+(define (deep n) (if (= n 0) 0 (+ 1 (deep (- n 1)))))
+(deep 20000)
+(define (upto n) (if (= n 0) '() (cons n (upto (- n 1)))))
+(length (apply list (upto 10000)))
+(apply + (upto 10000))
+
+;; analyzed bodies are analyzed again when a name they call becomes a
+;; macro or a primitive they call is rebound
+(define (my x) (list 'fn x))
+(define (g x) (my x))
+(g 1)
+(define (make-my) (lambda (x) (my x)))
+(define inner-my (make-my))
+(macro my (lambda (e) (list 'quote (list 'mac (car (cdr e))))))
+(g 1)
+(inner-my 1)
+(define real-car car)
+(define (f x) (car x))
+(f '(1 2))
+(define inner-car ((lambda () (lambda (x) (car x)))))
+(inner-car '(1 2))
+(set! car cdr)
+(f '(1 2))
+(inner-car '(1 2))
+(set! car real-car)
+(f '(1 2))
+
+;; frames: parameters found across nested frames, a lambda without
+;; parameters (no frame) in between, and shadowing
+(define (nest3 a b) ((lambda (c) ((lambda (d e) (list a b c d e)) (* c 2) b)) (+ a b)))
+(nest3 1 2)
+(define (skip a) ((lambda () ((lambda (b) (list a b)) 2))))
+(skip 1)
+(define (shad x) ((lambda (x y) (list x y)) (* x 10) x))
+(shad 5)
+(define (make-counter) ((lambda (n) (lambda () (set! n (+ n 1)) n)) 0))
+(define c1 (make-counter))
+(c1)
+(c1)
+;; the-environment inside a frame sees all of them
+(define (peek-env a) ((lambda (b) ((lambda () (eval '(list a b) (the-environment))))) (* a 2)))
+(peek-env 3)
+(define (bump a) ((lambda (b) (eval '(set! a (+ a b)) (the-environment)) a) 5))
+(bump 10)
+;; re-entering a continuation finds the frame it was captured in
+(define saved-k #f)
+(define (frame-k a)
+   ((lambda (b seen)
+      ((lambda (v)
+	 (set! seen (cons (list a b v) seen))
+	 (if (< (length seen) 3) (saved-k (* 10 (length seen))) seen))
+       (call/cc (lambda (k) (set! saved-k k) 0))))
+    (* a 2) '()))
+(frame-k 1)
+
+;; globals in analyzed bodies, frames out
+(define gtotal 0)
+(define (gsum a n) ((lambda (b) ((lambda (c) (if (= n 0) gtotal (begin (set! gtotal (+ gtotal c)) (gsum a (- n 1))))) b)) a))
+(gsum 3 100)
+gtotal
+
 (exit)
@@ -54,5 +54,29 @@ a
 	( (= 3 3)		'equal )
 )
 
+(macro unless (lambda (e) (list 'if (cadr e) #f (caddr e))))
+(define (down n) (unless (= n 0) (down (- n 1))))
+(define s0 (expand-stats))
+(down 10)
+(define s1 (expand-stats))
+(- (car s1) (car s0))
+(- (cadr s1) (cadr s0))
+(macro twice (lambda (e) (list 'list (cadr e) (cadr e))))
+(define (tw x) (twice x))
+(tw 1)
+(tw 2)
+(macro twice (lambda (e) (list 'list (cadr e) (cadr e) (cadr e))))
+(tw 3)
+(define f (list 'twice 4))
+(eval f)
+(set-cdr! f '(5))
+(eval f)
+(set! *expansion-table* (cons (cons 'thrice (lambda (e) (list 'list (cadr e) (cadr e) (cadr e)))) *expansion-table*))
+(thrice 7)
+(car (assoc 'thrice *expansion-table*))
+(set! *expansion-table* (cdr *expansion-table*))
+(define (thrice x) (list x))
+(thrice 8)
+(tw 9)
 (exit)
 
@@ -0,0 +1,168 @@
+;;; gc.s -- garbage collector tests
+
+;; deep car nesting: the marker must not recurse on the car
+(define (nest n l) (if (= n 0) l (nest (- n 1) (cons l '()))))
+(define (depth l n) (if (null? l) n (depth (car l) (+ n 1))))
+(define deep (nest 30000 '()))
+(gc)
+(depth deep 0)
+
+;; a long list survives a full GC
+(define (mklist n l) (if (= n 0) l (mklist (- n 1) (cons n l))))
+(define long (mklist 10000 '()))
+(gc)
+(length long)
+
+;; incremental marking: smallest budget, then stop-the-world
+(gc-budget 1)
+(set! long (mklist 10000 '()))
+(length long)
+(gc-budget 0)
+(set! long (mklist 10000 '()))
+(length long)
+(gc-budget 256)
+
+;; vector payloads: small ones from the pools, big ones are large objects
+(define small (make-vector 5 'a))
+(define big (make-vector 3000 'b))
+(define (churn n) (if (= n 0) 'done (begin (make-vector 40 n) (make-vector 700 n) (churn (- n 1)))))
+(churn 2000)
+(gc)
+(begin (vector-set! big 2999 'c) 'set)
+(churn 2000)
+(gc)
+(vector-ref small 4)
+(vector-ref big 0)
+(vector-ref big 2999)
+(vector-length (vector-copy big))
+
+;; compiled calls: the args are only held by C locals while they compile
+(eval (*compile* '(define cargs (lambda (a b) (list (+ a b) ((lambda (x) (* x x)) a) (cons a b) ((lambda (y) (- y b)) 10))))))
+(cargs 3 4)
+(churn 200)
+(cargs 5 6)
+
+;; the symbol table is weak: symbols nothing holds go, the rest stay
+(define (syms n) (if (= n 0) 'done (begin (string->symbol (string-append "S" (symbol->string (gensym)))) (syms (- n 1)))))
+(define kept (string->symbol "KEPT-SYM"))
+(define g (gensym))
+(syms 3000)
+(gc)
+(eq? kept 'kept-sym)
+(eq? g g)
+(eq? g (string->symbol (symbol->string g)))
+(cargs 7 8)
+
+;; write barrier: old cells made to point at young ones keep them
+;; thru the minor GCs that follow
+(define (churn-pairs n) (if (= n 0) 'done (begin (cons n n) (churn-pairs (- n 1)))))
+(define old-pair (cons 'a 'b))
+(define old-vec (make-vector 3 'x))
+(gc)
+(set-car! old-pair (list 7 49 (string-append "y" "yy")))
+(set-cdr! old-pair (list 'tail))
+(vector-set! old-vec 1 (list 8 64 (string-append "z" "z")))
+(churn-pairs 20000)
+old-pair
+old-vec
+
+;; snapshot barrier: while a major GC marks in small slices, a list is
+;; moved back and forth between a vector slot and a pair, the old place
+;; cleared each time, so the marker may only ever see it where it was
+(gc-budget 1)
+(define hold (list '()))
+(define slot (make-vector 1 '()))
+(define (sum l n) (if (null? l) n (sum (cdr l) (+ n (car l)))))
+(define (juggle n)
+   (if (= n 0) 'done
+       (begin (set-car! hold (cons n (vector-ref slot 0)))
+	      (vector-set! slot 0 '())
+	      (mklist 40 '())
+	      (vector-set! slot 0 (car hold))
+	      (set-car! hold '())
+	      (juggle (- n 1)))))
+(juggle 30000)
+(length (vector-ref slot 0))
+(sum (vector-ref slot 0) 0)
+(gc-budget 256)
+
+;; lazy sweep: every other list dies, so after the GC the live cells are
+;; spread thru segments that get swept as the new lists are made
+(define rows (make-vector 2000 '()))
+(define (fill i step)
+   (if (< i 2000)
+       (begin (vector-set! rows i (mklist 20 '())) (fill (+ i step) step))))
+(define (clear i) (if (< i 2000) (begin (vector-set! rows i '()) (clear (+ i 2)))))
+(define (total i n) (if (< i 2000) (total (+ i 1) (+ n (sum (vector-ref rows i) 0))) n))
+(fill 0 1)
+(clear 0)
+(gc)
+(fill 0 2)
+(total 0 0)
+(clear 1)
+(gc)
+(total 0 0)
+
+;; size classes: pairs, closures, continuations, ports, floats, strings
+;; and vectors made in turn land in different segments; all must survive
+(define (nth l i) (if (= i 0) (car l) (nth (cdr l) (- i 1))))
+(define (thing n)
+   (list n (lambda () n) (call/cc (lambda (k) k)) (open-input-string (symbol->string 'x))
+	 (/ n 2.0) (string-append "s" "t") (make-vector 3 n)))
+(define (things n l) (if (= n 0) l (things (- n 1) (cons (thing n) l))))
+(define (ok? t)
+   (and (= ((nth t 1)) (car t)) (procedure? (nth t 2)) (input-port? (nth t 3))
+	(eq? (read (nth t 3)) 'x) (= (* 2 (nth t 4)) (car t))
+	(string=? (nth t 5) "st") (= (vector-ref (nth t 6) 2) (car t))))
+(define (all-ok? l) (if (null? l) #t (if (ok? (car l)) (all-ok? (cdr l)) (car l))))
+(define mixed (things 500 '()))
+(churn 200)
+(gc)
+(churn 200)
+(all-ok? mixed)
+
+;; heap policy: the heap grows for a big list and gives the segments
+;; back once it is gone, then grows again
+(define big-list (mklist 200000 '()))
+(length big-list)
+(set! big-list '())
+(gc)
+(gc)
+(set! big-list (mklist 200000 '()))
+(length big-list)
+(set! big-list '())
+
+;; parallel marking: a wide tree whose leaves all share one list, so the
+;; markers race to mark the same cells
+(define shared (mklist 1000 '()))
+(define (leaf i) (cons i shared))
+(define (row i j v) (if (= j 0) v (begin (vector-set! v (- j 1) (leaf (+ i j))) (row i (- j 1) v))))
+(define (rows i l) (if (= i 0) l (rows (- i 1) (cons (row (* i 100) 100 (make-vector 100 #f)) l))))
+(define wide (rows 300 '()))
+(set! shared '())
+(gc)
+(churn 200)
+(gc)
+(define (leaves l n)
+   (if (null? l) n
+       (leaves (cdr l) (+ n (car (vector-ref (car l) 0)) (sum (cdr (vector-ref (car l) 99)) 0)))))
+(leaves wide 0)
+
+;; background sweep: right after the GC, while the sweeper frees the
+;; payloads of the dead vectors and strings, new ones are made and filled
+(define (vecs n k l) (if (= n 0) l (vecs (- n 1) (if (= k 50) 1 (+ k 1)) (cons (make-vector k n) l))))
+(define (strs n l) (if (= n 0) l (strs (- n 1) (cons (string-append "ab" (symbol->string 'cd)) l))))
+(define (vsum l n) (if (null? l) n (vsum (cdr l) (+ n (vector-ref (car l) (- (vector-length (car l)) 1))))))
+(define (refill l) (if (null? l) 'done (begin (vector-fill! (car l) 1) (refill (cdr l)))))
+(define (slen l n) (if (null? l) n (slen (cdr l) (+ n (string-length (car l))))))
+(define dead (list (vecs 3000 1 '()) (strs 3000 '())))
+(set! dead '())
+(gc)
+(define live (vecs 3000 1 '()))
+(define text (strs 3000 '()))
+(vsum live 0)
+(refill live)
+(vsum live 0)
+(slen text 0)
+
+(exit)
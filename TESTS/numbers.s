@@ -47,4 +47,14 @@
 (abs -1)
 (abs -1.0)
 (abs (* -1 4))
+
+;; fixnums and characters are immediates
+(eq? 6 6)
+(eq? -32000 -32000)
+(eqv? 6 6.0)
+(eq? #\a #\a)
+(+ 1 2 3.5)
+(- 10 2.5)
+(/ 9 3.0)
+(* 1 2 3 4 5 6 7)
 (exit)
@@ -17,6 +17,8 @@
 (equal? 'aaa 'aaa)
 
 (eq? 'symbol4 'symbol5)
+(eq? 'abc (string->symbol "ABC"))
+(eq? (car '(xyz)) (cadr '(w xyz)))
 (eqv? 'symbol4 'symbol5)
 (equal? 'symbol4 'symbol5)
 
@@ -30,4 +30,70 @@
 (string-append "This is " "a test.")
 (list->string '( #\H #\i #\, #\T #\h #\e #\r #\e #\! ) )
 (string->list "Honey, I'm home!")
+;; more than the old 5000 byte string space
+(define (grow n s) (if (= n 0) s (grow (- n 1) (string-append s "0123456789"))))
+(string-length (grow 1000 ""))
+(substring (grow 100 "x") 995 1000)
+;; long substrings share their string's characters until one is changed
+(define s (grow 5 "x"))
+(define t (substring s 1 40))
+(define u (substring t 2 38))
+u
+(string-length u)
+(string-set! t 10 #\*)
+u
+(string-set! s 11 #\!)
+t
+(string-fill! u #\-)
+(string=? (substring s 0 45) (substring s 0 45))
+(string<? (substring s 0 44) (substring s 0 45))
+;; long appends are ropes; changing one doesn't change the others
+(define r1 (grow 30 ""))
+(define r2 (string-append r1 "ABC"))
+(define r3 (string-append "<" r2))
+(string-length r3)
+(string-ref r3 302)
+(substring r3 295 303)
+(string-set! r2 0 #\!)
+(substring r1 0 3)
+(substring r3 0 3)
+(string=? (substring (grow 40 "") 0 299) (substring r1 0 299))
+(string-append (grow 15 "") (grow 15 ""))
+;; string ports
+(define o (open-output-string))
+(write '(a "b" #\c 1.5) o)
+(write-char #\! o)
+(display " x" o)
+(get-output-string o)
+(define (fill n) (if (= n 0) o (begin (write-char #\z o) (fill (- n 1)))))
+(string-length (get-output-string (fill 1000)))
+(substring (get-output-string o) 20 30)
+(get-output-string (open-output-string))
+(define i (open-input-string "(define q 42) #(1 2) ok"))
+(read i)
+(read i)
+(read-char i)
+(read i)
+(read i)
+(define j (open-input-string (get-output-string o)))
+(read j)
+(read-char j)
+(read j)
+(read j)
+;; searching
+(string-index "hello, world" #\o)
+(string-index "hello, world" #\z)
+(string-contains "the quick brown fox jumps over the lazy dog" "the lazy")
+(string-contains "the quick brown fox" "")
+(string-contains "abc" "abcd")
+(string-search-forward "o" "hello, world" 5)
+(string-search-forward "o" "hello, world" 9)
+(string-contains (string-append (grow 40 "") "needle") "9needle")
+(string-index (string-append (grow 40 "") "x") #\x)
+(string-split "a,b,,c," #\,)
+(string-split "" #\,)
+(string-prefix? "he" "hello")
+(string-prefix? "hello!" "hello")
+(string-suffix? "llo" "hello")
+(string-suffix? "he" "hello")
 (exit)
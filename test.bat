@@ -62,3 +62,28 @@ echo .
 echo Testing PROLOG
 ..\scheme -s < logic.s > temp
 diff logic.o temp
+
+echo .
+echo Testing GC
+..\scheme -s < gc.s > temp
+diff gc.o temp
+
+echo .
+echo Testing GC - 4 MARKERS
+..\scheme -s -G4 -p0 < gc.s > temp
+diff gc.o temp
+
+echo .
+echo Testing GC - NO SWEEPER
+..\scheme -s --fg-sweep < gc.s > temp
+diff gc.o temp
+
+echo .
+echo Testing GC - FIXED HEAP
+..\scheme -s -H8M --heap-min=8M --heap-max=64M < gc.s > temp
+diff gc.o temp
+
+echo .
+echo Testing GC - SMALL HEAP
+..\scheme -s --heap-max=8M < gc.s > temp
+diff gc.o temp
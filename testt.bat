@@ -62,3 +62,8 @@ echo .
 echo Testing PROLOG
 ..\scheme -s -t < logic.s > temp
 diff logic.o temp
+
+echo .
+echo Testing GC
+..\scheme -s -t < gc.s > temp
+diff gc.o temp